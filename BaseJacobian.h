@@ -35,6 +35,18 @@ namespace defaulttype
 
 
 /** Template class used to implement one jacobian block
+
+  Blocks are stored by value in contiguous arrays and mappings are templated on the concrete block type,
+  so the block interface is resolved at compile time (blocks carry no vtable and calls are inlined in the mapping loops).
+  Each block must provide:
+    - static const bool constant;                                                           // J does not depend on the parent state
+    - void addapply( OutCoord& result, const InCoord& data );                               // Called in Apply
+    - void addmult( OutDeriv& result,const InDeriv& data );                                 // Called in ApplyJ
+    - void addMultTranspose( InDeriv& result, const OutDeriv& data );                       // Called in ApplyJT
+    - MatBlock getJ();                                                                      // Called in getJ
+    - KBlock getK(const OutDeriv& childForce, bool stabilization=false);                    // Geometric Stiffness = dJ^T.fc
+    - void addDForce( InDeriv& df, const InDeriv& dx, const OutDeriv& childForce, const SReal& kfactor ); // compute $ df += K dx $
+  When runtime polymorphism is needed, use VirtualJacobianBlock.
 */
 template<class TIn, class TOut>
 class BaseJacobianBlock
@@ -56,20 +68,6 @@ public:
     typedef type::Mat<Out::deriv_total_size,In::deriv_total_size,Real> MatBlock;
     typedef type::Mat<In::deriv_total_size,In::deriv_total_size,Real> KBlock;
 
-    // Called in Apply
-    virtual void addapply( OutCoord& result, const InCoord& data )=0;
-    // Called in ApplyJ
-    virtual void addmult( OutDeriv& result,const InDeriv& data )=0;
-    // Called in ApplyJT
-    virtual void addMultTranspose( InDeriv& result, const OutDeriv& data )=0;
-    // Called in getJ
-    virtual MatBlock getJ()=0;
-
-    // Geometric Stiffness = dJ^T.fc
-    virtual KBlock getK(const OutDeriv& childForce, bool stabilization=false)=0;
-    // compute $ df += K dx $
-    virtual void addDForce( InDeriv& df, const InDeriv& dx, const OutDeriv& childForce, const SReal& kfactor )=0;
-
 protected:
 
 
@@ -179,6 +177,54 @@ protected:
 
 
 
+/** Abstract jacobian block, for code that needs runtime polymorphism (see VirtualJacobianBlock)
+*/
+template<class TIn, class TOut>
+class PolymorphicJacobianBlock
+{
+public:
+    typedef BaseJacobianBlock<TIn,TOut> Base;
+    typedef typename Base::InCoord InCoord;
+    typedef typename Base::InDeriv InDeriv;
+    typedef typename Base::OutCoord OutCoord;
+    typedef typename Base::OutDeriv OutDeriv;
+    typedef typename Base::MatBlock MatBlock;
+    typedef typename Base::KBlock KBlock;
+
+    virtual ~PolymorphicJacobianBlock() {}
+
+    virtual void addapply( OutCoord& result, const InCoord& data )=0;
+    virtual void addmult( OutDeriv& result,const InDeriv& data )=0;
+    virtual void addMultTranspose( InDeriv& result, const OutDeriv& data )=0;
+    virtual MatBlock getJ()=0;
+    virtual KBlock getK(const OutDeriv& childForce, bool stabilization=false)=0;
+    virtual void addDForce( InDeriv& df, const InDeriv& dx, const OutDeriv& childForce, const SReal& kfactor )=0;
+};
+
+/** Thin virtual adapter around a concrete jacobian block
+*/
+template<class TBlock>
+class VirtualJacobianBlock : public PolymorphicJacobianBlock<typename TBlock::In,typename TBlock::Out>, public TBlock
+{
+public:
+    typedef PolymorphicJacobianBlock<typename TBlock::In,typename TBlock::Out> Interface;
+    typedef typename Interface::InCoord InCoord;
+    typedef typename Interface::InDeriv InDeriv;
+    typedef typename Interface::OutCoord OutCoord;
+    typedef typename Interface::OutDeriv OutDeriv;
+    typedef typename Interface::MatBlock MatBlock;
+    typedef typename Interface::KBlock KBlock;
+
+    void addapply( OutCoord& result, const InCoord& data ) override { TBlock::addapply(result,data); }
+    void addmult( OutDeriv& result,const InDeriv& data ) override { TBlock::addmult(result,data); }
+    void addMultTranspose( InDeriv& result, const OutDeriv& data ) override { TBlock::addMultTranspose(result,data); }
+    MatBlock getJ() override { return TBlock::getJ(); }
+    KBlock getK(const OutDeriv& childForce, bool stabilization=false) override { return TBlock::getK(childForce,stabilization); }
+    void addDForce( InDeriv& df, const InDeriv& dx, const OutDeriv& childForce, const SReal& kfactor ) override { TBlock::addDForce(df,dx,childForce,kfactor); }
+};
+
+
+
 template<class Real1, class Real2,  Size Dim1, Size Dim2>
 inline type::Mat<Dim1, Dim2, Real2> covMN(const type::Vec<Dim1,Real1>& v1, const type::Vec<Dim2,Real2>& v2)
 {
@@ -191,6 +237,26 @@ inline type::Mat<Dim1, Dim2, Real2> covMN(const type::Vec<Dim1,Real1>& v1, const
     return res;
 }
 
+/// precision conversion, for blocks mapping parents to children of another precision (e.g. double frames to float deformation gradients)
+template<class Real2, class Real1, Size L, Size C>
+inline type::Mat<L, C, Real2> castMat(const type::Mat<L,C,Real1>& m)
+{
+    type::Mat<L, C, Real2> res;
+    for (Size i = 0; i < L; ++i)
+        for ( Size j = 0; j < C; ++j)
+            res[i][j] = (Real2)m[i][j];
+    return res;
+}
+
+/// res += m, with m computed in another precision
+template<class Real1, class Real2, Size L, Size C>
+inline void addCast(type::Mat<L,C,Real1>& res, const type::Mat<L,C,Real2>& m)
+{
+    for (Size i = 0; i < L; ++i)
+        for ( Size j = 0; j < C; ++j)
+            res[i][j] += (Real1)m[i][j];
+}
+
 template<class Real,  Size Dim>
 inline type::MatSym<Dim, Real> covN(const type::Vec<Dim,Real>& v)
 {
@@ -0,0 +1,147 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#ifndef FLEXIBLE_BlockCSRMatrix_H
+#define FLEXIBLE_BlockCSRMatrix_H
+
+#include <vector>
+#include <new>
+#include <cstddef>
+
+namespace sofa
+{
+
+namespace defaulttype
+{
+
+
+/** Minimal allocator returning memory aligned on \p Alignment bytes (cache line by default)
+*/
+template<class T, std::size_t Alignment=64>
+class AlignedAllocator
+{
+public:
+    typedef T value_type;
+    template<class U> struct rebind { typedef AlignedAllocator<U,Alignment> other; };
+
+    AlignedAllocator() noexcept {}
+    template<class U> AlignedAllocator(const AlignedAllocator<U,Alignment>&) noexcept {}
+
+    T* allocate(std::size_t n) { return static_cast<T*>(::operator new(n*sizeof(T), std::align_val_t(Alignment))); }
+    void deallocate(T* p, std::size_t) noexcept { ::operator delete(p, std::align_val_t(Alignment)); }
+};
+
+template<class T, class U, std::size_t Alignment>
+bool operator==(const AlignedAllocator<T,Alignment>&, const AlignedAllocator<U,Alignment>&) { return true; }
+template<class T, class U, std::size_t Alignment>
+bool operator!=(const AlignedAllocator<T,Alignment>&, const AlignedAllocator<U,Alignment>&) { return false; }
+
+
+
+/** Jacobian blocks of a mapping in block compressed row storage.
+  Row i (child i) owns the blocks [rowBegin(i),rowEnd(i)) of two contiguous arrays: the blocks and their column (parent) indices.
+  Compared to vector<vector<Block>>, there is no allocation per child and traversals are linear in memory.
+  For compatibility, jacobian[i][j] and jacobian[i].size() are still available through a light row view.
+*/
+template<class TBlock, std::size_t Alignment=64>
+class BlockCSRMatrix
+{
+public:
+    typedef TBlock Block;
+    typedef std::vector<Block,AlignedAllocator<Block,Alignment> > VecBlock;
+    typedef std::vector<unsigned int,AlignedAllocator<unsigned int,Alignment> > VecIndex;
+
+    /// view on the blocks of one row
+    template<class B>
+    class RowView
+    {
+    public:
+        RowView(B* b, std::size_t n) : _b(b), _n(n) {}
+        std::size_t size() const { return _n; }
+        bool empty() const { return !_n; }
+        B& operator[](std::size_t j) const { return _b[j]; }
+        B* begin() const { return _b; }
+        B* end() const { return _b+_n; }
+    protected:
+        B* _b;
+        std::size_t _n;
+    };
+    typedef RowView<Block> Row;
+    typedef RowView<const Block> ConstRow;
+
+    BlockCSRMatrix() : offsets(1,0) {}
+
+    /// number of rows
+    std::size_t size() const { return offsets.size()-1; }
+    bool empty() const { return !size(); }
+    /// number of stored blocks
+    std::size_t nbBlocks() const { return blocks.size(); }
+
+    void clear() { offsets.assign(1,0); indices.clear(); blocks.clear(); }
+
+    /// set the sparsity pattern of the \p nbRows first rows from a row to column index (index[i][j] is the j-th column of row i).
+    /// Rows missing in \p index are empty. Storage is allocated at once, and reused when the number of blocks does not grow (reinit).
+    /// Blocks are not reset: the previous ones are kept, the new ones are default constructed, and all must be initialized by the caller.
+    template<class VecVRef>
+    void setPattern(const VecVRef& index, std::size_t nbRows)
+    {
+        offsets.resize(nbRows+1);
+        offsets[0]=0;
+        for(std::size_t i=0; i<nbRows; i++) offsets[i+1]=offsets[i]+(i<index.size()?index[i].size():0);
+        indices.resize(offsets.back());
+        for(std::size_t i=0; i<nbRows && i<index.size(); i++) for(std::size_t j=0; j<index[i].size(); j++) indices[offsets[i]+j]=index[i][j];
+        blocks.resize(offsets.back());
+    }
+    template<class VecVRef>
+    void setPattern(const VecVRef& index) { setPattern(index,index.size()); }
+
+    /** @name flat access */
+    //@{
+    std::size_t rowBegin(std::size_t i) const { return offsets[i]; }
+    std::size_t rowEnd(std::size_t i) const { return offsets[i+1]; }
+    unsigned int index(std::size_t k) const { return indices[k]; }
+    Block& block(std::size_t k) { return blocks[k]; }
+    const Block& block(std::size_t k) const { return blocks[k]; }
+    //@}
+
+    /** @name compatibility with vector<vector<Block>> */
+    //@{
+    Row operator[](std::size_t i) { return Row(blocks.data()+offsets[i], offsets[i+1]-offsets[i]); }
+    ConstRow operator[](std::size_t i) const { return ConstRow(blocks.data()+offsets[i], offsets[i+1]-offsets[i]); }
+    //@}
+
+    const VecIndex& getOffsets() const { return offsets; }
+    const VecIndex& getIndices() const { return indices; }
+    const VecBlock& getBlocks() const { return blocks; }
+
+protected:
+    VecIndex offsets;   ///< size()+1 row offsets
+    VecIndex indices;   ///< column index of each block
+    VecBlock blocks;    ///< blocks, stored row after row
+};
+
+
+} // namespace defaulttype
+} // namespace sofa
+
+
+
+#endif
@@ -0,0 +1,89 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include "Flexible_bench.h"
+
+#include <sofa/core/BaseMapping.h>
+#include <sofa/helper/system/PluginManager.h>
+#include <SofaSimulationGraph/init.h>
+#include <SofaSimulationGraph/DAGSimulation.h>
+
+#include <iostream>
+
+namespace sofa {
+namespace flexible_bench {
+
+std::vector<Benchmark>& benchmarks()
+{
+    static std::vector<Benchmark> list;
+    return list;
+}
+
+simulation::Node::SPtr loadScene(const char* scene)
+{
+    std::string fileName = std::string(FLEXIBLE_BENCH_SCENES_DIR) + "/" + scene;
+    return down_cast<simulation::Node>( simulation::getSimulation()->load(fileName.c_str()).get() );
+}
+
+double timeScene(const char* scene, const char* dataName, const char* value, unsigned nbSteps)
+{
+    simulation::Node::SPtr root = loadScene(scene);
+
+    type::vector<core::BaseMapping*> mappings;
+    root->get<core::BaseMapping>(&mappings,core::objectmodel::BaseContext::SearchDown);
+    for(size_t i=0;i<mappings.size();++i)
+        if( core::objectmodel::BaseData* data = mappings[i]->findData(dataName) ) data->read(value);
+
+    simulation::getSimulation()->init(root.get());
+    simulation::getSimulation()->animate(root.get(),0.1);
+
+    Timer timer;
+    for(unsigned l=0;l<nbSteps;++l) simulation::getSimulation()->animate(root.get(),0.1);
+    const double time = timer.seconds();
+
+    simulation::getSimulation()->unload(root);
+    return time;
+}
+
+} // namespace flexible_bench
+} // namespace sofa
+
+
+/// Flexible_bench [filter]: runs the benchmarks whose name contains filter (all of them by default)
+int main(int argc, char** argv)
+{
+    using namespace sofa::flexible_bench;
+
+    sofa::simulation::graph::init();
+    sofa::helper::system::PluginManager::getInstance().loadPlugin("SofaComponentAll");
+    sofa::simulation::setSimulation(new sofa::simulation::graph::DAGSimulation());
+
+    const std::string filter = argc>1 ? argv[1] : "";
+    for(size_t b=0;b<benchmarks().size();++b)
+        if( std::string(benchmarks()[b].name).find(filter)!=std::string::npos )
+        {
+            std::cout<<"== "<<benchmarks()[b].name<<std::endl;
+            benchmarks()[b].function();
+        }
+
+    sofa::simulation::graph::cleanup();
+    return 0;
+}
@@ -0,0 +1,76 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#ifndef FLEXIBLE_BENCH_H
+#define FLEXIBLE_BENCH_H
+
+#include <sofa/simulation/Node.h>
+#include <sofa/simulation/Simulation.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace sofa {
+namespace flexible_bench {
+
+/// benchmarks register themselves with a static RegisterBenchmark, and are run by Flexible_bench [name filter]
+typedef void (*BenchmarkFunction)();
+struct Benchmark
+{
+    const char* name;
+    BenchmarkFunction function;
+};
+std::vector<Benchmark>& benchmarks();
+
+struct RegisterBenchmark
+{
+    RegisterBenchmark(const char* name, BenchmarkFunction function) { benchmarks().push_back( Benchmark{name,function} ); }
+};
+
+/// elapsed time in seconds
+class Timer
+{
+public:
+    Timer() : start(std::chrono::steady_clock::now()) {}
+    double seconds() const { return std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count(); }
+protected:
+    std::chrono::steady_clock::time_point start;
+};
+
+/// thread counts of the scaling benchmarks
+const int nbThreadsArray[] = {1, 4, 16, 32};
+const size_t sizeNbThreadsArray = sizeof(nbThreadsArray)/sizeof(nbThreadsArray[0]);
+
+/// load a scene of the Flexible_test scenes directory
+simulation::Node::SPtr loadScene(const char* scene);
+
+/// time of nbSteps time steps of a scene, set with a data of all its mappings, after one warm-up step
+double timeScene(const char* scene, const char* dataName, const char* value, unsigned nbSteps=10);
+
+} // namespace flexible_bench
+} // namespace sofa
+
+#endif // FLEXIBLE_BENCH_H
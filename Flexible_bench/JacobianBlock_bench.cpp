@@ -0,0 +1,113 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include "Flexible_bench.h"
+
+#include <sofa/defaulttype/VecTypes.h>
+#include "../types/AffineTypes.h"
+#include "../deformationMapping/LinearJacobianBlock_affine.inl"
+
+#include <iostream>
+
+namespace sofa {
+namespace flexible_bench {
+
+using namespace defaulttype;
+
+/**  Jacobian blocks used in the mapping loops: size of the statically dispatched blocks (no vtable) and per-child throughput
+of addapply and addMultTranspose, compared with the same blocks called through the virtual adapter.
+ */
+void jacobianBlock()
+{
+    typedef LinearJacobianBlock<Affine3Types,Vec3Types> Block;
+    typedef VirtualJacobianBlock<Block> VBlock;
+    typedef PolymorphicJacobianBlock<Affine3Types,Vec3Types> PBlock;
+    typedef Block::Real Real;
+    typedef Block::OutCoord OutCoord;
+    typedef Affine3Types::VecCoord InVecCoord;
+    typedef Affine3Types::VecDeriv InVecDeriv;
+    typedef Vec3Types::VecCoord OutVecCoord;
+    typedef Vec3Types::VecDeriv OutVecDeriv;
+
+    const size_t nbChildren = 200000, nbParents = 50, nbRef = 4, nbRepeat = 10;
+
+    std::cout<<"sizeof(LinearJacobianBlock<Affine3,Vec3>)="<<sizeof(Block)<<" (virtual adapter: "<<sizeof(VBlock)<<")"<<std::endl;
+
+    InVecCoord in(nbParents);
+    for(size_t p=0;p<nbParents;++p) { in[p].getCenter()=OutCoord(helper::drand(1),helper::drand(1),helper::drand(1)); in[p].getAffine().identity(); }
+
+    std::vector<unsigned int> index(nbChildren*nbRef);
+    std::vector<Block> blocks(nbChildren*nbRef);
+    std::vector<VBlock> vblocks(nbChildren*nbRef);
+    std::vector<PBlock*> pblocks(nbChildren*nbRef); // the mappings used to hold the blocks through their base class
+    for(size_t k=0;k<blocks.size();++k)
+    {
+        index[k] = (unsigned int)(k%nbParents);
+        blocks[k].Pt = vblocks[k].Pt = (Real)helper::drand(1);
+        blocks[k].Pa = vblocks[k].Pa = OutCoord(helper::drand(1),helper::drand(1),helper::drand(1));
+        pblocks[k] = &vblocks[k];
+    }
+
+    OutVecCoord out(nbChildren);
+    OutVecDeriv f(nbChildren);
+    for(size_t i=0;i<nbChildren;++i) f[i]=OutCoord(helper::drand(1),helper::drand(1),helper::drand(1));
+    InVecDeriv df(nbParents);
+
+    Timer timer;
+    for(size_t r=0;r<nbRepeat;++r)
+        for(size_t i=0;i<nbChildren;++i)
+        {
+            out[i]=OutCoord();
+            for(size_t k=i*nbRef;k<(i+1)*nbRef;++k) blocks[k].addapply(out[i],in[index[k]]);
+        }
+    const double time = timer.seconds();
+
+    timer = Timer();
+    for(size_t r=0;r<nbRepeat;++r)
+        for(size_t i=0;i<nbChildren;++i)
+        {
+            out[i]=OutCoord();
+            for(size_t k=i*nbRef;k<(i+1)*nbRef;++k) pblocks[k]->addapply(out[i],in[index[k]]);
+        }
+    const double vtime = timer.seconds();
+
+    std::cout<<"addapply: "<<nbRepeat*nbChildren/time<<" children/s (virtual adapter: "<<nbRepeat*nbChildren/vtime<<" children/s, speedup "<<vtime/time<<")"<<std::endl;
+
+    timer = Timer();
+    for(size_t r=0;r<nbRepeat;++r)
+        for(size_t i=0;i<nbChildren;++i)
+            for(size_t k=i*nbRef;k<(i+1)*nbRef;++k) blocks[k].addMultTranspose(df[index[k]],f[i]);
+    const double ttime = timer.seconds();
+
+    timer = Timer();
+    for(size_t r=0;r<nbRepeat;++r)
+        for(size_t i=0;i<nbChildren;++i)
+            for(size_t k=i*nbRef;k<(i+1)*nbRef;++k) pblocks[k]->addMultTranspose(df[index[k]],f[i]);
+    const double vttime = timer.seconds();
+
+    std::cout<<"addMultTranspose: "<<nbRepeat*nbChildren/ttime<<" children/s (virtual adapter: "<<nbRepeat*nbChildren/vttime<<" children/s, speedup "<<vttime/ttime<<")"<<std::endl;
+    std::cout<<"checksum "<<out[0]<<" "<<df[0]<<std::endl; // keeps the loops
+}
+
+static RegisterBenchmark jacobianBlockBenchmark("JacobianBlock.LinearAffine3Vec3",jacobianBlock);
+
+} // namespace flexible_bench
+} // namespace sofa
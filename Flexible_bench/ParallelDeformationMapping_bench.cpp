@@ -0,0 +1,61 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include "Flexible_bench.h"
+
+#include <iostream>
+
+namespace sofa {
+namespace flexible_bench {
+
+/**  Speedup of the parallel deformation mappings (applyJ, applyJT and applyDJT run many times per time step in the CG solver).
+The beam of RigidFramesBeamParallelTest.scn, with LinearMappings and strain mappings set with parallel=1, is simulated with 1, 4, 16 and 32 threads.
+The symmetrized geometric stiffness (geometricStiffness=2) goes through the assembly of K (updateK).
+The beam of RigidAffineFramesBeamParallelTest.scn mixes rigid and affine frames, mapped through LinearMultiMappings (BaseDeformationMultiMappingT).
+ */
+void parallelScaling(const char* scene, const char* geometricStiffness)
+{
+#ifdef _OPENMP
+    const int maxThreads = omp_get_max_threads();
+    double timeref = 0;
+    for(size_t t=0;t<sizeNbThreadsArray;++t)
+    {
+        omp_set_num_threads(nbThreadsArray[t]);
+        const double time = timeScene(scene,"geometricStiffness",geometricStiffness);
+        if(t==0) timeref = time;
+        std::cout<<scene<<", geometricStiffness="<<geometricStiffness<<", "<<nbThreadsArray[t]<<" threads: "<<time<<"s (speedup "<<timeref/time<<")"<<std::endl;
+    }
+    omp_set_num_threads(maxThreads);
+#else
+    std::cout<<scene<<": not compiled with OpenMP"<<std::endl;
+#endif
+}
+
+void rigidFramesBeam() { parallelScaling("RigidFramesBeamParallelTest.scn","1"); }
+void rigidFramesBeamSymmetrizedGeometricStiffness() { parallelScaling("RigidFramesBeamParallelTest.scn","2"); }
+void rigidAffineFramesBeam() { parallelScaling("RigidAffineFramesBeamParallelTest.scn","1"); }
+
+static RegisterBenchmark rigidFramesBeamBenchmark("ParallelDeformationMapping.RigidFramesBeam",rigidFramesBeam);
+static RegisterBenchmark rigidFramesBeamSymmetrizedBenchmark("ParallelDeformationMapping.RigidFramesBeamSymmetrizedGeometricStiffness",rigidFramesBeamSymmetrizedGeometricStiffness);
+static RegisterBenchmark rigidAffineFramesBeamBenchmark("ParallelDeformationMapping.RigidAffineFramesBeam",rigidAffineFramesBeam);
+
+} // namespace flexible_bench
+} // namespace sofa
@@ -0,0 +1,112 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include "stdafx.h"
+#include "BeamSceneFixture.h"
+#include <sofa/defaulttype/RigidTypes.h>
+
+#include "../deformationMapping/LinearMapping.h"
+
+namespace sofa {
+
+using namespace defaulttype;
+using namespace component::mapping;
+
+
+/**  Inversion of a deformation mapping (Rigid3->F331) of a deformed beam, for a batch of points.
+Points between the rest positions of the gauss points (inside the beam) are mapped forward, then inverted all at once:
+all the rest positions must be recovered.
+Batched closest point queries must match an exhaustive search, also after the beam has moved.
+ */
+struct BackwardMapping_test : public BeamSceneFixture<5> // bent beam
+{
+    typedef LinearMapping<Rigid3Types,F331Types> Mapping;
+    typedef Mapping::Coord Coord;
+
+    bool testBatch(Mapping* mapping)
+    {
+        if( !mapping ) { ADD_FAILURE() << "mapping not found" << std::endl; return false; }
+
+        const type::vector<Coord> pos0 = mapping->getInitPositions();
+        type::vector<Coord> q0, p;
+        for(size_t i=0;i+1<pos0.size();++i)
+        {
+            q0.push_back( (pos0[i]+pos0[i+1])*0.5 );
+            Coord x; mapping->ForwardMapping(x,q0.back());
+            p.push_back(x);
+        }
+
+        // the residual is below epsilon at convergence, and the deformation gradients of the bent beam are close to rotations
+        const SReal epsilon = 1e-8;
+        type::vector<Coord> p0;
+        mapping->BackwardMapping(p0,p,epsilon*epsilon,20);
+        if( p0.size()!=p.size() ) { ADD_FAILURE() << "wrong size" << std::endl; return false; }
+
+        for(size_t i=0;i<p.size();++i)
+        {
+            if( !p0[i][0] && !p0[i][1] && !p0[i][2] ) { ADD_FAILURE() << "point "<<i<<": "<<q0[i]<<" found outside the beam" << std::endl; return false; }
+            if( (p0[i]-q0[i]).norm()>epsilon )
+            {
+                ADD_FAILURE() << "point "<<i<<": rest position "<<p0[i]<<" instead of "<<q0[i]<< std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool testClosestPoints(Mapping* mapping)
+    {
+        if( !mapping ) { ADD_FAILURE() << "mapping not found" << std::endl; return false; }
+
+        type::vector<Coord> p, x0, x;
+        type::vector<unsigned int> index;
+        for(size_t i=0;i<500;++i) p.push_back(Coord(helper::drand(2),helper::drand(2),helper::drand(2)));
+
+        for(unsigned int step=0;step<2;++step)
+        {
+            mapping->getClosestMappedPoints(p,x0,x,index);
+            for(size_t i=0;i<p.size();++i)
+            {
+                Coord y0,y;
+                const unsigned int expected = mapping->getClosestMappedPoint(p[i],y0,y,false); // exhaustive search
+                if( (x[i]-p[i]).norm2() > (y-p[i]).norm2() || x0[i]!=mapping->getInitPositions()[index[i]] )
+                {
+                    ADD_FAILURE() << "point "<<i<<": closest mapped point "<<index[i]<<" instead of "<<expected<< std::endl;
+                    return false;
+                }
+            }
+            simulation->animate(root.get(),0.1); // the tree is refit
+        }
+        return true;
+    }
+};
+
+TEST_F( BackwardMapping_test , RigidFramesBeam )
+{
+    ASSERT_TRUE( this->testBatch( root->get<Mapping>(core::objectmodel::BaseContext::SearchDown) ) );
+}
+
+TEST_F( BackwardMapping_test , ClosestMappedPoints )
+{
+    ASSERT_TRUE( this->testClosestPoints( root->get<Mapping>(core::objectmodel::BaseContext::SearchDown) ) );
+}
+
+} // namespace sofa
@@ -0,0 +1,59 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#ifndef FLEXIBLE_TEST_BeamSceneFixture_H
+#define FLEXIBLE_TEST_BeamSceneFixture_H
+
+#include <SofaTest/Sofa_test.h>
+
+//Including Simulation
+#include <SofaSimulationGraph/DAGSimulation.h>
+
+namespace sofa {
+
+/**  Fixture loading the beam of RigidFramesBeamParallelTest.scn (rigid frames, LinearMappings to F331 and Vec3, corotational strain),
+initialized and animated for nbSteps time steps: one step gives non trivial parent positions, a few steps a bent beam.
+ */
+template <unsigned int nbSteps>
+struct BeamSceneFixture : public Sofa_test<SReal>
+{
+    /// Simulation
+    simulation::Simulation* simulation;
+    simulation::Node::SPtr root;
+
+    void SetUp() override
+    {
+        sofa::simulation::setSimulation(simulation = new sofa::simulation::graph::DAGSimulation());
+        std::string fileName = std::string(FLEXIBLE_TEST_SCENES_DIR) + "/" + "RigidFramesBeamParallelTest.scn";
+        root = down_cast<sofa::simulation::Node>( simulation->load(fileName.c_str()).get() );
+        simulation->init(root.get());
+        for(unsigned int l=0;l<nbSteps;++l) simulation->animate(root.get(),0.1);
+    }
+
+    void TearDown() override
+    {
+        if(root) simulation->unload(root);
+    }
+};
+
+} // namespace sofa
+
+#endif // FLEXIBLE_TEST_BeamSceneFixture_H
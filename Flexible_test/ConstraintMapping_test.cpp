@@ -0,0 +1,121 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include "stdafx.h"
+#include "BeamSceneFixture.h"
+#include <sofa/defaulttype/RigidTypes.h>
+#include <sofa/core/MechanicalParams.h>
+#include <sofa/core/ConstraintParams.h>
+
+#include "../deformationMapping/LinearMapping.h"
+
+namespace sofa {
+
+using namespace defaulttype;
+using namespace component::mapping;
+
+
+/**  Constraint rows through a deformation mapping (Rigid3->Vec3) of a beam.
+Each row involves a few neighbouring points, so that they share parents. Each parent must appear once per row of the result,
+and the rows must match the products with the transposed jacobian (applyJT of the corresponding force vectors).
+ */
+struct ConstraintMapping_test : public BeamSceneFixture<1> // non trivial parent positions
+{
+    typedef LinearMapping<Rigid3Types,Vec3Types> Mapping;
+    typedef Rigid3Types::MatrixDeriv InMatrixDeriv;
+    typedef Vec3Types::MatrixDeriv OutMatrixDeriv;
+    typedef Rigid3Types::VecDeriv InVecDeriv;
+    typedef Vec3Types::VecDeriv OutVecDeriv;
+
+    static const size_t nbRows = 500;
+    static const size_t nbColsPerRow = 4;
+
+    bool testRows(Mapping* mapping, bool parallel)
+    {
+        if( !mapping ) { ADD_FAILURE() << "mapping not found" << std::endl; return false; }
+        mapping->d_parallel.setValue(parallel);
+
+        const size_t inSize = mapping->getFromModel()->getSize(), outSize = mapping->getToModel()->getSize();
+
+        // random rows on neighbouring points
+        Data<OutMatrixDeriv> c;
+        type::vector<OutVecDeriv> forces(nbRows,OutVecDeriv(outSize));
+        {
+            OutMatrixDeriv& cm = *c.beginEdit();
+            for(size_t r=0;r<nbRows;++r)
+            {
+                OutMatrixDeriv::RowIterator row = cm.writeLine(r);
+                const size_t first = std::rand()%(outSize-nbColsPerRow);
+                for(size_t j=0;j<nbColsPerRow;++j)
+                {
+                    const Vec3Types::Deriv v(helper::drand(1),helper::drand(1),helper::drand(1));
+                    row.addCol(first+j,v);
+                    forces[r][first+j] += v;
+                }
+            }
+            c.endEdit();
+        }
+
+        Data<InMatrixDeriv> dc;
+        mapping->applyJT(core::ConstraintParams::defaultInstance(),dc,c);
+
+        size_t nbRowsOut = 0;
+        const InMatrixDeriv& dcm = dc.getValue();
+        for(InMatrixDeriv::RowConstIterator rowIt=dcm.begin(); rowIt!=dcm.end(); ++rowIt, ++nbRowsOut)
+        {
+            const size_t r = rowIt.index();
+            if( r>=nbRows ) { ADD_FAILURE() << "unexpected row "<<r<< std::endl; return false; }
+
+            // reference: J^T.f
+            Data<InVecDeriv> fref; fref.beginEdit()->resize(inSize); fref.endEdit();
+            Data<OutVecDeriv> fc; fc.setValue(forces[r]);
+            mapping->applyJT(core::MechanicalParams::defaultInstance(),fref,fc);
+
+            InVecDeriv f(inSize);
+            type::vector<unsigned char> seen(inSize,0);
+            for(InMatrixDeriv::ColConstIterator colIt=rowIt.begin(); colIt!=rowIt.end(); ++colIt)
+            {
+                if( seen[colIt.index()] ) { ADD_FAILURE() << "row "<<r<<": parent "<<colIt.index()<<" appears several times"<< std::endl; return false; }
+                seen[colIt.index()]=1;
+                f[colIt.index()] = colIt.val();
+            }
+
+            for(size_t p=0;p<inSize;++p)
+                for(size_t k=0;k<Rigid3Types::Deriv::total_size;++k)
+                    if( std::abs(f[p][k]-fref.getValue()[p][k]) > 1e-10*(1+std::abs(fref.getValue()[p][k])) )
+                    {
+                        ADD_FAILURE() << "row "<<r<<", parent "<<p<<": "<<f[p]<<" instead of "<<fref.getValue()[p]<< std::endl;
+                        return false;
+                    }
+        }
+        if( nbRowsOut!=nbRows ) { ADD_FAILURE() << nbRowsOut <<" rows instead of "<<nbRows<< std::endl; return false; }
+        return true;
+    }
+};
+
+TEST_F( ConstraintMapping_test , RigidFramesBeam )
+{
+    Mapping* mapping = root->get<Mapping>(core::objectmodel::BaseContext::SearchDown);
+    ASSERT_TRUE( this->testRows(mapping,false) );
+    ASSERT_TRUE( this->testRows(mapping,true) );
+}
+
+} // namespace sofa
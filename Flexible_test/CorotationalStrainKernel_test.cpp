@@ -0,0 +1,125 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include "stdafx.h"
+#include <SofaTest/Sofa_test.h>
+#include <sofa/type/Mat.h>
+#include "../strainMapping/CorotationalStrainKernel.h"
+
+namespace sofa {
+
+using namespace defaulttype;
+
+
+/**  Check the batched 3x3 svd, for each instruction set supported by the cpu: F = U.diag(S).V^T with rotations U and V,
+singular values sorted by decreasing magnitude, and a negative smallest singular value for inverted matrices.
+The matrices are random, inverted, flat or exactly diagonal, and their number is not a multiple of the batch size.
+ */
+struct CorotationalStrainKernel_test : public Sofa_test<SReal>
+{
+    typedef SReal Real;
+    typedef type::Mat<3,3,Real> Mat3;
+
+    static const size_t nbMatrices = 100003;
+
+    std::vector<Mat3> F;
+
+    void SetUp() override
+    {
+        F.resize(nbMatrices);
+        for(size_t i=0;i<nbMatrices;++i)
+        {
+            Mat3& f = F[i];
+            switch(i%5)
+            {
+            case 0: f.identity(); f[0][0]=(Real)(1+i%7); f[2][2]=(Real)0.5; break; // diagonal, with repeated singular values
+            case 1: for(unsigned r=0;r<3;r++) f[r] = Mat3::Line(helper::drand(1),helper::drand(1),helper::drand(1)); f[1]=f[0]*(Real)2-f[2]; break; // flat
+            default:
+                for(unsigned r=0;r<3;r++) for(unsigned c=0;c<3;c++) f[r][c] = (r==c?(Real)1:(Real)0) + (Real)helper::drand(0.5);
+                if(i%5==4) f[2]=-f[2]; // inverted
+            }
+        }
+    }
+
+    void TearDown() override
+    {
+        simd::setSimdLevel(simd::SIMD_AVX512); // back to the best level supported by the cpu
+    }
+
+    static Real maxAbs(const Mat3& M)
+    {
+        Real m=0;
+        for(unsigned r=0;r<3;r++) for(unsigned c=0;c<3;c++) m=std::max(m,std::abs(M[r][c]));
+        return m;
+    }
+
+    static bool isRotation(const Mat3& R)
+    {
+        const Mat3 I = R.multTranspose(R);
+        for(unsigned r=0;r<3;r++) for(unsigned c=0;c<3;c++) if( std::abs(I[r][c]-(r==c?1:0)) > 1e-10 ) return false;
+        return std::abs(type::determinant(R)-1) < 1e-10;
+    }
+
+    bool testLevel(simd::SimdLevel level)
+    {
+        level = simd::setSimdLevel(level);
+
+        std::vector<Mat3> U(nbMatrices), V(nbMatrices);
+        std::vector<type::Vec<3,Real> > S(nbMatrices);
+
+        corotational::svd(U[0][0].ptr(),S[0].ptr(),V[0][0].ptr(),F[0][0].ptr(),nbMatrices); // contiguous row major matrices
+
+        for(size_t i=0;i<nbMatrices;++i)
+        {
+            Mat3 US = U[i];
+            for(unsigned r=0;r<3;r++) for(unsigned c=0;c<3;c++) US[r][c]*=S[i][c];
+            const Mat3 f = US.multTransposed(V[i]);
+            const Real det = type::determinant(F[i]);
+
+            if( maxAbs(f-F[i]) > 1e-10*(1+maxAbs(F[i])) )
+            { ADD_FAILURE() << simd::getSimdLevelName(level) << " matrix "<<i<<": U.S.V^T = "<<f<<" instead of "<<F[i]<< std::endl; return false; }
+            if( !isRotation(U[i]) || !isRotation(V[i]) )
+            { ADD_FAILURE() << simd::getSimdLevelName(level) << " matrix "<<i<<": U="<<U[i]<<", V="<<V[i]<<" are not rotations"<< std::endl; return false; }
+            if( S[i][0]<S[i][1] || S[i][1]<std::abs(S[i][2])-1e-10 )
+            { ADD_FAILURE() << simd::getSimdLevelName(level) << " matrix "<<i<<": unsorted singular values "<<S[i]<< std::endl; return false; }
+            if( std::abs(det)>1e-6 && (det<0) != (S[i][2]<0) )
+            { ADD_FAILURE() << simd::getSimdLevelName(level) << " matrix "<<i<<": singular values "<<S[i]<<" for det="<<det<< std::endl; return false; }
+        }
+        return true;
+    }
+};
+
+TEST_F( CorotationalStrainKernel_test , scalar )
+{
+    ASSERT_TRUE( this->testLevel(simd::SIMD_SCALAR) );
+}
+
+TEST_F( CorotationalStrainKernel_test , avx2 )
+{
+    ASSERT_TRUE( this->testLevel(simd::SIMD_AVX2) );
+}
+
+TEST_F( CorotationalStrainKernel_test , avx512 )
+{
+    ASSERT_TRUE( this->testLevel(simd::SIMD_AVX512) );
+}
+
+} // namespace sofa
@@ -22,7 +22,7 @@ namespace sofa {
 
 
 
-        bool runTest( unsigned method )
+        bool runTest( unsigned method, bool simd=false )
         {
             this->deltaRange = std::make_pair( 100, 10000 );
             this->errorMax = this->deltaRange.second*2;
@@ -30,6 +30,7 @@ namespace sofa {
 
             static_cast<_Mapping*>(this->mapping)->f_geometricStiffness.setValue(1);
             static_cast<_Mapping*>(this->mapping)->f_method.beginEdit()->setSelectedItem( method );
+            static_cast<_Mapping*>(this->mapping)->d_simd.setValue( simd );
 
             type::Mat<3,3,Real> rotation;
             type::Mat<In::material_dimensions,In::material_dimensions,Real> symGradDef; // local frame with only stretch and shear and no rotation
@@ -79,6 +80,162 @@ namespace sofa {
     {
         ASSERT_TRUE( this->runTest( 3 ) ); // svd
     }
+    TYPED_TEST( CorotationalStrainMappingTest , polarSimd )
+    {
+        ASSERT_TRUE( this->runTest( 0, true ) ); // batched polar (3D deformation gradients only)
+    }
+    TYPED_TEST( CorotationalStrainMappingTest , svdSimd )
+    {
+        ASSERT_TRUE( this->runTest( 3, true ) ); // batched svd (3D deformation gradients only)
+    }
+
+
+    /// The standalone entry points apply(dOut,dIn) and applyJ(dOut,dIn) keep their jacobian blocks between calls.
+    /// Their results must be the ones of freshly created mappings, also when the number of deformation gradients changes.
+    /// The batched decompositions (simd) are compared with the default ones.
+    struct CorotationalStrainMappingStandalone_test : public Sofa_test<SReal>
+    {
+        typedef CorotationalStrainMapping<defaulttype::F331Types,defaulttype::E331Types> Mapping;
+        typedef Mapping::Inherit BaseMapping; // standalone entry points
+        typedef BaseMapping::InVecCoord InVecCoord;
+        typedef BaseMapping::InVecDeriv InVecDeriv;
+        typedef BaseMapping::OutVecCoord OutVecCoord;
+        typedef BaseMapping::OutVecDeriv OutVecDeriv;
+
+        static Mapping::SPtr create( unsigned method, bool simd=false )
+        {
+            Mapping::SPtr m = core::objectmodel::New<Mapping>();
+            m->f_method.beginEdit()->setSelectedItem( method );
+            m->f_method.endEdit();
+            m->d_simd.setValue( simd );
+            return m;
+        }
+
+        template<class V> static void randomize( V& v, size_t n, SReal identity )
+        {
+            v.resize(n);
+            for( size_t i=0 ; i<n ; ++i )
+                for( unsigned int j=0 ; j<3 ; ++j )
+                    for( unsigned int k=0 ; k<3 ; ++k )
+                        v[i].getF()[j][k] = (j==k?identity:0) + helper::drand(0.3);
+        }
+
+        template<class V> bool compare( const V& v, const V& vref, const char* name, SReal tolerance=1e-10 )
+        {
+            if( v.size()!=vref.size() ) { ADD_FAILURE() << name << ": size "<<v.size()<<" instead of "<<vref.size()<< std::endl; return false; }
+            for( size_t i=0 ; i<v.size() ; ++i )
+                if( (v[i].getVec()-vref[i].getVec()).norm() > tolerance )
+                {
+                    ADD_FAILURE() << name << " " << i << ": " << v[i] << " instead of " << vref[i] << std::endl;
+                    return false;
+                }
+            return true;
+        }
+
+        bool runTest( unsigned method, bool simd=false )
+        {
+            Mapping::SPtr cached = create( method, simd );
+            const size_t sizes[] = { 10, 10, 20, 5, 150 };
+            for( size_t t=0 ; t<sizeof(sizes)/sizeof(sizes[0]) ; ++t )
+            {
+                const size_t n = sizes[t];
+                Data<InVecCoord> x; randomize( *x.beginEdit(), n, 1 ); x.endEdit();
+                Data<InVecDeriv> dx; randomize( *dx.beginEdit(), n, 0 ); dx.endEdit();
+
+                Data<OutVecCoord> y, yref; y.beginEdit()->resize(n); y.endEdit(); yref.beginEdit()->resize(n); yref.endEdit();
+                Data<OutVecDeriv> dy, dyref; dy.beginEdit()->resize(n); dy.endEdit(); dyref.beginEdit()->resize(n); dyref.endEdit();
+
+                BaseMapping* m = cached.get();
+                m->apply( y, x );
+                m->applyJ( dy, dx );
+
+                Mapping::SPtr fresh = create( method );
+                BaseMapping* mref = fresh.get();
+                mref->apply( yref, x );
+                mref->applyJ( dyref, dx );
+
+                if( !compare( y.getValue(), yref.getValue(), "apply" ) ) return false;
+                if( !compare( dy.getValue(), dyref.getValue(), "applyJ" ) ) return false;
+            }
+            return true;
+        }
+    };
+
+    TEST_F( CorotationalStrainMappingStandalone_test , polar )
+    {
+        ASSERT_TRUE( this->runTest( 0 ) ); // polar
+    }
+    TEST_F( CorotationalStrainMappingStandalone_test , svd )
+    {
+        ASSERT_TRUE( this->runTest( 3 ) ); // svd
+    }
+    TEST_F( CorotationalStrainMappingStandalone_test , polarSimd )
+    {
+        ASSERT_TRUE( this->runTest( 0, true ) ); // polar
+    }
+    TEST_F( CorotationalStrainMappingStandalone_test , svdSimd )
+    {
+        ASSERT_TRUE( this->runTest( 3, true ) ); // svd
+    }
+
+
+    /// Decompositions reused over small changes of the deformation gradients: warm started ones must match the decompositions
+    /// from scratch, skipped ones must be close to them, and the statistics must count the reused rotations.
+    /// The svd warm start is bypassed when dR/dF is needed (geometric stiffness): those rotations are counted as decomposed.
+    struct CorotationalStrainMappingIncremental_test : public CorotationalStrainMappingStandalone_test
+    {
+        bool runTest( unsigned method, bool warmStart, SReal skipTolerance, bool geometricStiffness=false )
+        {
+            Mapping::SPtr m = create( method );
+            m->f_geometricStiffness.setValue( geometricStiffness );
+            m->d_warmStart.setValue( warmStart );
+            m->d_skipTolerance.setValue( skipTolerance );
+            Mapping::SPtr mref = create( method );
+
+            const size_t n = 100;
+            Data<InVecCoord> x; randomize( *x.beginEdit(), n, 1 ); x.endEdit();
+            for( size_t step=0 ; step<5 ; ++step )
+            {
+                if( step )
+                {
+                    helper::WriteAccessor< Data<InVecCoord> > xw( x );
+                    for( size_t i=0 ; i<n ; ++i ) for( unsigned int j=0 ; j<3 ; ++j ) for( unsigned int k=0 ; k<3 ; ++k ) xw[i].getF()[j][k] += helper::drand(1e-4);
+                }
+
+                Data<OutVecCoord> y, yref; y.beginEdit()->resize(n); y.endEdit(); yref.beginEdit()->resize(n); yref.endEdit();
+                static_cast<BaseMapping*>(m.get())->apply( y, x );
+                static_cast<BaseMapping*>(mref.get())->apply( yref, x );
+                if( !compare( y.getValue(), yref.getValue(), "apply", skipTolerance>0 ? 1e-2 : 1e-8 ) ) return false;
+
+                const type::Vec<3,unsigned int>& stats = m->d_rotationStatistics.getValue(); // skipped, warm started, decomposed
+                const bool decomposed = !step || ( skipTolerance<=0 && method==3 && geometricStiffness );
+                const type::Vec<3,unsigned int> expected = decomposed ? type::Vec<3,unsigned int>(0,0,n) : skipTolerance>0 ? type::Vec<3,unsigned int>(n,0,0) : type::Vec<3,unsigned int>(0,n,0);
+                if( stats != expected ) { ADD_FAILURE() << "step " << step << ": statistics " << stats << " instead of " << expected << std::endl; return false; }
+            }
+            return true;
+        }
+    };
+
+    TEST_F( CorotationalStrainMappingIncremental_test , polarWarmStart )
+    {
+        ASSERT_TRUE( this->runTest( 0, true, 0 ) ); // polar
+    }
+    TEST_F( CorotationalStrainMappingIncremental_test , svdWarmStart )
+    {
+        ASSERT_TRUE( this->runTest( 3, true, 0 ) ); // svd
+    }
+    TEST_F( CorotationalStrainMappingIncremental_test , polarSkip )
+    {
+        ASSERT_TRUE( this->runTest( 0, false, 1e-2 ) ); // polar, all the changes are below the tolerance
+    }
+    TEST_F( CorotationalStrainMappingIncremental_test , svdSkip )
+    {
+        ASSERT_TRUE( this->runTest( 3, false, 1e-2 ) ); // svd, all the changes are below the tolerance
+    }
+    TEST_F( CorotationalStrainMappingIncremental_test , svdWarmStartGeometricStiffness )
+    {
+        ASSERT_TRUE( this->runTest( 3, true, 0, true ) ); // svd, dR/dF needed: decomposed from scratch
+    }
 
 
 // precision is not good enough
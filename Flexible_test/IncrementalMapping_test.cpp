@@ -0,0 +1,170 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include "stdafx.h"
+#include "BeamSceneFixture.h"
+#include <sofa/defaulttype/RigidTypes.h>
+#include <sofa/core/MechanicalParams.h>
+
+#include "../deformationMapping/LinearMapping.h"
+
+namespace sofa {
+
+using namespace defaulttype;
+using namespace component::mapping;
+
+
+/**  Incremental apply of the linear mappings of a beam (Rigid3->F331 and Rigid3->Vec3).
+After moving a single frame, only the children it influences must be recomputed,
+and the result must be the same as a full apply.
+With a subset of active children, the inactive ones must keep their value until they are reactivated.
+ */
+struct IncrementalMapping_test : public BeamSceneFixture<1> // non trivial parent positions
+{
+    template<class Mapping>
+    bool testMapping(Mapping* mapping)
+    {
+        typedef typename Mapping::InVecCoord InVecCoord;
+        typedef typename Mapping::OutVecCoord OutVecCoord;
+        typedef typename Mapping::OutCoord OutCoord;
+        typedef typename Mapping::InVecDeriv InVecDeriv;
+        typedef typename Mapping::OutVecDeriv OutVecDeriv;
+        typedef typename Mapping::InDeriv InDeriv;
+
+        if( !mapping ) { ADD_FAILURE() << "mapping not found" << std::endl; return false; }
+        mapping->d_incremental.setValue(true);
+
+        const core::MechanicalParams* mparams = core::MechanicalParams::defaultInstance();
+        Data<InVecCoord> in; in.setValue(mapping->getFromModel()->read(core::ConstVecCoordId::position())->getValue());
+        Data<OutVecCoord> out, ref;
+
+        mapping->apply(mparams,out,in); // first call: full apply
+        if( mapping->d_updatedChildren.getValue()!=1 ) { ADD_FAILURE() << "first apply is not complete" << std::endl; return false; }
+
+        mapping->apply(mparams,out,in); // nothing moved
+        if( mapping->d_updatedChildren.getValue()!=0 ) { ADD_FAILURE() << "static parents: "<<mapping->d_updatedChildren.getValue()<<" children updated" << std::endl; return false; }
+
+        in.beginEdit()->front().getCenter() += Vec3(0.1,-0.2,0.3); in.endEdit();
+        mapping->apply(mparams,out,in);
+        const SReal ratio = mapping->d_updatedChildren.getValue();
+        if( ratio<=0 || ratio>=1 ) { ADD_FAILURE() << "one parent moved: "<<ratio<<" children updated" << std::endl; return false; }
+
+        mapping->apply(mparams,ref,in); // other output: full apply
+        const OutVecCoord& o = out.getValue(), & r = ref.getValue();
+        for(size_t i=0;i<r.size();++i) for(size_t c=0;c<OutCoord::total_size;++c)
+            if( std::abs(o[i][c]-r[i][c]) > 1e-10*(1+std::abs(r[i][c])) )
+            {
+                ADD_FAILURE() << "child "<<i<<": "<<o[i]<<" instead of "<<r[i]<< std::endl;
+                return false;
+            }
+        return true;
+    }
+
+    template<class Mapping>
+    bool testActiveChildren(Mapping* mapping)
+    {
+        typedef typename Mapping::InVecCoord InVecCoord;
+        typedef typename Mapping::OutVecCoord OutVecCoord;
+        typedef typename Mapping::OutCoord OutCoord;
+
+        if( !mapping ) { ADD_FAILURE() << "mapping not found" << std::endl; return false; }
+        mapping->d_incremental.setValue(true);
+
+        const core::MechanicalParams* mparams = core::MechanicalParams::defaultInstance();
+        Data<InVecCoord> in; in.setValue(mapping->getFromModel()->read(core::ConstVecCoordId::position())->getValue());
+        Data<OutVecCoord> out, ref;
+
+        mapping->apply(mparams,out,in);
+        const OutVecCoord initial = out.getValue();
+
+        // even children only, while all the parents move
+        type::vector<unsigned int> active;
+        for(unsigned int i=0;i<initial.size();i+=2) active.push_back(i);
+        mapping->d_activeChildren.setValue(active);
+
+        InVecCoord& x = *in.beginEdit();
+        for(size_t p=0;p<x.size();++p) x[p].getCenter() += Vec3(0.1,-0.2,0.3);
+        in.endEdit();
+        mapping->apply(mparams,out,in);
+        const OutVecCoord masked = out.getValue();
+
+        // the entry points without mparams follow the same mask
+        OutVecCoord direct = initial;
+        mapping->apply(direct,in.getValue());
+        InVecDeriv v(in.getValue().size());
+        for(size_t p=0;p<v.size();++p) v[p] = InDeriv(Vec3(helper::drand(1),helper::drand(1),helper::drand(1)),Vec3(helper::drand(1),helper::drand(1),helper::drand(1)));
+        OutVecDeriv dv(initial.size());
+        mapping->applyJ(dv,v);
+        Data<InVecDeriv> dIn; dIn.setValue(v);
+        Data<OutVecDeriv> dOut; dOut.setValue(OutVecDeriv(initial.size()));
+        mapping->applyJ(mparams,dOut,dIn);
+        for(size_t i=0;i<initial.size();++i)
+            if( (direct[i]-masked[i]).norm() > 1e-10*(1+masked[i].norm()) || (dv[i]-dOut.getValue()[i]).norm() > 1e-10*(1+dv[i].norm()) )
+            {
+                ADD_FAILURE() << "child "<<i<<": apply/applyJ without mparams give "<<direct[i]<<" / "<<dv[i]<<" instead of "<<masked[i]<<" / "<<dOut.getValue()[i]<< std::endl;
+                return false;
+            }
+
+        // reactivate all the children: the odd ones are caught up although the parents do not move
+        mapping->d_activeChildren.setValue(type::vector<unsigned int>());
+        mapping->apply(mparams,out,in);
+        const SReal ratio = mapping->d_updatedChildren.getValue();
+        if( ratio<=0 || ratio>=1 ) { ADD_FAILURE() << "reactivation: "<<ratio<<" children updated" << std::endl; return false; }
+
+        mapping->apply(mparams,ref,in); // other output: full apply
+        const OutVecCoord& r = ref.getValue();
+        for(size_t i=0;i<r.size();++i)
+        {
+            const OutCoord& expected = i%2 ? initial[i] : r[i];
+            for(size_t c=0;c<OutCoord::total_size;++c)
+            {
+                if( std::abs(masked[i][c]-expected[c]) > 1e-10*(1+std::abs(expected[c])) )
+                {
+                    ADD_FAILURE() << (i%2?"inactive":"active") << " child "<<i<<": "<<masked[i]<<" instead of "<<expected<< std::endl;
+                    return false;
+                }
+                if( std::abs(out.getValue()[i][c]-r[i][c]) > 1e-10*(1+std::abs(r[i][c])) )
+                {
+                    ADD_FAILURE() << "reactivated child "<<i<<": "<<out.getValue()[i]<<" instead of "<<r[i]<< std::endl;
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+};
+
+TEST_F( IncrementalMapping_test , DeformationGradients )
+{
+    ASSERT_TRUE( this->testMapping( root->get<LinearMapping<Rigid3Types,F331Types> >(core::objectmodel::BaseContext::SearchDown) ) );
+}
+
+TEST_F( IncrementalMapping_test , Points )
+{
+    ASSERT_TRUE( this->testMapping( root->get<LinearMapping<Rigid3Types,Vec3Types> >(core::objectmodel::BaseContext::SearchDown) ) );
+}
+
+TEST_F( IncrementalMapping_test , ActivePoints )
+{
+    ASSERT_TRUE( this->testActiveChildren( root->get<LinearMapping<Rigid3Types,Vec3Types> >(core::objectmodel::BaseContext::SearchDown) ) );
+}
+
+} // namespace sofa
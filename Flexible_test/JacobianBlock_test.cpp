@@ -0,0 +1,110 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include "stdafx.h"
+#include <SofaTest/Sofa_test.h>
+#include <sofa/defaulttype/VecTypes.h>
+#include "../types/AffineTypes.h"
+#include "../deformationMapping/LinearJacobianBlock_affine.inl"
+
+namespace sofa {
+
+using namespace defaulttype;
+
+
+/**  Jacobian blocks used in the mapping loops.
+Check that blocks carry no vtable (their size is the size of their payload), and that the statically dispatched blocks
+(as used by the mappings) give the same result as the same blocks called through the virtual adapter.
+Their throughput is compared by the JacobianBlock benchmark of Flexible_bench.
+ */
+struct JacobianBlock_test : public Sofa_test<SReal>
+{
+    typedef LinearJacobianBlock<Affine3Types,Vec3Types> Block;
+    typedef VirtualJacobianBlock<Block> VBlock;
+    typedef PolymorphicJacobianBlock<Affine3Types,Vec3Types> PBlock;
+    typedef Block::Real Real;
+    typedef Block::OutCoord OutCoord;
+    typedef Affine3Types::VecCoord InVecCoord;
+    typedef Vec3Types::VecCoord OutVecCoord;
+
+    static const size_t nbChildren = 1000;
+    static const size_t nbParents = 50;
+    static const size_t nbRef = 4;
+
+    bool testBlockSize()
+    {
+        if( sizeof(Block) != sizeof(Real)+sizeof(OutCoord) )
+        {
+            ADD_FAILURE() << "LinearJacobianBlock<Affine3,Vec3> has an unexpected size: "<<sizeof(Block)<<" instead of "<<sizeof(Real)+sizeof(OutCoord)<< std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    bool testDispatch()
+    {
+        InVecCoord in(nbParents);
+        for(size_t p=0;p<nbParents;++p) { in[p].getCenter()=OutCoord(helper::drand(1),helper::drand(1),helper::drand(1)); in[p].getAffine().identity(); }
+
+        std::vector<unsigned int> index(nbChildren*nbRef);
+        std::vector<Block> blocks(nbChildren*nbRef);
+        std::vector<VBlock> vblocks(nbChildren*nbRef);
+        for(size_t k=0;k<blocks.size();++k)
+        {
+            index[k] = (unsigned int)(k%nbParents);
+            blocks[k].Pt = vblocks[k].Pt = (Real)helper::drand(1);
+            blocks[k].Pa = vblocks[k].Pa = OutCoord(helper::drand(1),helper::drand(1),helper::drand(1));
+        }
+
+        OutVecCoord out(nbChildren), vout(nbChildren);
+
+        for(size_t i=0;i<nbChildren;++i)
+        {
+            out[i]=OutCoord();
+            for(size_t k=i*nbRef;k<(i+1)*nbRef;++k) blocks[k].addapply(out[i],in[index[k]]);
+        }
+        for(size_t i=0;i<nbChildren;++i)
+        {
+            vout[i]=OutCoord();
+            for(size_t k=i*nbRef;k<(i+1)*nbRef;++k) static_cast<PBlock&>(vblocks[k]).addapply(vout[i],in[index[k]]);
+        }
+
+        for(size_t i=0;i<nbChildren;++i)
+            if( out[i]!=vout[i] )
+            {
+                ADD_FAILURE() << "Child "<<i<<": statically and dynamically dispatched blocks differ: "<<out[i]<<" / "<<vout[i]<< std::endl;
+                return false;
+            }
+        return true;
+    }
+};
+
+TEST_F( JacobianBlock_test , blockSize )
+{
+    ASSERT_TRUE( this->testBlockSize() );
+}
+
+TEST_F( JacobianBlock_test , dispatch )
+{
+    ASSERT_TRUE( this->testDispatch() );
+}
+
+} // namespace sofa
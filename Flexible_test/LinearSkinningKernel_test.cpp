@@ -0,0 +1,238 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include "stdafx.h"
+#include <SofaTest/Sofa_test.h>
+#include <sofa/defaulttype/VecTypes.h>
+#include <sofa/defaulttype/RigidTypes.h>
+#include "../types/AffineTypes.h"
+#include "../deformationMapping/LinearJacobianBlock_affine.inl"
+#include "../deformationMapping/LinearJacobianBlock_rigid.inl"
+#include "../deformationMapping/LinearSkinningKernel.h"
+
+namespace sofa {
+
+using namespace defaulttype;
+
+
+/**  Compare the batched skinning kernels, for each instruction set supported by the cpu, with the Affine3->Vec3 and Rigid3->Vec3 jacobian blocks,
+for apply, applyJ and applyJT. The frames given to the kernels are built as in LinearMapping: (t,A) for affine frames,
+(t,R) with the local points of the blocks for rigid frames, whose derivatives are (v,[omega]R) and whose torques are taken from the skew part of R.sum(Pa0.f^T).
+Rows have different lengths (including empty ones) and neighbouring children share their parents in one half of the children only,
+so that both the uniform and the gathered slots are tested, as well as the padding of the groups.
+ */
+template <class In>
+struct LinearSkinningKernel_test : public Sofa_test<SReal>
+{
+    typedef LinearJacobianBlock<In,Vec3Types> Block;
+    typedef typename Block::Real Real;
+    typedef typename Block::OutCoord OutCoord;
+    typedef typename Block::OutDeriv OutDeriv;
+    typedef typename In::Coord InCoord;
+    typedef typename In::Deriv InDeriv;
+    typedef typename In::VecCoord InVecCoord;
+    typedef typename In::VecDeriv InVecDeriv;
+    typedef Vec3Types::VecCoord OutVecCoord;
+    typedef Vec3Types::VecDeriv OutVecDeriv;
+    typedef type::Mat<3,3,Real> Mat33;
+    static const bool rigid = std::is_same<In,Rigid3Types>::value;
+
+    static const size_t nbChildren = 100003;
+    static const size_t nbParents = 50;
+
+    std::vector<unsigned int> offsets, index;
+    std::vector<Block> blocks;
+    LinearSkinningData<Real> data;
+
+    void SetUp() override
+    {
+        offsets.assign(1,0);
+        for(size_t i=0;i<nbChildren;++i)
+        {
+            const size_t nbRef = i%13==5 ? 0 : 4 + i%5;
+            for(size_t j=0;j<nbRef;++j)
+            {
+                index.push_back( i<nbChildren/2 ? (unsigned int)((i/1000+7*j)%nbParents) : (unsigned int)(std::rand()%nbParents) );
+                Block b;
+                b.Pt = (Real)helper::drand(1);
+                if constexpr( rigid ) b.Pa0 = OutCoord(helper::drand(1),helper::drand(1),helper::drand(1));
+                else b.Pa = OutCoord(helper::drand(1),helper::drand(1),helper::drand(1));
+                blocks.push_back(b);
+            }
+            offsets.push_back((unsigned int)index.size());
+        }
+        data.set(offsets.data(),index.data(),nbChildren,nbParents,[this](size_t k, Real& pt, Real* pa)
+        {
+            pt=blocks[k].Pt;
+            for(unsigned r=0;r<3;r++) { if constexpr( rigid ) pa[r]=blocks[k].Pa0[r]; else pa[r]=blocks[k].Pa[r]; }
+        });
+    }
+
+    void TearDown() override
+    {
+        simd::setSimdLevel(simd::SIMD_AVX512); // back to the best level supported by the cpu
+    }
+
+    static void setFrame(Real* F, const type::Vec<3,Real>& t, const Mat33& M)
+    {
+        for(unsigned r=0;r<3;r++)
+        {
+            F[r] = t[r];
+            for(unsigned c=0;c<3;c++) F[3+3*r+c] = M[r][c];
+        }
+    }
+
+    /// random parent, and the matrix of its frame (affine matrix or rotation)
+    static InCoord randomParent(Mat33& M)
+    {
+        InCoord x;
+        for(unsigned r=0;r<3;r++) x.getCenter()[r] = (Real)helper::drand(1);
+        if constexpr( rigid )
+        {
+            type::Quat<Real> q((Real)helper::drand(1),(Real)helper::drand(1),(Real)helper::drand(1),(Real)helper::drand(1));
+            q.normalize();
+            x.getOrientation() = q;
+            q.toMatrix(M);
+        }
+        else
+        {
+            for(unsigned r=0;r<3;r++) for(unsigned c=0;c<3;c++) x.getAffine()[r][c] = (Real)helper::drand(1);
+            M = x.getAffine();
+        }
+        return x;
+    }
+
+    static InDeriv randomDeriv()
+    {
+        InDeriv v;
+        for(size_t c=0;c<InDeriv::total_size;c++) v[c] = (Real)helper::drand(1);
+        return v;
+    }
+
+    /// matrix of the frame derivative: dA, or [omega]R
+    static void setDerivFrame(Real* F, const InDeriv& v, const Mat33& M)
+    {
+        if constexpr( rigid ) setFrame(F,getLinear(v),type::crossProductMatrix(getAngular(v))*M);
+        else setFrame(F,v.getVCenter(),v.getVAffine());
+    }
+
+    /// parent force from the sums of the child contributions returned by skinning::applyTranspose
+    static InDeriv parentForce(const Real* o, const Mat33& M)
+    {
+        InDeriv f;
+        if constexpr( rigid )
+        {
+            Mat33 T;
+            for(unsigned r=0;r<3;r++) for(unsigned c=0;c<3;c++) T[r][c] = M[r][0]*o[3+3*c] + M[r][1]*o[4+3*c] + M[r][2]*o[5+3*c];
+            getLinear(f) = type::Vec<3,Real>(o[0],o[1],o[2]);
+            getAngular(f) = type::Vec<3,Real>(T[1][2]-T[2][1],T[2][0]-T[0][2],T[0][1]-T[1][0]);
+        }
+        else for(unsigned c=0;c<12;c++) f[c] = o[c];
+        return f;
+    }
+
+    bool testLevel(simd::SimdLevel level)
+    {
+        level = simd::setSimdLevel(level);
+
+        InVecCoord in(nbParents);
+        std::vector<Mat33> M(nbParents);
+        std::vector<Real> frames(12*nbParents);
+        for(size_t p=0;p<nbParents;++p)
+        {
+            in[p] = randomParent(M[p]);
+            setFrame(&frames[12*p],in[p].getCenter(),M[p]);
+        }
+
+        // apply (which also rotates the points of the rigid blocks)
+        OutVecCoord expected(nbChildren), out(nbChildren);
+        for(size_t i=0;i<nbChildren;++i) for(size_t k=offsets[i];k<offsets[i+1];++k) blocks[k].addapply(expected[i],in[index[k]]);
+
+        skinning::apply(out[0].ptr(),frames.data(),data,0,data.nbGroups());
+
+        for(size_t i=0;i<nbChildren;++i)
+            if( (out[i]-expected[i]).norm() > 1e-12*(1+expected[i].norm()) )
+            {
+                ADD_FAILURE() << simd::getSimdLevelName(level) << " apply, child "<<i<<": "<<out[i]<<" instead of "<<expected[i]<< std::endl;
+                return false;
+            }
+
+        // applyJ
+        InVecDeriv v(nbParents);
+        for(size_t p=0;p<nbParents;++p)
+        {
+            v[p] = randomDeriv();
+            setDerivFrame(&frames[12*p],v[p],M[p]);
+        }
+        OutVecDeriv expectedJ(nbChildren), outJ(nbChildren);
+        for(size_t i=0;i<nbChildren;++i) for(size_t k=offsets[i];k<offsets[i+1];++k) blocks[k].addmult(expectedJ[i],v[index[k]]);
+
+        skinning::apply(outJ[0].ptr(),frames.data(),data,0,data.nbGroups());
+
+        for(size_t i=0;i<nbChildren;++i)
+            if( (outJ[i]-expectedJ[i]).norm() > 1e-12*(1+expectedJ[i].norm()) )
+            {
+                ADD_FAILURE() << simd::getSimdLevelName(level) << " applyJ, child "<<i<<": "<<outJ[i]<<" instead of "<<expectedJ[i]<< std::endl;
+                return false;
+            }
+
+        // applyJT
+        OutVecDeriv childForce(nbChildren);
+        for(size_t i=0;i<nbChildren;++i) childForce[i]=OutDeriv(helper::drand(1),helper::drand(1),helper::drand(1));
+        InVecDeriv f(nbParents);
+        for(size_t i=0;i<nbChildren;++i) for(size_t k=offsets[i];k<offsets[i+1];++k) blocks[k].addMultTranspose(f[index[k]],childForce[i]);
+
+        std::vector<Real> sums(12*nbParents);
+        skinning::applyTranspose(sums.data(),childForce[0].ptr(),data,0,nbParents);
+
+        for(size_t p=0;p<nbParents;++p)
+        {
+            const InDeriv fp = parentForce(&sums[12*p],M[p]);
+            for(size_t c=0;c<InDeriv::total_size;c++)
+                if( std::abs(fp[c]-f[p][c]) > 1e-10*(1+std::abs(f[p][c])) )
+                {
+                    ADD_FAILURE() << simd::getSimdLevelName(level) << " applyTranspose, parent "<<p<<": "<<fp<<" instead of "<<f[p]<< std::endl;
+                    return false;
+                }
+        }
+        return true;
+    }
+};
+
+typedef testing::Types< Affine3Types, Rigid3Types > SkinningParentTypes;
+TYPED_TEST_SUITE(LinearSkinningKernel_test, SkinningParentTypes);
+
+TYPED_TEST( LinearSkinningKernel_test , scalar )
+{
+    ASSERT_TRUE( this->testLevel(simd::SIMD_SCALAR) );
+}
+
+TYPED_TEST( LinearSkinningKernel_test , avx2 )
+{
+    ASSERT_TRUE( this->testLevel(simd::SIMD_AVX2) );
+}
+
+TYPED_TEST( LinearSkinningKernel_test , avx512 )
+{
+    ASSERT_TRUE( this->testLevel(simd::SIMD_AVX512) );
+}
+
+} // namespace sofa
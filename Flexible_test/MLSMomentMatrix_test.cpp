@@ -0,0 +1,102 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include "stdafx.h"
+#include <SofaTest/Sofa_test.h>
+#include "../deformationMapping/MLSJacobianBlock.h"
+
+#include <type_traits>
+
+namespace sofa {
+
+using namespace defaulttype;
+
+
+/**  Inversion of MLS moment matrices \f$ M = sum w_i.xi*.xi*^T \f$ built from random nodes, for linear and quadratic bases.
+The fixed-size LDL^T inverse must satisfy M.M^{-1}=I, and must report failure on rank deficient moments (a single node, or coplanar nodes).
+ */
+template <unsigned int order>
+struct MLSMomentMatrix_test : public Sofa_test<SReal>
+{
+    typedef MLSInfo<3,order,SReal> mlsinfo;
+    typedef typename mlsinfo::coord coord;
+    typedef typename mlsinfo::moment moment;
+    static const Size bdim = mlsinfo::bdim;
+
+    /// moment of random nodes, in the plane z=0 if coplanar
+    moment randomMoment(size_t nbNodes, bool coplanar=false)
+    {
+        moment M;
+        for(size_t i=0;i<nbNodes;i++)
+        {
+            coord x(helper::drand(1),helper::drand(1),coplanar?0:helper::drand(1));
+            M += covN(mlsinfo::getBasis(x)) * (SReal)(1+helper::drand(1));
+        }
+        return M;
+    }
+
+    bool testInverse()
+    {
+        for(size_t t=0;t<100;t++)
+        {
+            const moment M = randomMoment(2*bdim);
+            moment Minv;
+            if( !invertLDLT(Minv,M) ) { ADD_FAILURE() << "LDLT failed on "<<M<< std::endl; return false; }
+            for(Size i=0;i<bdim;i++)
+                for(Size j=0;j<bdim;j++)
+                {
+                    SReal s=0; for(Size k=0;k<bdim;k++) s+=M(i,k)*Minv(k,j);
+                    if( std::abs(s-(i==j?1:0)) > 1e-8 ) { ADD_FAILURE() << "(M.M^-1)("<<i<<","<<j<<")="<<s<< std::endl; return false; }
+                }
+        }
+        return true;
+    }
+
+    bool testSingular()
+    {
+        moment Minv;
+        const moment M1 = covN(mlsinfo::getBasis(coord(0.5,0.25,0.125))); // single node, exactly representable
+        if( invertLDLT(Minv,M1) ) { ADD_FAILURE() << "LDLT succeeded on a rank one moment "<<M1<< std::endl; return false; }
+        for(size_t t=0;t<100;t++)
+        {
+            const moment M = randomMoment(2*bdim,true); // the basis functions involving z vanish on all the nodes
+            if( invertLDLT(Minv,M) ) { ADD_FAILURE() << "LDLT succeeded on a coplanar moment "<<M<< std::endl; return false; }
+        }
+        return true;
+    }
+};
+
+typedef testing::Types< std::integral_constant<unsigned int,0>, std::integral_constant<unsigned int,1>, std::integral_constant<unsigned int,2> > Orders;
+
+template<class T> struct MLSMomentMatrixOrder_test : public MLSMomentMatrix_test<T::value> {};
+TYPED_TEST_SUITE(MLSMomentMatrixOrder_test, Orders);
+
+TYPED_TEST( MLSMomentMatrixOrder_test , inverse )
+{
+    ASSERT_TRUE( this->testInverse() );
+}
+
+TYPED_TEST( MLSMomentMatrixOrder_test , singular )
+{
+    ASSERT_TRUE( this->testSingular() );
+}
+
+} // namespace sofa
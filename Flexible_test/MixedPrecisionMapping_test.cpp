@@ -0,0 +1,120 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include "stdafx.h"
+#include <SofaTest/Sofa_test.h>
+#include <sofa/defaulttype/RigidTypes.h>
+#include <sofa/core/BaseMapping.h>
+#include <sofa/core/behavior/BaseForceField.h>
+
+//Including Simulation
+#include <SofaSimulationGraph/DAGSimulation.h>
+#include <SofaBaseMechanics/MechanicalObject.h>
+
+namespace sofa {
+
+using namespace defaulttype;
+
+
+/**  Single precision strain chain under double precision frames:
+LinearMapping<Rigid3,F331f> -> CorotationalStrainMapping<F331f,E331f> -> HookeForceField<E331f>.
+The beam of RigidFramesBeamParallelTest.scn is simulated with this chain, and the final frame positions
+are compared with the ones obtained with the SReal chain, up to the single precision of the strains.
+ */
+struct MixedPrecisionMapping_test : public Sofa_test<SReal>
+{
+    typedef component::container::MechanicalObject<Rigid3Types> RigidMechanicalObject;
+
+    /// Simulation
+    simulation::Simulation* simulation;
+
+    void SetUp()
+    {
+        sofa::simulation::setSimulation(simulation = new sofa::simulation::graph::DAGSimulation());
+    }
+
+    /// load the scene, run a few time steps and return the initial and final rigid frames
+    bool runBeam(Rigid3Types::VecCoord& x0, Rigid3Types::VecCoord& x, const char* scene, bool singlePrecision)
+    {
+        std::string fileName = std::string(FLEXIBLE_TEST_SCENES_DIR) + "/" + scene;
+        simulation::Node::SPtr root = down_cast<sofa::simulation::Node>( simulation->load(fileName.c_str()).get() );
+        simulation->init(root.get());
+
+        if( singlePrecision )
+        {
+            // the chain must have been created with the single precision types, not with a fallback to SReal
+            simulation::Node* behavior = root->getChild("Flexible")->getChild("behavior");
+            type::vector<core::objectmodel::BaseObject*> chain;
+            chain.push_back( behavior->get<core::BaseMapping>() );
+            chain.push_back( behavior->getChild("Strain")->get<core::BaseMapping>() );
+            chain.push_back( behavior->getChild("Strain")->get<core::behavior::BaseForceField>() );
+            for(size_t i=0;i<chain.size();++i)
+                if( !chain[i] || chain[i]->getTemplateName().find("331f")==std::string::npos ) // F331f or E331f
+                {
+                    ADD_FAILURE() << scene << ": component "<<i<<" of the chain is not single precision: "<<(chain[i]?chain[i]->getTemplateName():std::string("not found"))<< std::endl;
+                    simulation->unload(root);
+                    return false;
+                }
+        }
+
+        RigidMechanicalObject* rigidDofs = root->getChild("Flexible")->get<RigidMechanicalObject>( root->SearchDown);
+        x0 = rigidDofs->readPositions().ref();
+
+        for(unsigned int l=0;l<10;++l) simulation->animate(root.get(),0.1);
+
+        x = rigidDofs->readPositions().ref();
+
+        simulation->unload(root);
+        return true;
+    }
+
+    bool testBeam()
+    {
+        Rigid3Types::VecCoord x0, xref, x;
+        if( !runBeam(x0,xref,"RigidFramesBeamParallelTest.scn",false) ) return false;
+        if( !runBeam(x0,x,"RigidFramesBeamMixedPrecisionTest.scn",true) ) return false;
+        if( x.size()!=xref.size() ) { ADD_FAILURE() << "Different number of frames: "<<x.size()<<" instead of "<<xref.size()<< std::endl; return false; }
+
+        SReal maxDisplacement = 0;
+        for(size_t i=0;i<x.size();++i)
+            maxDisplacement = std::max( maxDisplacement, (xref[i].getCenter()-x0[i].getCenter()).norm() );
+        if( maxDisplacement < 1e-2 )
+        {
+            ADD_FAILURE() << "The beam did not deform: maximum displacement "<<maxDisplacement<< std::endl;
+            return false;
+        }
+
+        for(size_t i=0;i<x.size();++i)
+            if( (x[i].getCenter()-xref[i].getCenter()).norm() > 1e-3*maxDisplacement )
+            {
+                ADD_FAILURE() << "Frame "<<i<<": got "<<x[i].getCenter()<<" with single precision strains instead of "<<xref[i].getCenter()<< std::endl;
+                return false;
+            }
+        return true;
+    }
+};
+
+TEST_F( MixedPrecisionMapping_test , beam )
+{
+    ASSERT_TRUE( this->testBeam() );
+}
+
+} // namespace sofa
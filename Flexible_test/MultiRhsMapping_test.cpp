@@ -0,0 +1,126 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include "stdafx.h"
+#include "BeamSceneFixture.h"
+#include <sofa/defaulttype/RigidTypes.h>
+#include <sofa/core/MechanicalParams.h>
+
+#include "../deformationMapping/LinearMapping.h"
+#include "../strainMapping/CorotationalStrainMapping.h"
+
+namespace sofa {
+
+using namespace defaulttype;
+using namespace component::mapping;
+
+
+/**  Products with several right-hand sides.
+The batched applyJ/applyJT of a deformation mapping (Rigid3->F331) and of a strain mapping (F331->E331) of a beam
+must give the same results as the single vector versions, with and without assembly.
+ */
+struct MultiRhsMapping_test : public BeamSceneFixture<1> // non trivial parent positions
+{
+    static const size_t nbRhs = 3;
+
+    template<class VecDeriv>
+    static void randomize(VecDeriv& v, size_t size)
+    {
+        typedef typename VecDeriv::value_type Deriv;
+        v.resize(size);
+        for(size_t i=0;i<size;++i) for(size_t c=0;c<Deriv::total_size;++c) v[i][c] = helper::drand(1);
+    }
+
+    template<class VecDeriv>
+    bool compare(const VecDeriv& v, const VecDeriv& ref, const char* name, size_t rhs)
+    {
+        typedef typename VecDeriv::value_type Deriv;
+        for(size_t i=0;i<ref.size();++i) for(size_t c=0;c<Deriv::total_size;++c)
+            if( std::abs(v[i][c]-ref[i][c]) > 1e-10*(1+std::abs(ref[i][c])) )
+            {
+                ADD_FAILURE() << name << ", right-hand side "<<rhs<<", entry "<<i<<": "<<v[i]<<" instead of "<<ref[i]<< std::endl;
+                return false;
+            }
+        return true;
+    }
+
+    template<class Mapping>
+    bool testMapping(Mapping* mapping, bool assemble)
+    {
+        typedef typename Mapping::InVecDeriv InVecDeriv;
+        typedef typename Mapping::OutVecDeriv OutVecDeriv;
+
+        if( !mapping ) { ADD_FAILURE() << "mapping not found" << std::endl; return false; }
+        mapping->assemble.setValue(assemble);
+        mapping->reinit();
+
+        const core::MechanicalParams* mparams = core::MechanicalParams::defaultInstance();
+        const size_t inSize = mapping->getFromModel()->getSize(), outSize = mapping->getToModel()->getSize();
+
+        Data<InVecDeriv> dx[nbRhs], f[nbRhs], fref[nbRhs];
+        Data<OutVecDeriv> dy[nbRhs], dyref[nbRhs], fc[nbRhs];
+        type::vector<const Data<InVecDeriv>*> dxPtr; type::vector<Data<InVecDeriv>*> fPtr;
+        type::vector<Data<OutVecDeriv>*> dyPtr; type::vector<const Data<OutVecDeriv>*> fcPtr;
+        for(size_t v=0;v<nbRhs;++v)
+        {
+            randomize(*dx[v].beginEdit(),inSize); dx[v].endEdit();
+            randomize(*fc[v].beginEdit(),outSize); fc[v].endEdit();
+            randomize(*f[v].beginEdit(),inSize); f[v].endEdit();
+            fref[v].setValue(f[v].getValue());
+            dy[v].beginEdit()->resize(outSize); dy[v].endEdit();
+            dyref[v].beginEdit()->resize(outSize); dyref[v].endEdit();
+            dxPtr.push_back(&dx[v]); fPtr.push_back(&f[v]); dyPtr.push_back(&dy[v]); fcPtr.push_back(&fc[v]);
+        }
+
+        // reference: one vector after the other
+        for(size_t v=0;v<nbRhs;++v)
+        {
+            mapping->applyJ(mparams,dyref[v],dx[v]);
+            mapping->applyJT(mparams,fref[v],fc[v]);
+        }
+
+        mapping->applyJ(mparams,dyPtr,dxPtr);
+        mapping->applyJT(mparams,fPtr,fcPtr);
+
+        for(size_t v=0;v<nbRhs;++v)
+        {
+            if( !compare(dy[v].getValue(),dyref[v].getValue(),"applyJ",v) ) return false;
+            if( !compare(f[v].getValue(),fref[v].getValue(),"applyJT",v) ) return false;
+        }
+        return true;
+    }
+};
+
+TEST_F( MultiRhsMapping_test , LinearMapping )
+{
+    LinearMapping<Rigid3Types,F331Types>* mapping = root->get<LinearMapping<Rigid3Types,F331Types> >(core::objectmodel::BaseContext::SearchDown);
+    ASSERT_TRUE( this->testMapping(mapping,false) );
+    ASSERT_TRUE( this->testMapping(mapping,true) );
+}
+
+TEST_F( MultiRhsMapping_test , CorotationalStrainMapping )
+{
+    CorotationalStrainMapping<F331Types,E331Types>* mapping = root->get<CorotationalStrainMapping<F331Types,E331Types> >(core::objectmodel::BaseContext::SearchDown);
+    ASSERT_TRUE( this->testMapping(mapping,false) );
+    ASSERT_TRUE( this->testMapping(mapping,true) );
+}
+
+} // namespace sofa
@@ -0,0 +1,182 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include "stdafx.h"
+#include <SofaTest/Sofa_test.h>
+#include <sofa/defaulttype/RigidTypes.h>
+#include <sofa/core/BaseMapping.h>
+
+//Including Simulation
+#include <SofaSimulationGraph/DAGSimulation.h>
+#include <SofaBaseMechanics/MechanicalObject.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace sofa {
+
+using namespace defaulttype;
+
+const int nbThreadsArray[] = {1, 4, 16, 32};
+const size_t sizeNbThreadsArray = sizeof(nbThreadsArray)/sizeof(nbThreadsArray[0]);
+
+
+/**  Test of the parallel deformation mappings.
+Simulate a beam with rigid frames, where LinearMappings (with geometric stiffness) and strain mappings run with parallel=1,
+using 1, 4, 16 and 32 threads. The final frame positions must not depend on the number of threads.
+The symmetrized geometric stiffness (geometricStiffness=2) goes through the assembly of K (updateK).
+The results must not depend either on the order in which the children are processed (childOrdering).
+The same beam is also simulated with rigid and affine frames, mapped through LinearMultiMappings.
+Reinitializing the mappings (jacobian blocks computed again in the storage of the previous ones) must not change the results either.
+The speedup is measured by the ParallelDeformationMapping benchmarks of Flexible_bench, for both beams.
+ */
+struct ParallelDeformationMapping_test : public Sofa_test<SReal>
+{
+    typedef component::container::MechanicalObject<Rigid3Types> RigidMechanicalObject;
+
+    /// Simulation
+    simulation::Simulation* simulation;
+
+    void SetUp()
+    {
+        sofa::simulation::setSimulation(simulation = new sofa::simulation::graph::DAGSimulation());
+    }
+
+    /// load the scene, set a data of all the mappings, run a few time steps and return the final rigid frames
+    void runBeam(Rigid3Types::VecCoord& x, const char* dataName, const char* value, const char* scene="RigidFramesBeamParallelTest.scn", bool reinit=false)
+    {
+        std::string fileName = std::string(FLEXIBLE_TEST_SCENES_DIR) + "/" + scene;
+        simulation::Node::SPtr root = down_cast<sofa::simulation::Node>( simulation->load(fileName.c_str()).get() );
+
+        type::vector<core::BaseMapping*> mappings;
+        root->get<core::BaseMapping>(&mappings,core::objectmodel::BaseContext::SearchDown);
+        for(size_t i=0;i<mappings.size();++i)
+            if( core::objectmodel::BaseData* data = mappings[i]->findData(dataName) ) data->read(value);
+
+        simulation->init(root.get());
+        if(reinit) for(size_t i=0;i<mappings.size();++i) mappings[i]->reinit();
+
+        RigidMechanicalObject* rigidDofs = root->getChild("Flexible")->get<RigidMechanicalObject>( root->SearchDown);
+
+        for(unsigned int l=0;l<10;++l) simulation->animate(root.get(),0.1);
+
+        RigidMechanicalObject::ReadVecCoord xr = rigidDofs->readPositions();
+        x.resize(xr.size());
+        for(size_t i=0;i<xr.size();++i) x[i]=xr[i];
+
+        simulation->unload(root);
+    }
+
+    /// the final frames must not depend on the number of threads
+    bool testThreadIndependence(const char* geometricStiffness, const char* scene="RigidFramesBeamParallelTest.scn")
+    {
+#ifdef _OPENMP
+        const int maxThreads = omp_get_max_threads();
+
+        Rigid3Types::VecCoord xref;
+
+        for(size_t t=0;t<sizeNbThreadsArray;++t)
+        {
+            omp_set_num_threads(nbThreadsArray[t]);
+
+            Rigid3Types::VecCoord x;
+            runBeam(x,"geometricStiffness",geometricStiffness,scene);
+            if(t==0) xref=x;
+
+            for(size_t i=0;i<x.size();++i)
+                if( (x[i].getCenter()-xref[i].getCenter()).norm()>1e-10 )
+                {
+                    omp_set_num_threads(maxThreads);
+                    ADD_FAILURE() << "Frame "<<i<<" depends on the number of threads: got "<<x[i].getCenter()<<" with "<<nbThreadsArray[t]<<" threads instead of "<<xref[i].getCenter()<< std::endl;
+                    return false;
+                }
+        }
+
+        omp_set_num_threads(maxThreads);
+#endif
+        return true;
+    }
+
+    /// the order in which the children are processed must not change the results
+    bool testOrdering()
+    {
+        const char* orderings[] = {"0","1","2"};
+        Rigid3Types::VecCoord xref;
+        for(size_t o=0;o<3;++o)
+        {
+            Rigid3Types::VecCoord x;
+            runBeam(x,"childOrdering",orderings[o]);
+            if(o==0) xref=x;
+
+            for(size_t i=0;i<x.size();++i)
+                if( (x[i].getCenter()-xref[i].getCenter()).norm()>1e-10 )
+                {
+                    ADD_FAILURE() << "Frame "<<i<<" depends on the order of the children: got "<<x[i].getCenter()<<" with childOrdering="<<orderings[o]<<" instead of "<<xref[i].getCenter()<< std::endl;
+                    return false;
+                }
+        }
+        return true;
+    }
+
+    /// reinitialized mappings must give the same results as freshly initialized ones
+    bool testReinit()
+    {
+        Rigid3Types::VecCoord xref, x;
+        runBeam(xref,"parallel","1");
+        runBeam(x,"parallel","1","RigidFramesBeamParallelTest.scn",true);
+
+        for(size_t i=0;i<x.size();++i)
+            if( (x[i].getCenter()-xref[i].getCenter()).norm()>1e-10 )
+            {
+                ADD_FAILURE() << "Frame "<<i<<" changed after reinit: got "<<x[i].getCenter()<<" instead of "<<xref[i].getCenter()<< std::endl;
+                return false;
+            }
+        return true;
+    }
+};
+
+TEST_F( ParallelDeformationMapping_test , RigidFramesBeam )
+{
+    ASSERT_TRUE( this->testThreadIndependence("1") );
+}
+
+TEST_F( ParallelDeformationMapping_test , RigidFramesBeamSymmetrizedGeometricStiffness )
+{
+    ASSERT_TRUE( this->testThreadIndependence("2") );
+}
+
+TEST_F( ParallelDeformationMapping_test , RigidAffineFramesBeam )
+{
+    ASSERT_TRUE( this->testThreadIndependence("1","RigidAffineFramesBeamParallelTest.scn") );
+}
+
+TEST_F( ParallelDeformationMapping_test , RigidFramesBeamChildOrdering )
+{
+    ASSERT_TRUE( this->testOrdering() );
+}
+
+TEST_F( ParallelDeformationMapping_test , RigidFramesBeamReinit )
+{
+    ASSERT_TRUE( this->testReinit() );
+}
+
+} // namespace sofa
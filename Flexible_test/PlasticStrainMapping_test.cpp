@@ -0,0 +1,151 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include "stdafx.h"
+#include <SofaTest/Sofa_test.h>
+#include <sofa/core/BaseMapping.h>
+#include <sofa/core/MechanicalParams.h>
+
+//Including Simulation
+#include <SofaSimulationGraph/DAGSimulation.h>
+#include <SofaBaseMechanics/MechanicalObject.h>
+
+#include "../strainMapping/PlasticStrainMapping.h"
+
+namespace sofa {
+
+using namespace defaulttype;
+
+
+/**  Plasticity parameters edited between two applications of a PlasticStrainMapping, without reinit.
+The mapped strains are compared with the ones of the jacobian blocks, over several steps: the edited yield, creep and max thresholds
+must be used from the next apply on, and the plastic strains accumulated with the previous parameters must be kept.
+ */
+template <class Strain>
+struct PlasticStrainMapping_test : public Sofa_test<typename Strain::Real>
+{
+    typedef typename Strain::Real Real;
+    typedef typename Strain::Coord Coord;
+    typedef typename Strain::VecCoord VecCoord;
+    typedef component::container::MechanicalObject<Strain> StrainDofs;
+    typedef component::mapping::PlasticStrainMapping<Strain> Mapping;
+    typedef PlasticStrainJacobianBlock<Strain> Block;
+
+    /// Simulation
+    simulation::Simulation* simulation;
+    /// Tested scene: parent strain dofs, mapped to the elastic strains of the child node
+    simulation::Node::SPtr root;
+    typename StrainDofs::SPtr inDofs, outDofs;
+    typename Mapping::SPtr mapping;
+
+    void SetUp()
+    {
+        sofa::simulation::setSimulation(simulation = new sofa::simulation::graph::DAGSimulation());
+        root = simulation->createNewGraph("root");
+        inDofs = core::objectmodel::New<StrainDofs>();
+        root->addObject(inDofs);
+        simulation::Node::SPtr elastic = root->createChild("elastic");
+        outDofs = core::objectmodel::New<StrainDofs>();
+        elastic->addObject(outDofs);
+        mapping = core::objectmodel::New<Mapping>();
+        mapping->setModels(inDofs.get(),outDofs.get());
+        elastic->addObject(mapping);
+    }
+
+    void TearDown()
+    {
+        if (root!=NULL)
+            simulation->unload(root);
+    }
+
+    bool testEdit( unsigned method )
+    {
+        const size_t n = 100;
+        type::vector<Real> maxs, yields( 1, (Real)0.02 ), creeps( 1, (Real)0.5 );
+        for(size_t i=0;i<n;i++) maxs.push_back( (Real)(0.05+helper::drand(0.05)) );
+
+        mapping->f_method.beginEdit()->setSelectedItem( method );
+        mapping->f_method.endEdit();
+        mapping->_max.setValue( maxs );
+        mapping->_yield.setValue( yields );
+        mapping->_creep.setValue( creeps );
+        inDofs->resize( n );
+        simulation->init(root.get());
+
+        type::vector<Coord> plasticStrains( n );
+        for(size_t step=0;step<10;step++)
+        {
+            if( step==5 ) // parameters edited at runtime
+            {
+                size_t nbPlastic = 0;
+                for(size_t i=0;i<n;i++) if( plasticStrains[i].getVec().norm()>0 ) nbPlastic++;
+                if( !nbPlastic ) { ADD_FAILURE() << "no plastic strain before the edition of the parameters" << std::endl; return false; }
+
+                yields.assign( 1, (Real)0.01 );
+                creeps.assign( 1, (Real)0.25 );
+                for(size_t i=0;i<n;i++) maxs[i] *= (Real)0.5;
+                mapping->_max.setValue( maxs );
+                mapping->_yield.setValue( yields );
+                mapping->_creep.setValue( creeps );
+            }
+
+            {
+                helper::WriteAccessor< Data<VecCoord> > in = inDofs->writePositions();
+                for(size_t i=0;i<n;i++)
+                    for(size_t c=0;c<(size_t)Strain::coord_total_size;c++)
+                        in[i][c] = (Real)( i%3==0 ? helper::drand(0.01) : helper::drand(0.2) );
+            }
+            static_cast<core::BaseMapping*>(mapping.get())->apply( core::mechanicalparams::defaultInstance(), core::VecCoordId::position(), core::ConstVecCoordId::position() );
+
+            const VecCoord& in = inDofs->readPositions().ref();
+            const VecCoord& out = outDofs->readPositions().ref();
+            if( out.size()!=n ) { ADD_FAILURE() << "step "<<step<<": "<<out.size()<<" mapped strains instead of "<<n<< std::endl; return false; }
+
+            Block block;
+            for(size_t i=0;i<n;i++)
+            {
+                Coord expected;
+                if( method==Mapping::ADDITION ) block.addapply_addition( expected, in[i], plasticStrains[i], maxs[i], yields[0]*yields[0], creeps[0] );
+                else block.addapply_multiplication( expected, in[i], plasticStrains[i], maxs[i], yields[0]*yields[0], creeps[0] );
+                if( (out[i].getVec()-expected.getVec()).norm() > 1e-10 )
+                {
+                    ADD_FAILURE() << "step "<<step<<", sample "<<i<<": "<<out[i]<<" instead of "<<expected<< std::endl;
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+};
+
+typedef testing::Types< E331Types, E332Types > PlasticStrainTypes;
+TYPED_TEST_SUITE(PlasticStrainMapping_test, PlasticStrainTypes);
+
+TYPED_TEST( PlasticStrainMapping_test , addition )
+{
+    ASSERT_TRUE( this->testEdit( TestFixture::Mapping::ADDITION ) );
+}
+TYPED_TEST( PlasticStrainMapping_test , multiplication )
+{
+    ASSERT_TRUE( this->testEdit( TestFixture::Mapping::MULTIPLICATION ) );
+}
+
+} // namespace sofa
@@ -0,0 +1,109 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include "stdafx.h"
+#include <SofaTest/Sofa_test.h>
+#include "../strainMapping/PlasticStrainJacobianBlock.h"
+
+namespace sofa {
+
+using namespace defaulttype;
+
+
+/**  Compare the structure of arrays update of the plastic strains (ADDITION method) with the one of the jacobian blocks, over several steps.
+The max threshold is given per sample and the other parameters are shared, so that the expansion of the parameters is tested as well.
+Some samples stay below the yield threshold, others creep, others are clamped. The number of samples is not a multiple of the chunk size,
+and is changed during the test to check that the plastic strains of the remaining samples are kept. They are also kept when the parameters are re-expanded.
+ */
+template <class Strain>
+struct PlasticStrainState_test : public Sofa_test<typename Strain::Real>
+{
+    typedef typename Strain::Real Real;
+    typedef typename Strain::Coord Coord;
+    typedef typename Strain::VecCoord VecCoord;
+    typedef PlasticStrainJacobianBlock<Strain> Block;
+    typedef PlasticStrainState<Strain> State;
+
+    type::vector<Real> maxs, yields, creeps;
+
+    bool testAddition()
+    {
+        size_t n = 1000;
+        for(size_t i=0;i<n;i++) maxs.push_back( (Real)(0.05+helper::drand(0.05)) );
+        yields.assign( 1, (Real)0.02 );
+        creeps.assign( 1, (Real)0.5 );
+
+        State state;
+        state.resize( n, maxs, yields, creeps );
+        type::vector<Coord> plasticStrains( n );
+
+        for(size_t step=0;step<10;step++)
+        {
+            if( step==5 ) // fewer samples
+            {
+                n = 777;
+                state.resize( n, maxs, yields, creeps );
+                plasticStrains.resize( n );
+            }
+            else if( step==7 ) // parameters edited at runtime
+            {
+                yields.assign( 1, (Real)0.01 );
+                creeps.assign( 1, (Real)0.25 );
+                state.resize( n, maxs, yields, creeps );
+            }
+
+            VecCoord in( n ), out( n ), expected( n );
+            for(size_t i=0;i<n;i++)
+                for(size_t c=0;c<(size_t)Strain::coord_total_size;c++)
+                    in[i][c] = (Real)( i%3==0 ? helper::drand(0.01) : helper::drand(0.2) );
+
+            Block block;
+            for(size_t i=0;i<n;i++)
+                block.addapply_addition( expected[i], in[i], plasticStrains[i], state.max[i], state.squaredYield[i], state.creep[i] );
+            state.addition( &out[0], &in[0], 0, n );
+
+            for(size_t i=0;i<n;i++)
+            {
+                if( (out[i].getVec()-expected[i].getVec()).norm() > 1e-12 )
+                {
+                    ADD_FAILURE() << "step "<<step<<", sample "<<i<<": "<<out[i]<<" instead of "<<expected[i]<< std::endl;
+                    return false;
+                }
+                if( (state.get(i).getVec()-plasticStrains[i].getVec()).norm() > 1e-12 )
+                {
+                    ADD_FAILURE() << "step "<<step<<", sample "<<i<<": plastic strain "<<state.get(i)<<" instead of "<<plasticStrains[i]<< std::endl;
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+};
+
+typedef testing::Types< E331Types, E332Types > PlasticStrainTypes;
+TYPED_TEST_SUITE(PlasticStrainState_test, PlasticStrainTypes);
+
+TYPED_TEST( PlasticStrainState_test , addition )
+{
+    ASSERT_TRUE( this->testAddition() );
+}
+
+} // namespace sofa
@@ -0,0 +1,106 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include "stdafx.h"
+#include <SofaTest/Sofa_test.h>
+#include <sofa/type/Vec.h>
+#include "../deformationMapping/PointBVH.h"
+
+namespace sofa {
+
+using namespace defaulttype;
+
+
+/**  Closest point queries in a point hierarchy, compared with an exhaustive search,
+after its construction, after a small motion (refit only) and after a large motion (rebuild).
+An empty hierarchy returns an invalid index.
+ */
+struct PointBVH_test : public Sofa_test<SReal>
+{
+    typedef type::Vec<3,SReal> Coord;
+    typedef type::vector<Coord> VecCoord;
+
+    static const size_t nbPoints = 20000;
+    static const size_t nbQueries = 2000;
+
+    VecCoord points, queries;
+    PointBVH<Coord> tree;
+
+    void SetUp() override
+    {
+        points.resize(nbPoints);
+        for(size_t i=0;i<nbPoints;++i) points[i]=Coord(helper::drand(10),helper::drand(1),helper::drand(1)); // beam
+        queries.resize(nbQueries);
+        for(size_t i=0;i<nbQueries;++i) queries[i]=Coord(helper::drand(15),helper::drand(3),helper::drand(3));
+    }
+
+    bool testQueries(const char* name)
+    {
+        for(size_t q=0;q<nbQueries;++q)
+        {
+            SReal dmin=std::numeric_limits<SReal>::max();
+            for(size_t i=0;i<nbPoints;++i) dmin=std::min(dmin,(points[i]-queries[q]).norm2());
+            const unsigned int closest=tree.getClosest(queries[q],points);
+            if( closest>=nbPoints || (points[closest]-queries[q]).norm2()>dmin )
+            {
+                ADD_FAILURE() << name << ", query "<<q<<": wrong closest point "<<closest<< std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+TEST_F( PointBVH_test , refit )
+{
+    tree.build(points);
+    ASSERT_TRUE( this->testQueries("build") );
+
+    for(size_t i=0;i<nbPoints;++i) points[i]+=Coord(helper::drand(0.01),helper::drand(0.01),helper::drand(0.01));
+    tree.update(points);
+    ASSERT_EQ( tree.getNbBuilds(), 1u );
+    ASSERT_TRUE( this->testQueries("refit") );
+}
+
+TEST_F( PointBVH_test , rebuild )
+{
+    tree.build(points);
+
+    // bend the beam: the leaves do not fit the points anymore
+    for(size_t i=0;i<nbPoints;++i)
+    {
+        const SReal a=points[i][0]*0.3, x=points[i][0], y=points[i][1];
+        points[i][0]=std::cos(a)*x-std::sin(a)*y; points[i][1]=std::sin(a)*x+std::cos(a)*y;
+        points[i][2]=helper::drand(5);
+    }
+    tree.update(points);
+    ASSERT_EQ( tree.getNbBuilds(), 2u );
+    ASSERT_TRUE( this->testQueries("rebuild") );
+}
+
+TEST_F( PointBVH_test , empty )
+{
+    tree.build(VecCoord());
+    ASSERT_TRUE( tree.empty() );
+    ASSERT_EQ( tree.getClosest(queries[0],points), (unsigned int)-1 ); // no valid index: callers return early
+}
+
+} // namespace sofa
@@ -0,0 +1,136 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include "stdafx.h"
+#include <SofaTest/Sofa_test.h>
+#include <sofa/defaulttype/RigidTypes.h>
+
+//Including Simulation
+#include <SofaSimulationGraph/DAGSimulation.h>
+
+#include "../deformationMapping/LinearMapping.h"
+
+namespace sofa {
+
+using namespace defaulttype;
+using namespace component::mapping;
+
+
+/**  Pruning of the small weights of a deformation mapping (Rigid3->F331) of a beam.
+The number of parents per child must decrease, and the weights of the pruned children must be a partition of unity
+(their gradients and hessians sum to zero).
+When the weights are released after init, the mapping must hold less memory, and give back the same weights on demand.
+ */
+struct WeightPruning_test : public Sofa_test<SReal>
+{
+    typedef LinearMapping<Rigid3Types,F331Types> Mapping;
+
+    /// Simulation
+    simulation::Simulation* simulation;
+
+    void SetUp()
+    {
+        sofa::simulation::setSimulation(simulation = new sofa::simulation::graph::DAGSimulation());
+    }
+
+    Mapping::VecVReal w;
+    Mapping::VecVGradient dw;
+    Mapping::VecVHessian ddw;
+    SReal averageNbRef;
+    size_t memoryUsage;
+    bool released;
+
+    /// load the scene with the given threshold and get the weights
+    bool load(const char* threshold, bool release=false)
+    {
+        std::string fileName = std::string(FLEXIBLE_TEST_SCENES_DIR) + "/" + "RigidFramesBeamParallelTest.scn";
+        simulation::Node::SPtr root = down_cast<sofa::simulation::Node>( simulation->load(fileName.c_str()).get() );
+        Mapping* mapping = root->get<Mapping>(core::objectmodel::BaseContext::SearchDown);
+        if( !mapping ) { ADD_FAILURE() << "mapping not found" << std::endl; return false; }
+        mapping->d_weightThreshold.read(threshold);
+        mapping->d_releaseWeights.setValue(release);
+        simulation->init(root.get());
+
+        averageNbRef = mapping->d_averageNbRef.getValue();
+        memoryUsage = mapping->d_memoryUsage.getValue();
+        released = mapping->f_w.getValue().empty() && mapping->f_ddw.getValue().empty();
+        w = mapping->getWeights();
+        dw = mapping->getWeightsGradient();
+        ddw = mapping->getWeightsHessian();
+        simulation->unload(root);
+        return true;
+    }
+
+    /// the children that lost some parents must have normalized weights
+    bool testPartitionOfUnity(const Mapping::VecVReal& w0)
+    {
+        if( w.size()!=w0.size() ) { ADD_FAILURE() << "wrong number of children" << std::endl; return false; }
+        for(size_t i=0;i<w.size();++i)
+        {
+            if( w[i].size()==w0[i].size() ) continue;
+            SReal sum=0; Mapping::VGradient::value_type dsum; Mapping::VHessian::value_type ddsum;
+            for(size_t j=0;j<w[i].size();++j) { sum+=w[i][j]; dsum+=dw[i][j]; ddsum+=ddw[i][j]; }
+            if( std::abs(sum-1)>1e-8 ) { ADD_FAILURE() << "child "<<i<<": sum of the weights "<<sum<< std::endl; return false; }
+            if( dsum.norm()>1e-6 ) { ADD_FAILURE() << "child "<<i<<": sum of the weight gradients "<<dsum<< std::endl; return false; }
+            for(unsigned a=0;a<3;++a) if( ddsum[a].norm()>1e-5 ) { ADD_FAILURE() << "child "<<i<<": sum of the weight hessians "<<ddsum<< std::endl; return false; }
+        }
+        return true;
+    }
+
+    bool compareWeights(const Mapping::VecVReal& w0, const Mapping::VecVHessian& ddw0)
+    {
+        if( w.size()!=w0.size() || ddw.size()!=ddw0.size() ) { ADD_FAILURE() << "wrong number of children" << std::endl; return false; }
+        for(size_t i=0;i<w.size();++i)
+        {
+            if( w[i].size()!=w0[i].size() || ddw[i].size()!=ddw0[i].size() ) { ADD_FAILURE() << "child "<<i<<": wrong number of weights" << std::endl; return false; }
+            for(size_t j=0;j<w[i].size();++j)
+                if( std::abs(w[i][j]-w0[i][j])>1e-10 || (ddw[i][j]-ddw0[i][j]).norm()>1e-8 ) { ADD_FAILURE() << "child "<<i<<": weight "<<w[i][j]<<" instead of "<<w0[i][j]<< std::endl; return false; }
+        }
+        return true;
+    }
+};
+
+TEST_F( WeightPruning_test , RigidFramesBeam )
+{
+    ASSERT_TRUE( this->load("0") );
+    const SReal nbRef = averageNbRef;
+    const Mapping::VecVReal w0 = w;
+
+    ASSERT_TRUE( this->load("0.1") );
+    ASSERT_LT( averageNbRef, nbRef );
+    ASSERT_TRUE( this->testPartitionOfUnity(w0) );
+}
+
+TEST_F( WeightPruning_test , ReleasedWeights )
+{
+    ASSERT_TRUE( this->load("0.1") );
+    ASSERT_FALSE( released );
+    const size_t memory = memoryUsage;
+    const Mapping::VecVReal w0 = w;
+    const Mapping::VecVHessian ddw0 = ddw;
+
+    ASSERT_TRUE( this->load("0.1",true) );
+    ASSERT_TRUE( released );
+    ASSERT_LT( memoryUsage, memory );
+    ASSERT_TRUE( this->compareWeights(w0,ddw0) );
+}
+
+} // namespace sofa
@@ -0,0 +1,77 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include "SimdLevel.h"
+
+#include <atomic>
+
+namespace sofa
+{
+
+namespace defaulttype
+{
+
+namespace simd
+{
+
+SimdLevel getCpuSimdLevel()
+{
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    if( __builtin_cpu_supports("avx512f") ) return SIMD_AVX512;
+    if( __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") ) return SIMD_AVX2;
+#endif
+    return SIMD_SCALAR;
+}
+
+static std::atomic<int>& currentSimdLevel()
+{
+    static std::atomic<int> level(getCpuSimdLevel());
+    return level;
+}
+
+SimdLevel getSimdLevel()
+{
+    return (SimdLevel)currentSimdLevel().load(std::memory_order_relaxed);
+}
+
+SimdLevel setSimdLevel(SimdLevel level)
+{
+    const SimdLevel cpu = getCpuSimdLevel();
+    if( level>cpu ) level=cpu;
+    currentSimdLevel().store(level);
+    return level;
+}
+
+const char* getSimdLevelName(SimdLevel level)
+{
+    switch(level)
+    {
+    case SIMD_AVX512: return "AVX-512";
+    case SIMD_AVX2: return "AVX2";
+    default: return "scalar";
+    }
+}
+
+} // namespace simd
+
+} // namespace defaulttype
+} // namespace sofa
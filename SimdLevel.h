@@ -0,0 +1,52 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#ifndef FLEXIBLE_SimdLevel_H
+#define FLEXIBLE_SimdLevel_H
+
+#include <Flexible/config.h>
+
+namespace sofa
+{
+
+namespace defaulttype
+{
+
+/// instruction set of the batched kernels (skinning kernels of LinearMapping, svd kernel of CorotationalStrainMapping)
+namespace simd
+{
+
+enum SimdLevel { SIMD_SCALAR=0, SIMD_AVX2, SIMD_AVX512 };
+
+/// best instruction set supported by the cpu
+SOFA_Flexible_API SimdLevel getCpuSimdLevel();
+/// instruction set used by all the kernels: the best one supported by the cpu, unless lowered with setSimdLevel
+SOFA_Flexible_API SimdLevel getSimdLevel();
+/// force an instruction set for all the kernels (e.g. for testing), clamped to what the cpu supports. Returns the level actually used.
+SOFA_Flexible_API SimdLevel setSimdLevel(SimdLevel level);
+SOFA_Flexible_API const char* getSimdLevelName(SimdLevel level);
+
+} // namespace simd
+
+} // namespace defaulttype
+} // namespace sofa
+
+#endif
@@ -64,6 +64,10 @@ template class SOFA_Flexible_API Mapping< Rigid3Types, F311Types >;
 template class SOFA_Flexible_API Mapping< Rigid3Types, F332Types >;
 template class SOFA_Flexible_API Mapping< Rigid3Types, Affine3Types >;
 
+// parents in SReal precision, children in the other one (single precision children in a double build)
+template class SOFA_Flexible_API Mapping< Affine3Types, F331OtherTypes >;
+template class SOFA_Flexible_API Mapping< Rigid3Types, F331OtherTypes >;
+
 
 } // namespace core
 
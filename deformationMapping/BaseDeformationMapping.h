@@ -37,10 +37,14 @@
 #include <sofa/core/visual/VisualParams.h>
 #include <sofa/helper/OptionsGroup.h>
 #include <sofa/helper/kdTree.h>
+#include <sofa/helper/IndexOpenMP.h>
 
 #include <SofaBaseVisual/VisualModelImpl.h>
 #include <SofaEigen2Solver/EigenSparseMatrix.h>
 
+#include "../BlockCSRMatrix.h"
+#include "PointBVH.h"
+
 namespace sofa
 {
 
@@ -107,6 +111,31 @@ public:
     virtual void BackwardMapping(Coord& p0,const Coord& p,const Real Thresh=1e-5, const size_t NbMaxIt=10)=0;     ///< iteratively approximate spatial coord p0 in rest configuration corresponding to the deformed coord p (warning! p0 need to be initialized in the object first, for instance using closest point matching)
     virtual unsigned int getClosestMappedPoint(const Coord& p, Coord& x0,Coord& x, bool useKdTree=false)=0; ///< returns closest mapped point x from input point p, its rest pos x0, and its index
 
+    /// closest mapped points of several input points (see getClosestMappedPoint)
+    virtual void getClosestMappedPoints(const type::vector<Coord>& p, type::vector<Coord>& x0, type::vector<Coord>& x, type::vector<unsigned int>& index)
+    {
+        x0.resize(p.size()); x.resize(p.size()); index.resize(p.size());
+        for(size_t i=0; i<p.size(); i++) index[i]=getClosestMappedPoint(p[i],x0[i],x[i],true);
+    }
+
+    /// approximate the rest coords p0 of several deformed coords p (p0 are initialized with the closest mapped points). Points outside the object get p0=0.
+    /// With \p forceParallel, the points are processed in parallel (when supported) whatever the settings of the mapping, e.g. for the voxels of an image
+    virtual void BackwardMapping(type::vector<Coord>& p0,const type::vector<Coord>& p,const Real Thresh=1e-5, const size_t NbMaxIt=10, bool forceParallel=false)
+    {
+        p0.resize(p.size());
+        if( p.empty() ) return;
+        { Coord x0,x; getClosestMappedPoint(p[0],x0,x,true); } // first, update the point tree to avoid conflicts during parallelization
+#ifdef _OPENMP
+#pragma omp parallel for if (forceParallel)
+#endif
+        for(helper::IndexOpenMP<unsigned int>::type i=0; i<p.size(); i++)
+        {
+            Coord x;
+            getClosestMappedPoint(p[i],p0[i],x,true);
+            BackwardMapping(p0[i],p[i],Thresh,NbMaxIt);
+        }
+    }
+
     virtual void resizeOut(const type::vector<Coord>& position0, type::vector<type::vector<unsigned int> > index,type::vector<type::vector<Real> > w, type::vector<type::vector<type::Vec<spatial_dimensions,Real> > > dw, type::vector<type::vector<type::Mat<spatial_dimensions,spatial_dimensions,Real> > > ddw, type::vector<type::Mat<spatial_dimensions,spatial_dimensions,Real> > F0)=0; /// resizing given custom positions and weights
 };
 
@@ -186,12 +215,14 @@ public:
     typedef type::vector<MaterialToSpatial> VMaterialToSpatial;
     typedef helper::kdTree<Coord> KDT;      ///< kdTree for fast search of closest mapped points
     typedef typename KDT::distanceSet distanceSet;
+    typedef defaulttype::PointBVH<Coord> PointTree; ///< refit-able hierarchy for fast search of closest mapped points
+    typedef std::pair<unsigned int,unsigned int> ChildSlot; ///< (child index i, position k of its block in the jacobian storage) for a given parent
     //@}
 
     /** @name  Jacobian types    */
     //@{
     typedef JacobianBlockType BlockType;
-    typedef type::vector<type::vector<BlockType> >  SparseMatrix;
+    typedef defaulttype::BlockCSRMatrix<BlockType>  SparseMatrix; ///< blocks in compressed row storage (jacobian[i][j] remains available)
 
     typedef typename BlockType::MatBlock  MatBlock;  ///< Jacobian block matrix
     typedef linearsolver::EigenSparseMatrix<In,Out>    SparseMatrixEigen;
@@ -200,7 +231,6 @@ public:
     typedef linearsolver::EigenSparseMatrix<In,In>    SparseKMatrixEigen;
     //@}	
 
-    ///@brief Update \see f_index_parentToChild from \see f_index
     void resizeOut(); /// automatic resizing (of output model and jacobian blocks) when input samples have changed. Recomputes weights from shape function component.
     virtual void resizeOut(const type::vector<Coord>& position0, type::vector<type::vector<unsigned int> > index,type::vector<type::vector<Real> > w, type::vector<type::vector<type::Vec<spatial_dimensions,Real> > > dw, type::vector<type::vector<type::Mat<spatial_dimensions,spatial_dimensions,Real> > > ddw, type::vector<type::Mat<spatial_dimensions,spatial_dimensions,Real> > F0) override; /// resizing given custom positions and weights
 
@@ -217,6 +247,16 @@ public:
      */
     virtual void resizeAll(const InVecCoord& p0, const OutVecCoord& c0, const VecCoord& x0, const VecVRef& index, const VecVReal& w, const VecVGradient& dw, const VecVHessian& ddw, const VMaterialToSpatial& F0);
 
+    ///@brief Drop the weights lower than \see d_weightThreshold times the largest weight of each child, renormalize the others (with their derivatives), and update the nbRef statistics
+    void pruneWeights();
+    ///@brief Same as above on the given weights, without statistics. Returns the number of dropped weights
+    size_t pruneWeights(VecVRef& index, VecVReal& w, VecVGradient& dw, VecVHessian& ddw) const;
+
+    ///@brief Update \see index_parentToChild from the jacobian pattern
+    void updateIndex();
+    ///@brief Update \see index_parentToChild from the jacobian pattern, given parent and child sizes
+    void updateIndex(const size_t parentSize, const size_t childSize);
+
     /** @name Mapping functions */
     //@{
     virtual void init() override;
@@ -234,6 +274,15 @@ public:
     virtual void applyDJT(const core::MechanicalParams* mparams, core::MultiVecDerivId parentDfId, core::ConstMultiVecDerivId ) override;
     virtual void applyJT(const core::ConstraintParams * /*cparams*/ , Data<InMatrixDeriv>& /*out*/, const Data<OutMatrixDeriv>& /*in*/) override;
 
+    /** @name Several right-hand sides
+     * Products with k vectors at once (e.g. for block Krylov solvers or sensitivity analysis): the jacobian is traversed once,
+     * and each block is loaded once for the k products. Same semantics as the single vector versions (applyJ overwrites dOut[v], applyJT accumulates into dIn[v]).
+     */
+    //@{
+    virtual void applyJ(const core::MechanicalParams * mparams , const type::vector<Data<OutVecDeriv>*>& dOut, const type::vector<const Data<InVecDeriv>*>& dIn);
+    virtual void applyJT(const core::MechanicalParams * mparams , const type::vector<Data<InVecDeriv>*>& dIn, const type::vector<const Data<OutVecDeriv>*>& dOut);
+    //@}
+
     const defaulttype::BaseMatrix* getJ(const core::MechanicalParams * /*mparams*/) override;
 
     // Compliant plugin experimental API
@@ -255,14 +304,19 @@ public:
     ///@brief Get parent indices of the i-th child
         virtual const VRef& getChildToParentIndex( int i) { return  f_index.getValue()[i]; }
     ///@brief Get a structure storing parent to child indices as a const reference
+    ///(children of parent p are index_parentToChild[k] for k in [offset[p],offset[p+1]) )
+    const type::vector<unsigned int>& getParentToChildOffsets() const { return index_parentToChild_offset; }
+    const type::vector<ChildSlot>& getParentToChildIndex() const { return index_parentToChild; }
     ///@brief Get a pointer to the shape function where the weights are computed
     virtual BaseShapeFunction* getShapeFunction() { return _shapeFunction; }
     ///@brief Get parent's influence weights on each child
-    virtual VecVReal getWeights(){ return f_w.getValue(); }
+    virtual VecVReal getWeights(){ WeightsScope scope(this); return f_w.getValue(); }
     ///@brief Get parent's influence weights gradient on each child
-    virtual VecVGradient getWeightsGradient(){ return f_dw.getValue(); }
+    virtual VecVGradient getWeightsGradient(){ WeightsScope scope(this); return f_dw.getValue(); }
     ///@brief Get parent's influence weights hessian on each child
-    virtual VecVHessian getWeightsHessian(){ return f_ddw.getValue(); }
+    virtual VecVHessian getWeightsHessian(){ WeightsScope scope(this); return f_ddw.getValue(); }
+    ///@brief Get the number of bytes held by the mapping (weights, jacobian and its indices, assembled matrices, buffers)
+    virtual size_t getMemoryUsage() const;
     ///@brief Get mapped positions
     VecCoord getMappedPositions() { return f_pos; }
     ///@brief Get init positions
@@ -273,6 +327,15 @@ public:
     virtual void ForwardMapping(Coord& p,const Coord& p0) override;
     virtual void BackwardMapping(Coord& p0,const Coord& p,const Real Thresh=1e-5, const size_t NbMaxIt=10) override;
     virtual unsigned int getClosestMappedPoint(const Coord& p, Coord& x0,Coord& x, bool useKdTree=false) override;
+    /// the point tree is updated once, then the queries run in parallel
+    virtual void getClosestMappedPoints(const type::vector<Coord>& p, type::vector<Coord>& x0, type::vector<Coord>& x, type::vector<unsigned int>& index) override;
+    /// points are processed in parallel (with d_parallel or forceParallel), each one starting from the closest mapped point and its weights
+    virtual void BackwardMapping(type::vector<Coord>& p0,const type::vector<Coord>& p,const Real Thresh=1e-5, const size_t NbMaxIt=10, bool forceParallel=false) override;
+
+protected:
+    /// Newton iterations of BackwardMapping, using the given buffers. When \p seeded, ref, w and dw already hold the shape function at p0
+    void BackwardMapping(Coord& p0,const Coord& p,const Real Thresh, const size_t NbMaxIt, VRef& ref, VReal& w, VGradient& dw, bool seeded);
+public:
 
     virtual void mapPosition(Coord& p,const Coord &p0, const VRef& ref, const VReal& w)=0;
     virtual void mapDeformationGradient(MaterialToSpatial& F, const Coord &p0, const MaterialToSpatial& M, const VRef& ref, const VReal& w, const VGradient& dw)=0;
@@ -307,39 +370,119 @@ public:
     Data<VecCoord >    f_pos0; ///< initial spatial positions of children
     VecCoord f_pos;
     VMaterialToSpatial f_F;         ///< current value of deformation gradients (for visualisation)
-    KDT f_KdTree;
+    PointTree f_pointTree;          ///< hierarchy of f_pos (for closest point search)
 
 protected:
     BaseDeformationMappingT (core::State<In>* from = NULL, core::State<Out>* to= NULL);
     ~BaseDeformationMappingT() override { }
 
+    /** @name Child order
+     * Permutation of the children followed by all the loops over children, for locality (see \see d_childOrdering).
+     */
+    //@{
+    type::vector<unsigned int> childOrder; ///< order of the children in the loops over children (empty for the given order)
+    unsigned int child(const size_t ii) const { return childOrder.empty() ? (unsigned int)ii : childOrder[ii]; }
+    void updateChildOrder(const size_t parentSize, const size_t childSize); ///< update childOrder from the rest positions or the jacobian pattern
+    //@}
+
 public:
 
     void mapPositions() ///< map initial spatial positions stored in f_pos0 to f_pos (used for visualization)
     {
+        WeightsScope scope(this);
+        if( !scope.valid ) { this->f_pos = this->f_pos0.getValue(); return; } // weights not available
         this->f_pos.resize(this->f_pos0.getValue().size());
         for(size_t i=0; i<this->f_pos.size(); i++ ) mapPosition(f_pos[i],this->f_pos0.getValue()[i],this->f_index.getValue()[i],this->f_w.getValue()[i]);
     }
 
     void mapDeformationGradients() ///< map initial deform  gradients stored in f_F0 to f_F      (used for visualization)
     {
+        WeightsScope scope(this);
+        if( !scope.valid ) { this->f_F = this->f_F0.getValue(); return; } // weights not available
         this->f_F.resize(this->f_pos0.getValue().size());
         for(size_t i=0; i<this->f_F.size(); i++ ) mapDeformationGradient(f_F[i],this->f_pos0.getValue()[i],this->f_F0.getValue()[i],this->f_index.getValue()[i],this->f_w.getValue()[i],this->f_dw.getValue()[i]);
     }
 
 protected :
     bool missingInformationDirty;  ///< tells if pos or F need to be updated (to speed up visualization)
-    bool KdTreeDirty;              ///< tells if kdtree need to be updated (to speed up closest point search)
+    bool KdTreeDirty;              ///< tells if the point tree needs to be updated (to speed up closest point search)
+    void updatePointTree();        ///< update f_pos and refit f_pointTree to it, if dirty
 
     SparseMatrix jacobian;   ///< Jacobian of the mapping
     virtual void initJacobianBlocks()=0;
     virtual void initJacobianBlocks(const InVecCoord& /*inCoord*/, const OutVecCoord& /*outCoord*/){ std::cout << "Only implemented in LinearMapping for now." << std::endl;}
 
+    /** @name Parent to child index
+     * Transpose of the jacobian pattern in compressed row storage, sorted by increasing child index.
+     * It is used to gather child contributions per parent, so that applyJT can run in parallel without races.
+     */
+    //@{
+    type::vector<unsigned int> index_parentToChild_offset; ///< size nbParents+1
+    type::vector<ChildSlot> index_parentToChild;           ///< size nbChildren*nbRef
+    //@}
+
+    /** @name Assembled matrices
+     * Their compressed patterns are built once (with full blocks, so that they do not depend on the values)
+     * and only their values are overwritten when the blocks change.
+     */
+    //@{
     SparseMatrixEigen eigenJacobian/*, maskedEigenJacobian*/;  ///< Assembled Jacobian matrix
+    bool eigenJacobianDirty;                                  ///< tells if the values of eigenJacobian need to be updated
+    type::vector<unsigned int> eigenJacobianOrder;            ///< blocks of each row sorted by parent index, as stored in eigenJacobian (empty when its pattern needs to be rebuilt)
     type::vector<defaulttype::BaseMatrix*> baseMatrices;      ///< Vector of jacobian matrices, for the Compliant plugin API
     void updateJ();
+    void updateJPattern(const size_t parentSize);
 
     SparseKMatrixEigen K;  ///< Assembled geometric stiffness matrix
+    bool KDirty;           ///< tells if the values of K are not up to date with the child forces
+    void updateKPattern(const size_t parentSize);
+    //@}
+
+    /** @name Incremental apply
+     * Parent positions used by the last evaluation of each child, and the output vector they were mapped to.
+     * Only the children of the parents that moved since then are recomputed (see \see d_incremental).
+     */
+    //@{
+    InVecCoord incrementalParents;                 ///< parent positions the children of the incremental output are up to date with
+    const Data<OutVecCoord>* incrementalOut;       ///< output of the last apply (NULL when a full apply is required)
+    type::vector<unsigned char> incrementalDirty;  ///< children to recompute
+    bool applyIncremental(Data<OutVecCoord>& dOut, const Data<InVecCoord>& dIn); ///< returns false when a full apply is required
+    //@}
+
+    /** @name Active children
+     * Mask built from \see d_activeChildren. Inactive children are skipped by apply (they keep their last value),
+     * their rows of J are null, and they are left out of the parent to child index.
+     */
+    //@{
+    type::vector<unsigned char> activeMask;      ///< empty when all children are active
+    type::vector<unsigned char> activeCatchUp;   ///< children reactivated since the last apply (empty if none)
+    int activeChildrenCounter;                   ///< counter of d_activeChildren when activeMask was built
+    bool isActive(const size_t i) const { return activeMask.empty() || activeMask[i]; }
+    void updateActiveChildren();                 ///< update activeMask (and the parent to child index) if d_activeChildren changed
+    void fillIndex(const size_t parentSize, const size_t childSize); ///< parent to child index of the active children
+    //@}
+
+    /** @name Released weights
+     * Once the jacobian blocks are built, f_w, f_dw and f_ddw are only needed for visualization and queries.
+     * With \see d_releaseWeights, they are cleared after init, and recomputed from the shape function while a WeightsScope is alive.
+     */
+    //@{
+    bool weightsFromShapeFunction;   ///< tells if the weights were computed by the shape function (otherwise they cannot be released)
+    bool weightsReleased;            ///< tells if f_w, f_dw and f_ddw are currently cleared
+    void releaseWeights();           ///< clear f_w, f_dw and f_ddw if required by d_releaseWeights
+    bool restoreWeights();           ///< recompute the released weights (with the same pruning). Returns false if they are not available, or if the shape function does not give the parents of f_index anymore
+    void updateMemoryUsage() { d_memoryUsage.setValue( getMemoryUsage() ); }
+
+    /// restores the released weights for its lifetime
+    struct WeightsScope
+    {
+        BaseDeformationMappingT* mapping;
+        bool released;
+        bool valid;   ///< false if the weights could not be restored (f_w, f_dw and f_ddw are empty)
+        WeightsScope(BaseDeformationMappingT* m) : mapping(m), released(m->weightsReleased) { valid = mapping->restoreWeights(); }
+        ~WeightsScope() { if(released) mapping->releaseWeights(); }
+    };
+    //@}
 
     const core::topology::BaseMeshTopology::SeqTriangles *triangles; // Used for visualization
     const type::vector<component::visualmodel::VisualModelImpl::VisualTriangle> *extTriangles;
@@ -353,6 +496,16 @@ public:
     Data< float > showColorScale; ///< Color mapping scale
     Data< unsigned > d_geometricStiffness; ///< 0=no GS, 1=non symmetric, 2=symmetrized
     Data< bool > d_parallel;		///< use openmp ?
+    Data< bool > d_incremental;        ///< only recompute the children whose parents moved in apply
+    Data< Real > d_incrementalTolerance; ///< parent displacement under which a parent is considered as static
+    Data< Real > d_updatedChildren;    ///< output: fraction of the children recomputed by the last apply
+    Data< type::vector<unsigned int> > d_activeChildren; ///< indices of the children to evaluate (all of them when empty)
+    Data< helper::OptionsGroup > d_childOrdering; ///< order of the children in the loops (None, Morton, RCM)
+    Data< Real > d_weightThreshold;   ///< weights lower than this ratio of the largest weight of a child are dropped at init (0 = keep all)
+    Data< Real > d_averageNbRef;      ///< output: average number of parents per child
+    Data< unsigned int > d_maxNbRef;  ///< output: maximum number of parents per child
+    Data< bool > d_releaseWeights;    ///< clear the weights and their derivatives once the jacobian blocks are built (recomputed on demand)
+    Data< size_t > d_memoryUsage;     ///< output: number of bytes held by the mapping
 };
 
 
@@ -34,6 +34,7 @@
 #endif
 
 #include <limits>
+#include <algorithm>
 
 #include <Eigen/Core>
 #include <Eigen/Dense>
@@ -61,6 +62,12 @@ BaseDeformationMappingT<JacobianBlockType>::BaseDeformationMappingT (core::State
     , f_pos0 ( initData ( &f_pos0,"restPosition","initial spatial positions of children" ) )
     , missingInformationDirty(true)
     , KdTreeDirty(true)
+    , eigenJacobianDirty(true)
+    , KDirty(true)
+    , incrementalOut(NULL)
+    , activeChildrenCounter(-1)
+    , weightsFromShapeFunction(false)
+    , weightsReleased(false)
     , triangles(0)
     , extTriangles(0)
     , extvertPosIdx(0)
@@ -70,6 +77,16 @@ BaseDeformationMappingT<JacobianBlockType>::BaseDeformationMappingT (core::State
     , showColorScale(initData(&showColorScale, (float)1.0, "showColorScale", "Color mapping scale"))
     , d_geometricStiffness(initData(&d_geometricStiffness, 0u, "geometricStiffness", "0=no GS, 1=non symmetric, 2=symmetrized"))
     , d_parallel(initData(&d_parallel, false, "parallel", "use openmp parallelisation?"))
+    , d_incremental(initData(&d_incremental, false, "incremental", "only recompute the children whose parents moved since the last apply"))
+    , d_incrementalTolerance(initData(&d_incrementalTolerance, (Real)0, "incrementalTolerance", "parents whose coordinates changed by less than this value are considered as static (incremental mode)"))
+    , d_updatedChildren(initData(&d_updatedChildren, (Real)1, "updatedChildren", "output: fraction of the children recomputed by the last apply"))
+    , d_activeChildren(initData(&d_activeChildren, "activeChildren", "indices of the children to evaluate, e.g. linked to a ROI (all of them when empty). Inactive children keep their last position"))
+    , d_childOrdering ( initData ( &d_childOrdering,"childOrdering","Order in which the children are processed (their indices do not change): 0 - given order, 1 - Morton code of the rest positions, 2 - reverse Cuthill-McKee on the child-parent graph" ) )
+    , d_weightThreshold(initData(&d_weightThreshold, (Real)0, "weightThreshold", "weights lower than this ratio of the largest weight of a child are dropped at init, the others are renormalized (0 = keep all)"))
+    , d_averageNbRef(initData(&d_averageNbRef, (Real)0, "averageNbRef", "output: average number of parents per child"))
+    , d_maxNbRef(initData(&d_maxNbRef, 0u, "maxNbRef", "output: maximum number of parents per child"))
+    , d_releaseWeights(initData(&d_releaseWeights, false, "releaseWeights", "clear the weights and their derivatives once the jacobian blocks are built, to save memory. They are recomputed from the shape function when needed (visualization, queries)"))
+    , d_memoryUsage(initData(&d_memoryUsage, (size_t)0, "memoryUsage", "output: number of bytes held by the mapping (updated at init and reinit)"))
 {
     helper::OptionsGroup methodOptions(3,"0 - None"
                                        ,"1 - trace(F^T.F)-3"
@@ -85,6 +102,12 @@ BaseDeformationMappingT<JacobianBlockType>::BaseDeformationMappingT (core::State
                                       ,"5 - 1st piola stress" );
     styleOptions.setSelectedItem(0);
     showDeformationGradientStyle.setValue(styleOptions);
+
+    helper::OptionsGroup orderingOptions(3,"0 - None"
+                                         ,"1 - Morton"
+                                         ,"2 - RCM" );
+    orderingOptions.setSelectedItem(0);
+    d_childOrdering.setValue(orderingOptions);
 }
 
 template <class JacobianBlockType>
@@ -126,9 +149,15 @@ void BaseDeformationMappingT<JacobianBlockType>::resizeAll(const InVecCoord& p0,
     for(size_t i=0; i<cSize; ++i)
         wa_F0[i] = F0[i];
 
-    //    updateIndex(p0.size(), c0.size());
+    weightsFromShapeFunction = false;
+    weightsReleased = false;
+    pruneWeights();
 
     initJacobianBlocks(p0, c0);
+
+    updateIndex(p0.size(), c0.size());
+
+    updateMemoryUsage();
 }
 
 template <class JacobianBlockType>
@@ -196,6 +225,7 @@ void BaseDeformationMappingT<JacobianBlockType>::resizeOut()
     if(0 != f_index.getValue().size() && pos0.size() == f_index.getValue().size() && f_w.getValue().size() == f_index.getValue().size()) // we already have the needed data, we directly use them
     {
         msg_info()<<"using filled data";
+        weightsFromShapeFunction = false;
     }
     else if(_shapeFunction) // if we do not have the needed data, and have a shape function, we use it to compute needed data (index, weights, etc.)
     {
@@ -208,17 +238,24 @@ void BaseDeformationMappingT<JacobianBlockType>::resizeOut()
         if(this->f_cell.getValue().size()==size) _shapeFunction->computeShapeFunction(mpos0,*this->f_index.beginWriteOnly(),*this->f_w.beginWriteOnly(),*this->f_dw.beginWriteOnly(),*this->f_ddw.beginWriteOnly(),this->f_cell.getValue());
         else _shapeFunction->computeShapeFunction(mpos0,*this->f_index.beginWriteOnly(),*this->f_w.beginWriteOnly(),*this->f_dw.beginWriteOnly(),*this->f_ddw.beginWriteOnly());
         this->f_index.endEdit();      this->f_w.endEdit();        this->f_dw.endEdit();        this->f_ddw.endEdit();
+        weightsFromShapeFunction = true;
     }
     else // if the prerequisites are not fulfilled we print an error
     {
         serr << "ShapeFunction<"<<ShapeFunctionType::Name()<<"> component not found" << sendl;
     }
+    weightsReleased = false;
 
-    //    updateIndex();
+    pruneWeights();
 
     // init jacobians
     initJacobianBlocks();
 
+    updateIndex();
+
+    // the weights are not needed anymore
+    releaseWeights();
+
     // clear forces
     if(this->toModel->write(core::VecDerivId::force())) { helper::WriteOnlyAccessor<Data< OutVecDeriv > >  f(*this->toModel->write(core::VecDerivId::force())); for(size_t i=0;i<f.size();i++) f[i].clear(); }
     // clear velocities
@@ -264,10 +301,16 @@ void BaseDeformationMappingT<JacobianBlockType>::resizeOut(const type::vector<Co
     helper::WriteOnlyAccessor<Data<VMaterialToSpatial> > wa_F0 (this->f_F0);    wa_F0.resize(size);  for(size_t i=0; i<size; i++ )    for(size_t j=0; j<spatial_dimensions; j++ ) for(size_t k=0; k<material_dimensions; k++ )   wa_F0[i][j][k]=F0[i][j][k];
 
     msg_info()<<size <<" custom gauss points imported";
+    weightsFromShapeFunction = false;
+    weightsReleased = false;
+
+    pruneWeights();
 
     // init jacobians
     initJacobianBlocks();
 
+    updateIndex();
+
     // clear forces
     if(this->toModel->write(core::VecDerivId::force())) { helper::WriteOnlyAccessor<Data< OutVecDeriv > >  f(*this->toModel->write(core::VecDerivId::force())); for(size_t i=0;i<f.size();i++) f[i].clear(); }
     // clear velocities
@@ -290,6 +333,312 @@ void BaseDeformationMappingT<JacobianBlockType>::resizeOut(const type::vector<Co
 }
 
 
+template <class JacobianBlockType>
+void BaseDeformationMappingT<JacobianBlockType>::pruneWeights()
+{
+    helper::WriteAccessor<Data<VecVRef > > index (this->f_index);
+    helper::WriteAccessor<Data<VecVReal > > w (this->f_w);
+    helper::WriteAccessor<Data<VecVGradient > > dw (this->f_dw);
+    helper::WriteAccessor<Data<VecVHessian > > ddw (this->f_ddw);
+
+    const size_t nbDropped = pruneWeights(index.wref(),w.wref(),dw.wref(),ddw.wref());
+
+    // statistics
+    size_t nbRef = 0; unsigned int maxNbRef = 0;
+    for(size_t i=0; i<index.size(); i++) { nbRef += index[i].size(); if( index[i].size()>maxNbRef ) maxNbRef = (unsigned int)index[i].size(); }
+    d_averageNbRef.setValue( index.size() ? (Real)nbRef/(Real)index.size() : (Real)0 );
+    d_maxNbRef.setValue( maxNbRef );
+    msg_info() << "nbRef: average " << d_averageNbRef.getValue() << ", max " << maxNbRef << " (" << nbDropped << " weights dropped)";
+}
+
+template <class JacobianBlockType>
+size_t BaseDeformationMappingT<JacobianBlockType>::pruneWeights(VecVRef& index, VecVReal& w, VecVGradient& dw, VecVHessian& ddw) const
+{
+    const Real threshold = d_weightThreshold.getValue();
+    size_t nbDropped = 0;
+    if( threshold<=0 ) return nbDropped;
+
+    for(size_t i=0; i<w.size() && i<index.size(); i++)
+    {
+        const size_t n = std::min(w[i].size(),index[i].size());
+        const bool hasGradient = i<dw.size() && dw[i].size()==n, hasHessian = hasGradient && i<ddw.size() && ddw[i].size()==n;
+
+        Real wmax = 0;
+        for(size_t j=0; j<n; j++) if( w[i][j]>wmax ) wmax = w[i][j];
+        if( wmax<=0 ) continue; // outside the object
+
+        // compact the kept weights (the largest one is always kept)
+        size_t m = 0;
+        for(size_t j=0; j<n; j++)
+            if( w[i][j]>=threshold*wmax )
+            {
+                index[i][m] = index[i][j]; w[i][m] = w[i][j];
+                if( hasGradient ) dw[i][m] = dw[i][j];
+                if( hasHessian ) ddw[i][m] = ddw[i][j];
+                m++;
+            }
+        nbDropped += n-m;
+        index[i].resize(m); w[i].resize(m);
+        if( hasGradient ) dw[i].resize(m);
+        if( hasHessian ) ddw[i].resize(m);
+        if( m==n ) continue;
+
+        // partition of unity: w' = w/S, with the derivatives of the quotient
+        Real S = 0; Gradient dS; Hessian ddS;
+        for(size_t j=0; j<m; j++)
+        {
+            S += w[i][j];
+            if( hasGradient ) dS += dw[i][j];
+            if( hasHessian ) ddS += ddw[i][j];
+        }
+        const Real invS = (Real)1./S;
+        for(size_t j=0; j<m; j++)
+        {
+            if( hasHessian )
+            {
+                const Gradient& g = dw[i][j];
+                Hessian& H = ddw[i][j];
+                for(unsigned int a=0; a<Gradient::total_size; a++)
+                    for(unsigned int b=0; b<Gradient::total_size; b++)
+                        H[a][b] = H[a][b]*invS - (g[a]*dS[b]+dS[a]*g[b])*invS*invS - w[i][j]*ddS[a][b]*invS*invS + 2*w[i][j]*dS[a]*dS[b]*invS*invS*invS;
+            }
+            if( hasGradient ) dw[i][j] = dw[i][j]*invS - dS*(w[i][j]*invS*invS);
+            w[i][j] *= invS;
+        }
+    }
+
+    return nbDropped;
+}
+
+template <class JacobianBlockType>
+void BaseDeformationMappingT<JacobianBlockType>::releaseWeights()
+{
+    if( !d_releaseWeights.getValue() || weightsReleased ) return;
+    if( !weightsFromShapeFunction || !_shapeFunction ) { msg_warning() << "weights were not computed by a shape function: they cannot be released"; return; }
+
+    VecVReal().swap( *f_w.beginWriteOnly() );          f_w.endEdit();
+    VecVGradient().swap( *f_dw.beginWriteOnly() );     f_dw.endEdit();
+    VecVHessian().swap( *f_ddw.beginWriteOnly() );     f_ddw.endEdit();
+    weightsReleased = true;
+}
+
+template <class JacobianBlockType>
+bool BaseDeformationMappingT<JacobianBlockType>::restoreWeights()
+{
+    if( !weightsReleased ) return true;
+    if( !_shapeFunction || !weightsFromShapeFunction ) return false;
+
+    const VecCoord& pos0 = f_pos0.getValue();
+    type::vector<mCoord> mpos0(pos0.size());
+    for(size_t i=0; i<pos0.size(); ++i) defaulttype::StdVectorTypes<mCoord,mCoord>::set( mpos0[i], pos0[i][0] , pos0[i][1] , pos0[i][2]);
+
+    // same computation as in resizeOut, so that the pattern matches f_index and the jacobian blocks
+    VecVRef index;
+    VecVReal& w = *f_w.beginWriteOnly();
+    VecVGradient& dw = *f_dw.beginWriteOnly();
+    VecVHessian& ddw = *f_ddw.beginWriteOnly();
+    if(this->f_cell.getValue().size()==pos0.size()) _shapeFunction->computeShapeFunction(mpos0,index,w,dw,ddw,this->f_cell.getValue());
+    else _shapeFunction->computeShapeFunction(mpos0,index,w,dw,ddw);
+    pruneWeights(index,w,dw,ddw);
+
+    // the jacobian blocks were built with f_index: weights of other parents cannot be used with them
+    const bool sameParents = index==f_index.getValue();
+    if( !sameParents )
+    {
+        VecVReal().swap(w); VecVGradient().swap(dw); VecVHessian().swap(ddw);
+        weightsFromShapeFunction = false; // reported once
+        msg_error() << "the shape function does not give the parents the mapping was built with anymore: released weights cannot be restored, reinit the mapping";
+    }
+    f_w.endEdit();        f_dw.endEdit();        f_ddw.endEdit();
+
+    weightsReleased = !sameParents;
+    return sameParents;
+}
+
+template <class JacobianBlockType>
+size_t BaseDeformationMappingT<JacobianBlockType>::getMemoryUsage() const
+{
+    size_t bytes = 0;
+
+    // weights
+    const VecVRef& index = f_index.getValue();
+    const VecVReal& w = f_w.getValue();
+    const VecVGradient& dw = f_dw.getValue();
+    const VecVHessian& ddw = f_ddw.getValue();
+    for(size_t i=0; i<index.size(); i++) bytes += index[i].capacity()*sizeof(unsigned int);
+    for(size_t i=0; i<w.size(); i++) bytes += w[i].capacity()*sizeof(Real);
+    for(size_t i=0; i<dw.size(); i++) bytes += dw[i].capacity()*sizeof(Gradient);
+    for(size_t i=0; i<ddw.size(); i++) bytes += ddw[i].capacity()*sizeof(Hessian);
+    bytes += (index.capacity()*sizeof(VRef) + w.capacity()*sizeof(VReal) + dw.capacity()*sizeof(VGradient) + ddw.capacity()*sizeof(VHessian));
+    bytes += f_F0.getValue().capacity()*sizeof(MaterialToSpatial) + f_F.capacity()*sizeof(MaterialToSpatial);
+    bytes += f_pos0.getValue().capacity()*sizeof(Coord) + f_pos.capacity()*sizeof(Coord);
+
+    // jacobian blocks and indices
+    bytes += jacobian.getOffsets().capacity()*sizeof(unsigned int) + jacobian.getIndices().capacity()*sizeof(unsigned int) + jacobian.getBlocks().capacity()*sizeof(BlockType);
+    bytes += index_parentToChild_offset.capacity()*sizeof(unsigned int) + index_parentToChild.capacity()*sizeof(ChildSlot);
+    bytes += childOrder.capacity()*sizeof(unsigned int) + activeMask.capacity() + activeCatchUp.capacity();
+
+    // assembled matrices
+    bytes += eigenJacobian.compressedMatrix.nonZeros()*(sizeof(typename SparseMatrixEigen::Real)+sizeof(int)) + (eigenJacobian.compressedMatrix.outerSize()+1)*sizeof(int);
+    bytes += eigenJacobianOrder.capacity()*sizeof(unsigned int);
+    bytes += K.compressedMatrix.nonZeros()*(sizeof(typename SparseKMatrixEigen::Real)+sizeof(int)) + (K.compressedMatrix.outerSize()+1)*sizeof(int);
+
+    // incremental apply
+    bytes += incrementalParents.capacity()*sizeof(InCoord) + incrementalDirty.capacity();
+
+    return bytes;
+}
+
+template <class JacobianBlockType>
+void BaseDeformationMappingT<JacobianBlockType>::updateIndex()
+{
+    updateIndex(this->fromModel->getSize(), jacobian.size());
+}
+
+template <class JacobianBlockType>
+void BaseDeformationMappingT<JacobianBlockType>::updateIndex(const size_t parentSize, const size_t childSize)
+{
+    // the active children are set again at the next apply
+    activeMask.clear();
+    activeCatchUp.clear();
+    activeChildrenCounter=-1;
+
+    fillIndex(parentSize,childSize);
+    updateChildOrder(parentSize,childSize);
+
+    // the pattern of the assembled jacobian follows the jacobian blocks
+    eigenJacobianOrder.clear();
+    eigenJacobianDirty=true;
+
+    // so do the children: they all need to be recomputed
+    incrementalOut=NULL;
+}
+
+template <class JacobianBlockType>
+void BaseDeformationMappingT<JacobianBlockType>::fillIndex(const size_t parentSize, const size_t childSize)
+{
+    // count children per parent
+    index_parentToChild_offset.assign(parentSize+1,0);
+    for( size_t i=0 ; i<childSize ; ++i)
+        if( isActive(i) )
+            for(size_t k=jacobian.rowBegin(i); k<jacobian.rowEnd(i); k++)
+                index_parentToChild_offset[jacobian.index(k)+1]++;
+    for( size_t p=0 ; p<parentSize ; ++p)
+        index_parentToChild_offset[p+1]+=index_parentToChild_offset[p];
+
+    // fill (children are visited in increasing order, so that each parent row is sorted)
+    index_parentToChild.resize(index_parentToChild_offset[parentSize]);
+    type::vector<unsigned int> pos(index_parentToChild_offset.begin(),index_parentToChild_offset.end()-1);
+    for( size_t i=0 ; i<childSize ; ++i)
+        if( isActive(i) )
+            for(size_t k=jacobian.rowBegin(i); k<jacobian.rowEnd(i); k++)
+                index_parentToChild[pos[jacobian.index(k)]++] = ChildSlot(i,k);
+}
+
+template <class JacobianBlockType>
+void BaseDeformationMappingT<JacobianBlockType>::updateChildOrder(const size_t parentSize, const size_t childSize)
+{
+    childOrder.clear();
+    switch( d_childOrdering.getValue().getSelectedId() )
+    {
+    case 1: // Morton code of the rest positions
+    {
+        const VecCoord& pos0 = f_pos0.getValue();
+        if( pos0.size()!=childSize || !childSize ) return;
+        Coord pmin = pos0[0], pmax = pos0[0];
+        for(size_t i=1; i<childSize; i++) for(unsigned int d=0; d<spatial_dimensions; d++) { pmin[d]=std::min(pmin[d],pos0[i][d]); pmax[d]=std::max(pmax[d],pos0[i][d]); }
+
+        // 21 bits per axis, interleaved
+        const unsigned int bits = 63/spatial_dimensions;
+        type::vector<std::pair<unsigned long long,unsigned int> > codes(childSize);
+        for(size_t i=0; i<childSize; i++)
+        {
+            unsigned long long code = 0;
+            for(unsigned int d=0; d<spatial_dimensions; d++)
+            {
+                const Real extent = pmax[d]-pmin[d];
+                const unsigned long long q = extent>0 ? (unsigned long long)((pos0[i][d]-pmin[d])/extent*(Real)((1ull<<bits)-1)) : 0;
+                for(unsigned int b=0; b<bits; b++) code |= ((q>>b)&1ull) << (b*spatial_dimensions+d);
+            }
+            codes[i] = std::make_pair(code,(unsigned int)i);
+        }
+        std::sort(codes.begin(),codes.end());
+        childOrder.resize(childSize);
+        for(size_t i=0; i<childSize; i++) childOrder[i] = codes[i].second;
+        break;
+    }
+    case 2: // reverse Cuthill-McKee on the child-parent graph: children are numbered by breadth first search through their parents
+    {
+        type::vector<unsigned int> byDegree(childSize);
+        for(size_t i=0; i<childSize; i++) byDegree[i]=(unsigned int)i;
+        std::stable_sort(byDegree.begin(),byDegree.end(),[this](unsigned int a,unsigned int b){ return jacobian.rowEnd(a)-jacobian.rowBegin(a) < jacobian.rowEnd(b)-jacobian.rowBegin(b); });
+
+        type::vector<unsigned char> visitedChild(childSize,0), visitedParent(parentSize,0);
+        childOrder.reserve(childSize);
+        size_t next = 0, start = 0;
+        while( childOrder.size()<childSize )
+        {
+            // new connected component, from a child of minimal degree
+            while( visitedChild[byDegree[start]] ) start++;
+            visitedChild[byDegree[start]]=1;
+            childOrder.push_back(byDegree[start]);
+
+            for( ; next<childOrder.size(); next++)
+            {
+                const unsigned int c = childOrder[next];
+                for(size_t k=jacobian.rowBegin(c); k<jacobian.rowEnd(c); k++)
+                {
+                    const unsigned int p = jacobian.index(k);
+                    if( visitedParent[p] ) continue;
+                    visitedParent[p]=1;
+                    const size_t first = childOrder.size();
+                    for(size_t s=index_parentToChild_offset[p]; s<index_parentToChild_offset[p+1]; s++)
+                    {
+                        const unsigned int i = index_parentToChild[s].first;
+                        if( !visitedChild[i] ) { visitedChild[i]=1; childOrder.push_back(i); }
+                    }
+                    std::stable_sort(childOrder.begin()+first,childOrder.end(),[this](unsigned int a,unsigned int b){ return jacobian.rowEnd(a)-jacobian.rowBegin(a) < jacobian.rowEnd(b)-jacobian.rowBegin(b); });
+                }
+            }
+        }
+        std::reverse(childOrder.begin(),childOrder.end());
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+template <class JacobianBlockType>
+void BaseDeformationMappingT<JacobianBlockType>::updateActiveChildren()
+{
+    const type::vector<unsigned int>& active = d_activeChildren.getValue(); // (updates the engine it is linked to)
+    const size_t childSize = jacobian.size();
+    if( d_activeChildren.getCounter()==activeChildrenCounter && ( activeMask.empty() || activeMask.size()==childSize ) ) return;
+    activeChildrenCounter = d_activeChildren.getCounter();
+
+    type::vector<unsigned char> previous;
+    previous.swap(activeMask);
+    if( !active.empty() )
+    {
+        activeMask.assign(childSize,0);
+        for(size_t j=0; j<active.size(); j++)
+            if( active[j]<childSize ) activeMask[active[j]]=1;
+            else msg_warning() << "activeChildren: index " << active[j] << " out of range";
+    }
+
+    // inactive children are not evaluated: the reactivated ones are caught up at the next apply
+    if( previous.size()==childSize )
+    {
+        activeCatchUp.resize(childSize,0);
+        for(size_t i=0; i<childSize; i++) if( !previous[i] && isActive(i) ) activeCatchUp[i]=1;
+    }
+
+    fillIndex(this->fromModel->getSize(),childSize);
+    eigenJacobianDirty=true; // rows of the inactive children are null
+}
+
+
 template <class JacobianBlockType>
 void BaseDeformationMappingT<JacobianBlockType>::init()
 {
@@ -313,29 +662,97 @@ void BaseDeformationMappingT<JacobianBlockType>::reinit()
     if(this->isMechanical() && this->assemble.getValue()) updateJ();
 
     Inherit::reinit();
+
+    updateMemoryUsage();
 }
 
 
 
+template <class JacobianBlockType>
+void BaseDeformationMappingT<JacobianBlockType>::updateJPattern(const size_t parentSize)
+{
+    enum { NIn = In::deriv_total_size, NOut = Out::deriv_total_size };
+
+    // blocks of each row sorted by parent index
+    eigenJacobianOrder.resize(jacobian.nbBlocks());
+    for( size_t i=0 ; i<jacobian.size() ; ++i)
+    {
+        const size_t b=jacobian.rowBegin(i), e=jacobian.rowEnd(i);
+        for(size_t k=b; k<e; k++) eigenJacobianOrder[k]=(unsigned int)k;
+        std::sort(eigenJacobianOrder.begin()+b,eigenJacobianOrder.begin()+e,[this](unsigned int k1,unsigned int k2){ return jacobian.index(k1)<jacobian.index(k2); });
+    }
+
+    // the scalar row a of child i holds the row a of its blocks, one after the other: the nonzeros of the row start at (rowBegin(i)*NOut + a*rowSize(i))*NIn
+    eigenJacobian.resize(jacobian.size()*NOut,parentSize*NIn);
+    typename SparseMatrixEigen::CompressedMatrix& M = eigenJacobian.compressedMatrix;
+    M.resizeNonZeros(jacobian.nbBlocks()*NOut*NIn);
+    auto* outer = M.outerIndexPtr();
+    auto* inner = M.innerIndexPtr();
+    for( size_t i=0 ; i<jacobian.size() ; ++i)
+    {
+        const size_t b=jacobian.rowBegin(i), n=jacobian.rowEnd(i)-b;
+        for(size_t a=0; a<NOut; a++)
+        {
+            const size_t r = i*NOut+a, start = (b*NOut+a*n)*NIn;
+            outer[r] = start;
+            for(size_t j=0; j<n; j++)
+                for(size_t c=0; c<NIn; c++)
+                    inner[start+j*NIn+c] = jacobian.index(eigenJacobianOrder[b+j])*NIn+c;
+        }
+    }
+    outer[jacobian.size()*NOut] = jacobian.nbBlocks()*NOut*NIn;
+}
+
 template <class JacobianBlockType>
 void BaseDeformationMappingT<JacobianBlockType>::updateJ()
 {
-    helper::ReadAccessor<Data<InVecCoord> > in (*this->fromModel->read(core::ConstVecCoordId::position()));
-    const VecVRef& index = this->f_index.getValue();
+    enum { NIn = In::deriv_total_size, NOut = Out::deriv_total_size };
 
-    SparseMatrixEigen& J = eigenJacobian;
+    helper::ReadAccessor<Data<InVecCoord> > in (*this->fromModel->read(core::ConstVecCoordId::position()));
 
-    J.resizeBlocks(jacobian.size(),in.size());
+    if( eigenJacobianOrder.size()!=jacobian.nbBlocks() || (size_t)eigenJacobian.rows()!=jacobian.size()*NOut || (size_t)eigenJacobian.cols()!=in.size()*NIn )
+        updateJPattern(in.size());
 
-    for( size_t i=0 ; i<jacobian.size() ; ++i)
+    // the pattern does not change: only overwrite the values, row by row
+    auto* values = eigenJacobian.compressedMatrix.valuePtr();
+#ifdef _OPENMP
+#pragma omp parallel for if (this->d_parallel.getValue())
+#endif
+    for(helper::IndexOpenMP<unsigned int>::type i=0; i<jacobian.size(); i++)
     {
-        J.beginBlockRow(i);
-        for(size_t j=0; j<jacobian[i].size(); j++)
-            J.createBlock( index[i][j], jacobian[i][j].getJ());
-        J.endBlockRow();
+        const size_t b=jacobian.rowBegin(i), n=jacobian.rowEnd(i)-b;
+        if( !isActive(i) ) { std::fill(values+b*NOut*NIn,values+(b+n)*NOut*NIn,0); continue; }
+        for(size_t j=0; j<n; j++)
+        {
+            const MatBlock Jb = jacobian.block(eigenJacobianOrder[b+j]).getJ();
+            for(size_t a=0; a<NOut; a++)
+            {
+                auto* v = values + (b*NOut+a*n+j)*NIn;
+                for(size_t c=0; c<NIn; c++) v[c] = Jb[a][c];
+            }
+        }
     }
 
-    J.compress();
+    eigenJacobianDirty=false;
+}
+
+template <class JacobianBlockType>
+void BaseDeformationMappingT<JacobianBlockType>::updateKPattern(const size_t parentSize)
+{
+    enum { NIn = In::deriv_total_size };
+
+    // block diagonal
+    K.resize(parentSize*NIn,parentSize*NIn);
+    typename SparseKMatrixEigen::CompressedMatrix& M = K.compressedMatrix;
+    M.resizeNonZeros(parentSize*NIn*NIn);
+    auto* outer = M.outerIndexPtr();
+    auto* inner = M.innerIndexPtr();
+    for(size_t r=0; r<parentSize*NIn; r++)
+    {
+        outer[r] = r*NIn;
+        for(size_t c=0; c<NIn; c++) inner[r*NIn+c] = (r/NIn)*NIn+c;
+    }
+    outer[parentSize*NIn] = parentSize*NIn*NIn;
 }
 
 template <class JacobianBlockType>
@@ -344,49 +761,58 @@ void BaseDeformationMappingT<JacobianBlockType>::updateK( const core::Mechanical
     SOFA_UNUSED(mparams);
     unsigned geometricStiffness = d_geometricStiffness.getValue();
 
-    if( BlockType::constant || !geometricStiffness ) { K.resize(0,0); return; }
+    if( BlockType::constant || !geometricStiffness ) { K.resize(0,0); KDirty=true; return; }
 
     const OutVecDeriv& childForce = childForceId[this->toModel.get()].read()->getValue();
     helper::ReadAccessor<Data<InVecCoord> > in (*this->fromModel->read(core::ConstVecCoordId::position()));
-    const VecVRef& indices = this->f_index.getValue();
 
-    K.resizeBlocks(in.size(),in.size());
-    type::vector<KBlock> diagonalBlocks; diagonalBlocks.resize(in.size());
+    enum { NIn = In::deriv_total_size };
+    if( (size_t)K.rows()!=in.size()*NIn || (size_t)K.compressedMatrix.nonZeros()!=in.size()*NIn*NIn ) updateKPattern(in.size());
+
+    if( index_parentToChild_offset.size()!=in.size()+1 ) updateIndex(in.size(),jacobian.size());
 
-    // TODO: need to take into account mask in geometric stiffness, I do no think so!??
-    for(size_t i=0; i<jacobian.size(); i++)
+    // gather the child contributions of each parent (see applyJT) and write its diagonal block in place: no race and no temporary blocks
+    const bool stabilization = geometricStiffness==2;
+    auto* values = K.compressedMatrix.valuePtr();
+#ifdef _OPENMP
+#pragma omp parallel for if (this->d_parallel.getValue())
+#endif
+    for(helper::IndexOpenMP<unsigned int>::type p=0; p<in.size(); p++)
     {
-        for(size_t j=0; j<jacobian[i].size(); j++)
+        KBlock Kp = KBlock();
+        for(size_t k=index_parentToChild_offset[p]; k<index_parentToChild_offset[p+1]; k++)
         {
-            size_t index=indices[i][j];
-            diagonalBlocks[index] += jacobian[i][j].getK(childForce[i], geometricStiffness==2);
+            const ChildSlot& c = index_parentToChild[k];
+            Kp += jacobian.block(c.second).getK(childForce[c.first], stabilization);
         }
+
+        auto* v = values + p*NIn*NIn;
+        for(size_t a=0; a<NIn; a++)
+            for(size_t b=0; b<NIn; b++)
+                v[a*NIn+b] = Kp[a][b];
     }
 
-    for(size_t i=0; i<in.size(); i++)
-        K.insertBackBlock(i,i,diagonalBlocks[i]);
-    K.compress();
+    KDirty=false;
 }
 
 template <class JacobianBlockType>
 void BaseDeformationMappingT<JacobianBlockType>::apply(OutVecCoord& out, const InVecCoord& in)
 {
-    const VecVRef& indices = this->f_index.getValue();
+    updateActiveChildren();
 
 #ifdef _OPENMP
 #pragma omp parallel for if (this->d_parallel.getValue())
 #endif
-    for(helper::IndexOpenMP<unsigned int>::type i=0; i<jacobian.size(); i++)
+    for(helper::IndexOpenMP<unsigned int>::type ii=0; ii<jacobian.size(); ii++)
     {
+        const size_t i = child(ii);
+        if( !isActive(i) ) continue; // inactive children keep their value, as in the mparams version
         out[i]=OutCoord();
-        for(size_t j=0; j<jacobian[i].size(); j++)
-        {
-            size_t index=indices[i][j];
-            jacobian[i][j].addapply(out[i],in[index]);
-        }
+        for(size_t k=jacobian.rowBegin(i); k<jacobian.rowEnd(i); k++)
+            jacobian.block(k).addapply(out[i],in[jacobian.index(k)]);
     }
 
-    if(this->assemble.getValue() && ( !BlockType::constant ) )  eigenJacobian.resize(0,0); // J needs to be updated later where the dof mask can be activated
+    if(this->assemble.getValue() && ( !BlockType::constant ) )  eigenJacobianDirty=true; // J needs to be updated later where the dof mask can be activated
 
     this->missingInformationDirty=true; this->KdTreeDirty=true; // need to update spatial positions of defo grads if needed for visualization
 }
@@ -396,21 +822,21 @@ void BaseDeformationMappingT<JacobianBlockType>::applyJ(OutVecDeriv& out, const
 {
     if(this->assemble.getValue())
     {
-        if( !eigenJacobian.rows() ) updateJ();
+        if( eigenJacobianDirty ) updateJ();
         eigenJacobian.mult(out,in);
     }
     else
     {
-        const VecVRef& indices = this->f_index.getValue();
-
-        for( size_t i=0 ; i<jacobian.size() ; ++i)
+#ifdef _OPENMP
+#pragma omp parallel for if (this->d_parallel.getValue())
+#endif
+        for(helper::IndexOpenMP<unsigned int>::type ii=0; ii<jacobian.size(); ii++)
         {
+            const size_t i = child(ii);
             out[i]=OutDeriv();
-            for(size_t j=0; j<jacobian[i].size(); j++)
-            {
-                size_t index=indices[i][j];
-                jacobian[i][j].addmult(out[i],in[index]);
-            }
+            if( !isActive(i) ) continue;
+            for(size_t k=jacobian.rowBegin(i); k<jacobian.rowEnd(i); k++)
+                jacobian.block(k).addmult(out[i],in[jacobian.index(k)]);
         }
     }
 }
@@ -418,34 +844,95 @@ void BaseDeformationMappingT<JacobianBlockType>::applyJ(OutVecDeriv& out, const
 template <class JacobianBlockType>
 void BaseDeformationMappingT<JacobianBlockType>::apply(const core::MechanicalParams * /*mparams*/ , Data<OutVecCoord>& dOut, const Data<InVecCoord>& dIn)
 {
-    OutVecCoord& out = *dOut.beginWriteOnly();
+    updateActiveChildren();
+    if( d_incremental.getValue() && !this->f_printLog.getValue() && applyIncremental(dOut,dIn) ) return;
+
+    OutVecCoord& out = activeMask.empty() ? *dOut.beginWriteOnly() : *dOut.beginEdit(); // inactive children keep their value
     const InVecCoord& in = dIn.getValue();
-    const VecVRef& indices = this->f_index.getValue();
 
     std::stringstream tmp;
 #ifdef _OPENMP
 #pragma omp parallel for if (this->d_parallel.getValue())
 #endif
-    for(helper::IndexOpenMP<unsigned int>::type i=0; i<jacobian.size(); i++)
+    for(helper::IndexOpenMP<unsigned int>::type ii=0; ii<jacobian.size(); ii++)
     {
+        const size_t i = child(ii);
+        if( !isActive(i) ) continue;
         out[i]=OutCoord();
         if (i == 0 && this->f_printLog.getValue())
             tmp << "out[0] = " << out[i] << msgendl;
-        for(size_t j=0; j<jacobian[i].size(); j++)
+        for(size_t k=jacobian.rowBegin(i); k<jacobian.rowEnd(i); k++)
         {
-            size_t index=indices[i][j];
-            jacobian[i][j].addapply(out[i],in[index]);
+            size_t index=jacobian.index(k);
+            jacobian.block(k).addapply(out[i],in[index]);
             if (i == 0 && this->f_printLog.getValue())
-                tmp << "out["<<i<<"] + jacobian["<<i<<"]["<<j<<"].addapply(out["<<i<<"],in["<<index<<"]) = " << out[i] ;
+                tmp << "out["<<i<<"] + jacobian["<<i<<"]["<<k-jacobian.rowBegin(i)<<"].addapply(out["<<i<<"],in["<<index<<"]) = " << out[i] ;
         }
     }
     dOut.endEdit();
 
     msg_info_when(!tmp.str().empty()) << tmp.str() ;
 
-    if(this->assemble.getValue() && ( !BlockType::constant ) ) eigenJacobian.resize(0,0); // J needs to be updated later where the dof mask can be activated
+    if(this->assemble.getValue() && ( !BlockType::constant ) ) eigenJacobianDirty=true; // J needs to be updated later where the dof mask can be activated
 
     this->missingInformationDirty=true; this->KdTreeDirty=true; // need to update spatial positions of defo grads if needed for visualization
+
+    if( d_incremental.getValue() )
+    {
+        incrementalParents = in;
+        incrementalOut = &dOut;
+    }
+    else incrementalOut = NULL;
+    activeCatchUp.clear();
+    d_updatedChildren.setValue((Real)1);
+}
+
+template <class JacobianBlockType>
+bool BaseDeformationMappingT<JacobianBlockType>::applyIncremental(Data<OutVecCoord>& dOut, const Data<InVecCoord>& dIn)
+{
+    const InVecCoord& in = dIn.getValue();
+    if( incrementalOut!=&dOut || incrementalParents.size()!=in.size() || dOut.getValue().size()!=jacobian.size() ) return false;
+    if( index_parentToChild_offset.size()!=in.size()+1 ) return false;
+
+    // mark the children of the parents that moved. Static parents keep their reference position, so that slow motions are not missed
+    const Real tolerance = d_incrementalTolerance.getValue();
+    incrementalDirty.assign(jacobian.size(),0);
+    for(size_t p=0; p<in.size(); p++)
+    {
+        const InDeriv d = In::coordDifference(in[p],incrementalParents[p]);
+        bool moved = false;
+        for(size_t c=0; c<In::deriv_total_size && !moved; c++) if( std::abs(d[c])>tolerance ) moved = true;
+        if( !moved ) continue;
+        incrementalParents[p] = in[p];
+        for(size_t k=index_parentToChild_offset[p]; k<index_parentToChild_offset[p+1]; k++) incrementalDirty[index_parentToChild[k].first] = 1;
+    }
+    for(size_t i=0; i<activeCatchUp.size(); i++) if( activeCatchUp[i] && isActive(i) ) incrementalDirty[i] = 1;
+    activeCatchUp.clear();
+
+    // the other children keep their previous values
+    OutVecCoord& out = *dOut.beginEdit();
+    int nbUpdated = 0;
+#ifdef _OPENMP
+#pragma omp parallel for if (this->d_parallel.getValue()) reduction(+:nbUpdated)
+#endif
+    for(helper::IndexOpenMP<unsigned int>::type ii=0; ii<jacobian.size(); ii++)
+    {
+        const size_t i = child(ii);
+        if( !incrementalDirty[i] ) continue;
+        out[i]=OutCoord();
+        for(size_t k=jacobian.rowBegin(i); k<jacobian.rowEnd(i); k++)
+            jacobian.block(k).addapply(out[i],in[jacobian.index(k)]);
+        nbUpdated++;
+    }
+    dOut.endEdit();
+
+    if( nbUpdated )
+    {
+        if(this->assemble.getValue() && ( !BlockType::constant ) ) eigenJacobianDirty=true;
+        this->missingInformationDirty=true; this->KdTreeDirty=true;
+    }
+    d_updatedChildren.setValue( jacobian.size() ? (Real)nbUpdated/(Real)jacobian.size() : (Real)0 );
+    return true;
 }
 
 
@@ -455,23 +942,23 @@ void BaseDeformationMappingT<JacobianBlockType>::applyJ(const core::MechanicalPa
 {
     if(this->assemble.getValue())
     {
-        if( !eigenJacobian.rows() ) updateJ();
+        if( eigenJacobianDirty ) updateJ();
         eigenJacobian.mult(dOut,dIn);
     }
     else
     {
         OutVecDeriv& out = *dOut.beginWriteOnly();
         const InVecDeriv& in = dIn.getValue();
-        const VecVRef& indices = this->f_index.getValue();
-
-        for( size_t i=0 ; i<jacobian.size() ; ++i)
+#ifdef _OPENMP
+#pragma omp parallel for if (this->d_parallel.getValue())
+#endif
+        for(helper::IndexOpenMP<unsigned int>::type ii=0; ii<jacobian.size(); ii++)
         {
+            const size_t i = child(ii);
             out[i]=OutDeriv();
-            for(size_t j=0; j<jacobian[i].size(); j++)
-            {
-                size_t index=indices[i][j];
-                jacobian[i][j].addmult(out[i],in[index]);
-            }
+            if( !isActive(i) ) continue;
+            for(size_t k=jacobian.rowBegin(i); k<jacobian.rowEnd(i); k++)
+                jacobian.block(k).addmult(out[i],in[jacobian.index(k)]);
         }
 
         dOut.endEdit();
@@ -483,21 +970,27 @@ void BaseDeformationMappingT<JacobianBlockType>::applyJT(const core::MechanicalP
 {
     if(this->assemble.getValue())
     {
-        if( !eigenJacobian.rows() ) updateJ();
+        if( eigenJacobianDirty ) updateJ();
         eigenJacobian.addMultTranspose(dIn,dOut);
     }
     else
     {
         InVecDeriv& in = *dIn.beginEdit();
         const OutVecDeriv& out = dOut.getValue();
-        const VecVRef& indices = this->f_index.getValue();
 
-        for( size_t i=0 ; i<jacobian.size() ; ++i)
+        if( index_parentToChild_offset.size()!=in.size()+1 ) updateIndex(in.size(),jacobian.size());
+
+        // gather child contributions per parent: no race between threads,
+        // and the summation order (increasing child index) does not depend on the number of threads
+#ifdef _OPENMP
+#pragma omp parallel for if (this->d_parallel.getValue())
+#endif
+        for(helper::IndexOpenMP<unsigned int>::type p=0; p<in.size(); p++)
         {
-            for(size_t j=0; j<jacobian[i].size(); j++)
+            for(size_t k=index_parentToChild_offset[p]; k<index_parentToChild_offset[p+1]; k++)
             {
-                size_t index=indices[i][j];
-                jacobian[i][j].addMultTranspose(in[index],out[i]);
+                const ChildSlot& c = index_parentToChild[k];
+                jacobian.block(c.second).addMultTranspose(in[p],out[c.first]);
             }
         }
 
@@ -505,6 +998,93 @@ void BaseDeformationMappingT<JacobianBlockType>::applyJT(const core::MechanicalP
     }
 }
 
+template <class JacobianBlockType>
+void BaseDeformationMappingT<JacobianBlockType>::applyJ(const core::MechanicalParams * /*mparams*/ , const type::vector<Data<OutVecDeriv>*>& dOut, const type::vector<const Data<InVecDeriv>*>& dIn)
+{
+    enum { NIn = In::deriv_total_size, NOut = Out::deriv_total_size };
+    const size_t nbRhs = std::min(dOut.size(),dIn.size());
+    if( !nbRhs ) return;
+
+    type::vector<OutVecDeriv*> out(nbRhs);
+    type::vector<const InVecDeriv*> in(nbRhs);
+    for(size_t v=0; v<nbRhs; v++) { out[v] = dOut[v]->beginWriteOnly(); in[v] = &dIn[v]->getValue(); }
+
+    if(this->assemble.getValue())
+    {
+        // one sparse x dense product
+        if( eigenJacobianDirty ) updateJ();
+        typedef Eigen::Matrix<typename SparseMatrixEigen::CompressedMatrix::Scalar,Eigen::Dynamic,Eigen::Dynamic> DenseMatrix;
+        DenseMatrix X(eigenJacobian.cols(),nbRhs);
+        for(size_t v=0; v<nbRhs; v++) for(size_t p=0; p<in[v]->size(); p++) for(size_t c=0; c<NIn; c++) X(p*NIn+c,v) = (*in[v])[p][c];
+        const DenseMatrix Y = eigenJacobian.compressedMatrix * X;
+        for(size_t v=0; v<nbRhs; v++) for(size_t i=0; i<out[v]->size(); i++) for(size_t a=0; a<NOut; a++) (*out[v])[i][a] = Y(i*NOut+a,v);
+    }
+    else
+    {
+#ifdef _OPENMP
+#pragma omp parallel for if (this->d_parallel.getValue())
+#endif
+        for(helper::IndexOpenMP<unsigned int>::type ii=0; ii<jacobian.size(); ii++)
+        {
+            const size_t i = child(ii);
+            for(size_t v=0; v<nbRhs; v++) (*out[v])[i]=OutDeriv();
+            if( !isActive(i) ) continue;
+            for(size_t k=jacobian.rowBegin(i); k<jacobian.rowEnd(i); k++)
+            {
+                BlockType& b = jacobian.block(k);
+                const unsigned int p = jacobian.index(k);
+                for(size_t v=0; v<nbRhs; v++) b.addmult((*out[v])[i],(*in[v])[p]);
+            }
+        }
+    }
+
+    for(size_t v=0; v<nbRhs; v++) dOut[v]->endEdit();
+}
+
+template <class JacobianBlockType>
+void BaseDeformationMappingT<JacobianBlockType>::applyJT(const core::MechanicalParams * /*mparams*/ , const type::vector<Data<InVecDeriv>*>& dIn, const type::vector<const Data<OutVecDeriv>*>& dOut)
+{
+    enum { NIn = In::deriv_total_size, NOut = Out::deriv_total_size };
+    const size_t nbRhs = std::min(dOut.size(),dIn.size());
+    if( !nbRhs ) return;
+
+    type::vector<InVecDeriv*> in(nbRhs);
+    type::vector<const OutVecDeriv*> out(nbRhs);
+    for(size_t v=0; v<nbRhs; v++) { in[v] = dIn[v]->beginEdit(); out[v] = &dOut[v]->getValue(); }
+
+    if(this->assemble.getValue())
+    {
+        // one sparse x dense product
+        if( eigenJacobianDirty ) updateJ();
+        typedef Eigen::Matrix<typename SparseMatrixEigen::CompressedMatrix::Scalar,Eigen::Dynamic,Eigen::Dynamic> DenseMatrix;
+        DenseMatrix Y(eigenJacobian.rows(),nbRhs);
+        for(size_t v=0; v<nbRhs; v++) for(size_t i=0; i<out[v]->size(); i++) for(size_t a=0; a<NOut; a++) Y(i*NOut+a,v) = (*out[v])[i][a];
+        const DenseMatrix X = eigenJacobian.compressedMatrix.transpose() * Y;
+        for(size_t v=0; v<nbRhs; v++) for(size_t p=0; p<in[v]->size(); p++) for(size_t c=0; c<NIn; c++) (*in[v])[p][c] += X(p*NIn+c,v);
+    }
+    else
+    {
+        const size_t parentSize = in[0]->size();
+        if( index_parentToChild_offset.size()!=parentSize+1 ) updateIndex(parentSize,jacobian.size());
+
+        // gather per parent (see applyJT)
+#ifdef _OPENMP
+#pragma omp parallel for if (this->d_parallel.getValue())
+#endif
+        for(helper::IndexOpenMP<unsigned int>::type p=0; p<parentSize; p++)
+        {
+            for(size_t k=index_parentToChild_offset[p]; k<index_parentToChild_offset[p+1]; k++)
+            {
+                const ChildSlot& c = index_parentToChild[k];
+                BlockType& b = jacobian.block(c.second);
+                for(size_t v=0; v<nbRhs; v++) b.addMultTranspose((*in[v])[p],(*out[v])[c.first]);
+            }
+        }
+    }
+
+    for(size_t v=0; v<nbRhs; v++) dIn[v]->endEdit();
+}
+
 template <class JacobianBlockType>
 void BaseDeformationMappingT<JacobianBlockType>::applyDJT(const core::MechanicalParams* mparams, core::MultiVecDerivId parentDfId, core::ConstMultiVecDerivId childForceId )
 {
@@ -518,7 +1098,7 @@ void BaseDeformationMappingT<JacobianBlockType>::applyDJT(const core::Mechanical
     helper::ReadAccessor<Data<InVecDeriv> > parentDisplacement (parentDisplacementData);
     helper::ReadAccessor<Data<OutVecDeriv> > childForce (childForceData);
 
-    if( assemble.getValue() && K.compressedMatrix.nonZeros() ) // assembled version
+    if( assemble.getValue() && !KDirty ) // assembled version
     {
         assert( this->assemble.getValue() );
         K.addMult(parentForceData,parentDisplacementData,mparams->kFactor());
@@ -530,18 +1110,23 @@ void BaseDeformationMappingT<JacobianBlockType>::applyDJT(const core::Mechanical
         {
             updateK( mparams, childForceId );
             K.addMult(parentForceData,parentDisplacementData,mparams->kFactor());
-            K.resize(0,0); // forgot about this matrix
+            KDirty=true; // forget about these values (the pattern is kept for the next time)
         }
         else
         {
+            if( index_parentToChild_offset.size()!=parentForce.size()+1 ) updateIndex(parentForce.size(),jacobian.size());
 
-            const VecVRef& indices = this->f_index.getValue();
-            for( size_t i=0 ; i<jacobian.size() ; ++i)
+            // gather per parent (see applyJT)
+            const SReal kfactor = mparams->kFactor();
+#ifdef _OPENMP
+#pragma omp parallel for if (this->d_parallel.getValue())
+#endif
+            for(helper::IndexOpenMP<unsigned int>::type p=0; p<parentForce.size(); p++)
             {
-                for(size_t j=0; j<jacobian[i].size(); j++)
+                for(size_t k=index_parentToChild_offset[p]; k<index_parentToChild_offset[p+1]; k++)
                 {
-                    size_t index=indices[i][j];
-                    jacobian[i][j].addDForce(parentForce[index],parentDisplacement[index],childForce[i], mparams->kFactor());
+                    const ChildSlot& c = index_parentToChild[k];
+                    jacobian.block(c.second).addDForce(parentForce[p],parentDisplacement[p],childForce[c.first], kfactor);
                 }
             }
         }
@@ -553,40 +1138,60 @@ void BaseDeformationMappingT<JacobianBlockType>::applyDJT(const core::Mechanical
 template <class JacobianBlockType>
 void BaseDeformationMappingT<JacobianBlockType>::applyJT( const core::ConstraintParams * /*cparams*/, Data<InMatrixDeriv>& _out, const Data<OutMatrixDeriv>& _in )
 {
-    // TODO handle mask
+    typedef typename OutMatrixDeriv::RowConstIterator RowConstIterator;
+    typedef typename OutMatrixDeriv::ColConstIterator ColConstIterator;
+    typedef std::pair<unsigned int,InDeriv> ParentCol;
 
-    InMatrixDeriv& out = *_out.beginEdit();
     const OutMatrixDeriv& in = _in.getValue();
-    const VecVRef& indices = this->f_index.getValue();
 
-    typename OutMatrixDeriv::RowConstIterator rowItEnd = in.end();
+    type::vector<RowConstIterator> rows;
+    for (RowConstIterator rowIt = in.begin(); rowIt != in.end(); ++rowIt)
+        if (rowIt.begin() != rowIt.end()) rows.push_back(rowIt);
 
-    for (typename OutMatrixDeriv::RowConstIterator rowIt = in.begin(); rowIt != rowItEnd; ++rowIt)
+    // rows are processed independently: the contributions of their children are summed per parent (neighbouring children share parents),
+    // so that each parent appears once per row, by increasing index
+    type::vector<type::vector<ParentCol> > cols(rows.size());
+    const size_t parentSize = this->fromModel->getSize();
+#ifdef _OPENMP
+#pragma omp parallel if (this->d_parallel.getValue())
+#endif
     {
-        typename OutMatrixDeriv::ColConstIterator colItEnd = rowIt.end();
-        typename OutMatrixDeriv::ColConstIterator colIt = rowIt.begin();
-
-        if (colIt != colItEnd)
+        type::vector<InDeriv> sum(parentSize);          // dense accumulator of each thread
+        type::vector<unsigned int> stamp(parentSize,0);  // last row (+1) that touched each parent
+        type::vector<unsigned int> touched;
+#ifdef _OPENMP
+#pragma omp for
+#endif
+        for(helper::IndexOpenMP<unsigned int>::type r=0; r<rows.size(); r++)
         {
-            typename InMatrixDeriv::RowIterator o = out.writeLine(rowIt.index());
-
-            for ( ; colIt != colItEnd; ++colIt)
+            const unsigned int rowStamp = (unsigned int)r+1;
+            touched.clear();
+            for (ColConstIterator colIt = rows[r].begin(); colIt != rows[r].end(); ++colIt)
             {
-                size_t indexIn = colIt.index();
+                const size_t indexIn = colIt.index();
+                if( !isActive(indexIn) ) continue;
 
-                for(size_t j=0; j<jacobian[indexIn].size(); j++)
+                for(size_t k=jacobian.rowBegin(indexIn); k<jacobian.rowEnd(indexIn); k++)
                 {
-                    size_t indexOut = indices[indexIn][j];
-
-                    InDeriv tmp;
-                    jacobian[indexIn][j].addMultTranspose( tmp, colIt.val() );
-
-                    o.addCol( indexOut, tmp );
+                    const unsigned int indexOut = jacobian.index(k);
+                    if( stamp[indexOut]!=rowStamp ) { stamp[indexOut]=rowStamp; sum[indexOut]=InDeriv(); touched.push_back(indexOut); }
+                    jacobian.block(k).addMultTranspose( sum[indexOut], colIt.val() );
                 }
             }
+
+            std::sort(touched.begin(),touched.end());
+            cols[r].resize(touched.size());
+            for(size_t j=0; j<touched.size(); j++) cols[r][j] = ParentCol(touched[j],sum[touched[j]]);
         }
     }
 
+    // the output matrix is written sequentially
+    InMatrixDeriv& out = *_out.beginEdit();
+    for(size_t r=0; r<rows.size(); r++)
+    {
+        typename InMatrixDeriv::RowIterator o = out.writeLine(rows[r].index());
+        for(size_t j=0; j<cols[r].size(); j++) o.addCol( cols[r][j].first, cols[r][j].second );
+    }
     _out.endEdit();
 }
 
@@ -617,10 +1222,17 @@ void BaseDeformationMappingT<JacobianBlockType>::BackwardMapping(Coord& p0,const
 {
     if ( !_shapeFunction ) return;
 
+    VRef ref; VReal w; VGradient dw;
+    BackwardMapping(p0,p,Thresh,NbMaxIt,ref,w,dw,false);
+}
+
+template <class JacobianBlockType>
+void BaseDeformationMappingT<JacobianBlockType>::BackwardMapping(Coord& p0,const Coord& p,const Real Thresh, const size_t NbMaxIt, VRef& ref, VReal& w, VGradient& dw, bool seeded)
+{
     // iterate: p0(n+1) = F0.F^-1 (p-p(n)) + p0(n)
     size_t count=0;
     mCoord mp0;
-    MaterialToSpatial F0;  VRef ref; VReal w; VGradient dw;
+    MaterialToSpatial F0;
     Coord pnew;
     MaterialToSpatial F;
     type::Mat<material_dimensions,spatial_dimensions,Real> Finv;
@@ -628,9 +1240,13 @@ void BaseDeformationMappingT<JacobianBlockType>::BackwardMapping(Coord& p0,const
     identity(F0);
     while(count<NbMaxIt)
     {
-        defaulttype::StdVectorTypes<mCoord,mCoord>::set( mp0, p0[0] , p0[1] , p0[2]);
-        _shapeFunction->computeShapeFunction(mp0,ref,w,&dw);
-        if(!w[0]) { p0=Coord(); return; } // outside object
+        if( !seeded )
+        {
+            defaulttype::StdVectorTypes<mCoord,mCoord>::set( mp0, p0[0] , p0[1] , p0[2]);
+            _shapeFunction->computeShapeFunction(mp0,ref,w,&dw);
+        }
+        seeded=false;
+        if(w.empty() || !w[0]) { p0=Coord(); return; } // outside object
 
         this->mapPosition(pnew,p0,ref,w);
         if((p-pnew).norm2()<Thresh) return; // has converged
@@ -642,31 +1258,86 @@ void BaseDeformationMappingT<JacobianBlockType>::BackwardMapping(Coord& p0,const
     }
 }
 
+template <class JacobianBlockType>
+void BaseDeformationMappingT<JacobianBlockType>::BackwardMapping(type::vector<Coord>& p0,const type::vector<Coord>& p,const Real Thresh, const size_t NbMaxIt, bool forceParallel)
+{
+    p0.resize(p.size());
+    if ( !_shapeFunction ) return;
+
+    updatePointTree();
+
+    // the shape function of the closest child is known at its rest position: it is used for the first iteration
+    const VecCoord& pos0 = f_pos0.getValue();
+    const VecVRef& index = f_index.getValue();
+    const VecVReal& weights = f_w.getValue();
+    const VecVGradient& weightGradients = f_dw.getValue();
+    const bool seeds = index.size()==f_pos.size() && weights.size()==f_pos.size() && weightGradients.size()==f_pos.size();
+
+#ifdef _OPENMP
+#pragma omp parallel if (forceParallel || this->d_parallel.getValue())
+#endif
+    {
+        VRef ref; VReal w; VGradient dw; // buffers of each thread
+#ifdef _OPENMP
+#pragma omp for
+#endif
+        for(helper::IndexOpenMP<unsigned int>::type i=0; i<p.size(); i++)
+        {
+            const unsigned int c = f_pointTree.getClosest(p[i],f_pos);
+            if( c>=pos0.size() ) { p0[i]=Coord(); continue; }
+            p0[i] = pos0[c];
+            if( seeds )
+            {
+                ref.assign(index[c].begin(),index[c].end());
+                w.assign(weights[c].begin(),weights[c].end());
+                dw.assign(weightGradients[c].begin(),weightGradients[c].end());
+            }
+            BackwardMapping(p0[i],p[i],Thresh,NbMaxIt,ref,w,dw,seeds);
+        }
+    }
+}
+
 
 template <class JacobianBlockType>
-unsigned int BaseDeformationMappingT<JacobianBlockType>::getClosestMappedPoint(const Coord& p, Coord& x0,Coord& x, bool useKdTree)
+void BaseDeformationMappingT<JacobianBlockType>::updatePointTree()
 {
-    helper::ReadAccessor<Data<OutVecCoord> > out (*this->toModel->read(core::ConstVecCoordId::position()));
-    if(this->missingInformationDirty)
+    if(OutDataTypesInfo<Out>::positionMapped)
     {
-        if(!OutDataTypesInfo<Out>::positionMapped) mapPositions();
-        this->missingInformationDirty=false;
+        if(!this->KdTreeDirty && f_pointTree.size()==f_pos.size()) return;
+        helper::ReadAccessor<Data<OutVecCoord> > out (*this->toModel->read(core::ConstVecCoordId::position()));
+        f_pos.resize(out.size()); for(size_t i=0; i<out.size(); i++ )  Out::get(f_pos[i][0],f_pos[i][1],f_pos[i][2],out[i]); // copy to f_pos
+    }
+    else
+    {
+        if(this->missingInformationDirty) { mapPositions(); this->missingInformationDirty=false; }
+        else if(!this->KdTreeDirty && f_pointTree.size()==f_pos.size()) return;
     }
 
+    // small motions only need a refit of the boxes
+    f_pointTree.update(f_pos);
+    this->KdTreeDirty=false;
+}
+
+template <class JacobianBlockType>
+unsigned int BaseDeformationMappingT<JacobianBlockType>::getClosestMappedPoint(const Coord& p, Coord& x0,Coord& x, bool useKdTree)
+{
     size_t index=0;
     if(useKdTree)
     {
-        if(this->KdTreeDirty)
-        {
-            if(OutDataTypesInfo<Out>::positionMapped) { f_pos.resize(out.size()); for(size_t i=0; i<out.size(); i++ )  Out::get(f_pos[i][0],f_pos[i][1],f_pos[i][2],out[i]);  } // copy to f_pos
-            this->f_KdTree.build(f_pos);
-            this->KdTreeDirty=false;
-        }
-        index=this->f_KdTree.getClosest(p,f_pos);
+        updatePointTree();
+        if( f_pointTree.empty() ) return (unsigned int)-1;
+        index=this->f_pointTree.getClosest(p,f_pos);
         x=f_pos[index];
     }
     else
     {
+        helper::ReadAccessor<Data<OutVecCoord> > out (*this->toModel->read(core::ConstVecCoordId::position()));
+        if(this->missingInformationDirty)
+        {
+            if(!OutDataTypesInfo<Out>::positionMapped) mapPositions();
+            this->missingInformationDirty=false;
+        }
+
         Real dmin=std::numeric_limits<Real>::max();
         for(size_t i=0; i<out.size(); i++)
         {
@@ -679,6 +1350,25 @@ unsigned int BaseDeformationMappingT<JacobianBlockType>::getClosestMappedPoint(c
     return index;
 }
 
+template <class JacobianBlockType>
+void BaseDeformationMappingT<JacobianBlockType>::getClosestMappedPoints(const type::vector<Coord>& p, type::vector<Coord>& x0, type::vector<Coord>& x, type::vector<unsigned int>& index)
+{
+    x0.resize(p.size()); x.resize(p.size()); index.resize(p.size());
+    updatePointTree();
+    if( f_pointTree.empty() ) { std::fill(index.begin(),index.end(),(unsigned int)-1); return; }
+
+    const VecCoord& pos0 = f_pos0.getValue();
+#ifdef _OPENMP
+#pragma omp parallel for if (this->d_parallel.getValue())
+#endif
+    for(helper::IndexOpenMP<unsigned int>::type i=0; i<p.size(); i++)
+    {
+        index[i]=f_pointTree.getClosest(p[i],f_pos);
+        x[i]=f_pos[index[i]];
+        x0[i]=pos0[index[i]];
+    }
+}
+
 
 template <class JacobianBlockType>
 void BaseDeformationMappingT<JacobianBlockType>::draw(const core::visual::VisualParams* vparams)
@@ -692,12 +1382,19 @@ void BaseDeformationMappingT<JacobianBlockType>::draw(const core::visual::Visual
     helper::ReadAccessor<Data<InVecCoord> > in (*this->fromModel->read(core::ConstVecCoordId::position()));
     helper::ReadAccessor<Data<OutVecCoord> > out (*this->toModel->read(core::ConstVecCoordId::position()));
     helper::ReadAccessor<Data<VecVRef > > ref (this->f_index);
-    helper::ReadAccessor<Data<VecVReal > > w (this->f_w);
+    helper::ReadAccessor<Data<VecVReal > > w (this->f_w); // empty when the weights are released
 
     if(this->missingInformationDirty)
     {
-        if(!OutDataTypesInfo<Out>::positionMapped) mapPositions();
-        if(!OutDataTypesInfo<Out>::FMapped) if(showDeformationGradientScale.getValue() || showColorOnTopology.getValue().getSelectedId()!=0) mapDeformationGradients();
+        // released weights are only recomputed for the displays which need the positions or the deformation gradients of the children
+        const bool needPositions = !OutDataTypesInfo<Out>::positionMapped && (vparams->displayFlags().getShowMechanicalMappings() || showDeformationGradientScale.getValue());
+        const bool needF = !OutDataTypesInfo<Out>::FMapped && (showDeformationGradientScale.getValue() || showColorOnTopology.getValue().getSelectedId()!=0);
+        if( needPositions || needF )
+        {
+            WeightsScope scope(this); // computes the released weights once for both
+            if(needPositions) mapPositions();
+            if(needF) mapDeformationGradients();
+        }
         this->missingInformationDirty=false;
     }
 
@@ -711,10 +1408,11 @@ void BaseDeformationMappingT<JacobianBlockType>::draw(const core::visual::Visual
             if(OutDataTypesInfo<Out>::positionMapped) Out::get(edge[1][0],edge[1][1],edge[1][2],out[i]);
             else edge[1]=f_pos[i];
             for(size_t j=0; j<ref[i].size(); j++ )
-                if(w[i][j])
+                if(i>=w.size() || w[i][j]) // released weights: the parents are drawn without their weights
                 {
                     In::get(edge[0][0],edge[0][1],edge[0][2],in[ref[i][j]]);
-                    sofa::gl::Color::getHSVA(&col[0],240.f*(float)w[i][j],1.f,.8f,1.f);
+                    if(i<w.size()) sofa::gl::Color::getHSVA(&col[0],240.f*(float)w[i][j],1.f,.8f,1.f);
+                    else col = type::RGBAColor(.5f,.5f,.5f,1.f);
                     vparams->drawTool()->drawLines ( edge, 1, col );
                 }
         }
@@ -853,7 +1551,7 @@ void BaseDeformationMappingT<JacobianBlockType>::draw(const core::visual::Visual
 template <class JacobianBlockType>
 const defaulttype::BaseMatrix* BaseDeformationMappingT<JacobianBlockType>::getJ(const core::MechanicalParams * /*mparams*/)
 {
-    if(!this->assemble.getValue() || !BlockType::constant || !eigenJacobian.rows()) updateJ();
+    if(!this->assemble.getValue() || !BlockType::constant || eigenJacobianDirty) updateJ();
 
     return &eigenJacobian;
 }
@@ -862,14 +1560,14 @@ const defaulttype::BaseMatrix* BaseDeformationMappingT<JacobianBlockType>::getJ(
 template <class JacobianBlockType>
 const type::vector<sofa::defaulttype::BaseMatrix*>* BaseDeformationMappingT<JacobianBlockType>::getJs()
 {
-    if(!this->assemble.getValue() || !BlockType::constant || !eigenJacobian.rows()) updateJ();
+    if(!this->assemble.getValue() || !BlockType::constant || eigenJacobianDirty) updateJ();
     return &baseMatrices;
 }
 
 template <class JacobianBlockType>
 const defaulttype::BaseMatrix* BaseDeformationMappingT<JacobianBlockType>::getK()
 {
-    if( BlockType::constant || !K.compressedMatrix.nonZeros() ) return NULL;
+    if( BlockType::constant || KDirty ) return NULL;
     else return &K;
 }
 
@@ -143,6 +143,8 @@ public:
     typedef type::vector<MaterialToSpatial> VMaterialToSpatial;
     typedef helper::kdTree<Coord> KDT;      ///< kdTree for fast search of closest mapped points
     typedef typename KDT::distanceSet distanceSet;
+    typedef defaulttype::PointBVH<Coord> PointTree; ///< refit-able hierarchy for fast search of closest mapped points
+    typedef std::pair<unsigned int,unsigned int> ChildSlot; ///< (child index i, position j of the parent in row i of the jacobian) for a given parent
     //@}
 
     /** @name  Jacobian types    */
@@ -223,6 +225,7 @@ public:
     //@{
     virtual void ForwardMapping(Coord& p,const Coord& p0) override;
     virtual void BackwardMapping(Coord& p0,const Coord& p,const Real Thresh=1e-5, const size_t NbMaxIt=10) override;
+    using BasePointMapper<JacobianBlockType1::Out::spatial_dimensions,typename JacobianBlockType1::In::Real>::BackwardMapping;
     virtual unsigned int getClosestMappedPoint(const Coord& p, Coord& x0,Coord& x, bool useKdTree=false) override;
 
     virtual void mapPosition(Coord& p,const Coord &p0, const VRef& ref, const VReal& w)=0;
@@ -255,7 +258,7 @@ protected:
         this->f_pos.resize(this->f_pos0.getValue().size());
         for(size_t i=0; i<this->f_pos.size(); i++ ) mapPosition(f_pos[i],this->f_pos0.getValue()[i],this->f_index.getValue()[i],this->f_w.getValue()[i]);
     }
-    KDT f_KdTree;
+    PointTree f_pointTree;      ///< hierarchy of f_pos (for closest point search)
 
     VMaterialToSpatial f_F;     ///< current value of deformation gradients (for visualisation)
     void mapDeformationGradients() ///< map initial deform  gradients stored in f_F0 to f_F      (used for visualization)
@@ -265,12 +268,26 @@ protected:
     }
 
     bool missingInformationDirty;  ///< tells if pos or F need to be updated (to speed up visualization)
-    bool KdTreeDirty;              ///< tells if kdtree need to be updated (to speed up closest point search)
+    bool KdTreeDirty;              ///< tells if the point tree needs to be updated (to speed up closest point search)
 
     SparseMatrix1 jacobian1;   ///< Jacobian of the mapping
     SparseMatrix2 jacobian2;   ///< Jacobian of the mapping
     virtual void initJacobianBlocks()=0;
 
+    /** @name Parent to child indices
+     * Transposes of f_index1 and f_index2 in compressed row storage, sorted by increasing child index
+     * (children of parent p are index_parentToChild[k] for k in [offset[p],offset[p+1]) ).
+     * They are used to gather child contributions per parent, so that applyJT and applyDJT can run in parallel without races.
+     */
+    //@{
+    type::vector<unsigned int> index1_parentToChild_offset;
+    type::vector<ChildSlot> index1_parentToChild;
+    type::vector<unsigned int> index2_parentToChild_offset;
+    type::vector<ChildSlot> index2_parentToChild;
+    void updateIndex(const size_t parentSize1, const size_t parentSize2);
+    static void fillIndex(type::vector<unsigned int>& offset, type::vector<ChildSlot>& slots, const VecVRef& index, const size_t parentSize);
+    //@}
+
     core::State<In1>* fromModel1;   ///< DOF of the master1
     core::State<In2>* fromModel2;   ///< DOF of the master2
     core::State<Out>* toModel;      ///< DOF of the slave
@@ -291,7 +308,7 @@ protected:
     Data< helper::OptionsGroup > showDeformationGradientStyle; ///< Visualization style for deformation gradients
     Data< helper::OptionsGroup > showColorOnTopology; ///< Color mapping method
     Data< float > showColorScale; ///< Color mapping scale
-    Data< unsigned > d_geometricStiffness; ///< 0=no GS, 1=non symmetric, 2=symmetrized
+    Data< unsigned > d_geometricStiffness; ///< 0=no GS, 1=non symmetric, 2=symmetrized. Non zero values add the block diagonal geometric stiffness in applyDJT
     Data< bool > d_parallel;		///< use openmp ?
 };
 
@@ -72,7 +72,7 @@ BaseDeformationMultiMappingT<JacobianBlockType1,JacobianBlockType2>::BaseDeforma
     , showDeformationGradientStyle ( initData ( &showDeformationGradientStyle,"showDeformationGradientStyle","Visualization style for deformation gradients" ) )
     , showColorOnTopology ( initData ( &showColorOnTopology,"showColorOnTopology","Color mapping method" ) )
     , showColorScale(initData(&showColorScale, (float)1.0, "showColorScale", "Color mapping scale"))
-    , d_geometricStiffness(initData(&d_geometricStiffness, 0u, "geometricStiffness", "0=no GS, 1=non symmetric, 2=symmetrized"))
+    , d_geometricStiffness(initData(&d_geometricStiffness, 0u, "geometricStiffness", "0=no GS, 1=non symmetric, 2=symmetrized (the non symmetric one is used). Non zero values add the block diagonal geometric stiffness in applyDJT (previously not implemented)"))
     , d_parallel(initData(&d_parallel, false, "parallel", "use openmp parallelisation?"))
 {
     helper::OptionsGroup methodOptions(3,"0 - None"
@@ -188,6 +188,8 @@ void BaseDeformationMultiMappingT<JacobianBlockType1,JacobianBlockType2>::resize
     // init jacobians
     initJacobianBlocks();
 
+    updateIndex(this->getFromSize1(),this->getFromSize2());
+
     // clear forces
     if(this->toModel->write(core::VecDerivId::force())) { helper::WriteOnlyAccessor<Data< OutVecDeriv > >  f(*this->toModel->write(core::VecDerivId::force())); for(size_t i=0;i<f.size();i++) f[i].clear(); }
     // clear velocities
@@ -242,6 +244,8 @@ void BaseDeformationMultiMappingT<JacobianBlockType1,JacobianBlockType2>::resize
         }
     }
 
+    updateIndex(this->getFromSize1(),this->getFromSize2());
+
     // clear forces
     if(this->toModel->write(core::VecDerivId::force())) { helper::WriteOnlyAccessor<Data< OutVecDeriv > >  f(*this->toModel->write(core::VecDerivId::force())); for(size_t i=0;i<f.size();i++) f[i].clear(); }
     // clear velocities
@@ -283,6 +287,33 @@ void BaseDeformationMultiMappingT<JacobianBlockType1,JacobianBlockType2>::init()
     for (std::size_t i=0; i < indices.size(); ++i)
         if (indices[i].empty())
             serr << "Particle " << i << " has no parent" << sendl;
+
+    if( d_geometricStiffness.getValue()==2 ) msg_warning() << "symmetrized geometric stiffness is not implemented: the non symmetric one is used";
+}
+
+template <class JacobianBlockType1,class JacobianBlockType2>
+void BaseDeformationMultiMappingT<JacobianBlockType1,JacobianBlockType2>::updateIndex(const size_t parentSize1, const size_t parentSize2)
+{
+    fillIndex(index1_parentToChild_offset,index1_parentToChild,this->f_index1.getValue(),parentSize1);
+    fillIndex(index2_parentToChild_offset,index2_parentToChild,this->f_index2.getValue(),parentSize2);
+}
+
+template <class JacobianBlockType1,class JacobianBlockType2>
+void BaseDeformationMultiMappingT<JacobianBlockType1,JacobianBlockType2>::fillIndex(type::vector<unsigned int>& offset, type::vector<ChildSlot>& slots, const VecVRef& index, const size_t parentSize)
+{
+    // count children per parent
+    offset.assign(parentSize+1,0);
+    for(size_t i=0; i<index.size(); i++)
+        for(size_t j=0; j<index[i].size(); j++)
+            if(index[i][j]<parentSize) offset[index[i][j]+1]++;
+    for(size_t p=0; p<parentSize; p++) offset[p+1]+=offset[p];
+
+    // fill by increasing child index
+    slots.resize(offset[parentSize]);
+    type::vector<unsigned int> fill(offset.begin(),offset.end()-1);
+    for(size_t i=0; i<index.size(); i++)
+        for(size_t j=0; j<index[i].size(); j++)
+            if(index[i][j]<parentSize) slots[fill[index[i][j]]++] = ChildSlot((unsigned int)i,(unsigned int)j);
 }
 
 template <class JacobianBlockType1,class JacobianBlockType2>
@@ -409,9 +440,12 @@ void BaseDeformationMultiMappingT<JacobianBlockType1,JacobianBlockType2>::applyJ
         const VecVRef& index1 = this->f_index1.getValue();
         const VecVRef& index2 = this->f_index2.getValue();
 
-        for( size_t i=0 ; i<jacobian1.size() ; ++i)
+        // both parent types in a single traversal of the children
+#ifdef _OPENMP
+#pragma omp parallel for if (this->d_parallel.getValue())
+#endif
+        for(sofa::helper::IndexOpenMP<unsigned int>::type i=0; i<jacobian1.size(); i++)
         {
-
             out[i]=OutDeriv();
             for(size_t j=0; j<jacobian1[i].size(); j++)
             {
@@ -446,21 +480,31 @@ void BaseDeformationMultiMappingT<JacobianBlockType1,JacobianBlockType2>::applyJ
         InVecDeriv2& in2 = *dIn2.beginEdit();
         const OutVecDeriv& out = dOut.getValue();
 
-        const VecVRef& index1 = this->f_index1.getValue();
-        const VecVRef& index2 = this->f_index2.getValue();
+        if( index1_parentToChild_offset.size()!=in1.size()+1 || index2_parentToChild_offset.size()!=in2.size()+1 ) updateIndex(in1.size(),in2.size());
 
-        for( size_t i=0 ; i<jacobian1.size() ; ++i)
+        // gather per parent, the parents of both types being shared among the threads of a single parallel region
+#ifdef _OPENMP
+#pragma omp parallel if (this->d_parallel.getValue())
+#endif
         {
-            for(size_t j=0; j<jacobian1[i].size(); j++)
-            {
-                size_t index=index1[i][j];
-                jacobian1[i][j].addMultTranspose(in1[index],out[i]);
-            }
-            for(size_t j=0; j<jacobian2[i].size(); j++)
-            {
-                size_t index=index2[i][j];
-                jacobian2[i][j].addMultTranspose(in2[index],out[i]);
-            }
+#ifdef _OPENMP
+#pragma omp for nowait
+#endif
+            for(sofa::helper::IndexOpenMP<unsigned int>::type p=0; p<in1.size(); p++)
+                for(size_t k=index1_parentToChild_offset[p]; k<index1_parentToChild_offset[p+1]; k++)
+                {
+                    const ChildSlot& c = index1_parentToChild[k];
+                    jacobian1[c.first][c.second].addMultTranspose(in1[p],out[c.first]);
+                }
+#ifdef _OPENMP
+#pragma omp for nowait
+#endif
+            for(sofa::helper::IndexOpenMP<unsigned int>::type p=0; p<in2.size(); p++)
+                for(size_t k=index2_parentToChild_offset[p]; k<index2_parentToChild_offset[p+1]; k++)
+                {
+                    const ChildSlot& c = index2_parentToChild[k];
+                    jacobian2[c.first][c.second].addMultTranspose(in2[p],out[c.first]);
+                }
         }
 
         dIn1.endEdit();
@@ -469,12 +513,49 @@ void BaseDeformationMultiMappingT<JacobianBlockType1,JacobianBlockType2>::applyJ
 }
 
 template <class JacobianBlockType1,class JacobianBlockType2>
-void BaseDeformationMultiMappingT<JacobianBlockType1,JacobianBlockType2>::applyDJT(const core::MechanicalParams* /*mparams*/, core::MultiVecDerivId /*parentDfId*/, core::ConstMultiVecDerivId )
+void BaseDeformationMultiMappingT<JacobianBlockType1,JacobianBlockType2>::applyDJT(const core::MechanicalParams* mparams, core::MultiVecDerivId parentDfId, core::ConstMultiVecDerivId )
 {
     if( (BlockType1::constant && BlockType2::constant) || !d_geometricStiffness.getValue() ) return;
 
-    serr<<"applyDJT is not implemented\n";
-    return;
+    // block diagonal geometric stiffness (as in BaseDeformationMappingT), gathered per parent
+    helper::WriteAccessor<Data<InVecDeriv1> > parentForce1 (*parentDfId[this->fromModel1].write());
+    helper::WriteAccessor<Data<InVecDeriv2> > parentForce2 (*parentDfId[this->fromModel2].write());
+    helper::ReadAccessor<Data<InVecDeriv1> > parentDisplacement1 (*mparams->readDx(this->fromModel1));
+    helper::ReadAccessor<Data<InVecDeriv2> > parentDisplacement2 (*mparams->readDx(this->fromModel2));
+    helper::ReadAccessor<Data<OutVecDeriv> > childForce (*mparams->readF(this->toModel));
+
+    if( index1_parentToChild_offset.size()!=parentForce1.size()+1 || index2_parentToChild_offset.size()!=parentForce2.size()+1 ) updateIndex(parentForce1.size(),parentForce2.size());
+
+    const SReal kfactor = sofa::core::mechanicalparams::kFactor(mparams);
+#ifdef _OPENMP
+#pragma omp parallel if (this->d_parallel.getValue())
+#endif
+    {
+        if( !BlockType1::constant )
+        {
+#ifdef _OPENMP
+#pragma omp for nowait
+#endif
+            for(sofa::helper::IndexOpenMP<unsigned int>::type p=0; p<parentForce1.size(); p++)
+                for(size_t k=index1_parentToChild_offset[p]; k<index1_parentToChild_offset[p+1]; k++)
+                {
+                    const ChildSlot& c = index1_parentToChild[k];
+                    jacobian1[c.first][c.second].addDForce(parentForce1[p],parentDisplacement1[p],childForce[c.first],kfactor);
+                }
+        }
+        if( !BlockType2::constant )
+        {
+#ifdef _OPENMP
+#pragma omp for nowait
+#endif
+            for(sofa::helper::IndexOpenMP<unsigned int>::type p=0; p<parentForce2.size(); p++)
+                for(size_t k=index2_parentToChild_offset[p]; k<index2_parentToChild_offset[p+1]; k++)
+                {
+                    const ChildSlot& c = index2_parentToChild[k];
+                    jacobian2[c.first][c.second].addDForce(parentForce2[p],parentDisplacement2[p],childForce[c.first],kfactor);
+                }
+        }
+    }
 }
 
 
@@ -518,7 +599,7 @@ void BaseDeformationMultiMappingT<JacobianBlockType1,JacobianBlockType2>::applyJ
             }
             typename InMatrixDeriv2::RowIterator o2 = out2.writeLine(rowIt.index());
 
-            for ( ; colIt != colItEnd; ++colIt)
+            for (colIt = rowIt.begin(); colIt != colItEnd; ++colIt)
             {
                 size_t indexIn = colIt.index();
 
@@ -607,10 +688,10 @@ unsigned int BaseDeformationMultiMappingT<JacobianBlockType1,JacobianBlockType2>
         if(this->KdTreeDirty)
         {
             if(OutDataTypesInfo<Out>::positionMapped) { f_pos.resize(out.size()); for(size_t i=0; i<out.size(); i++ )  Out::get(f_pos[i][0],f_pos[i][1],f_pos[i][2],out[i]);  } // copy to f_pos
-            this->f_KdTree.build(f_pos);
+            this->f_pointTree.update(f_pos); // small motions only need a refit of the boxes
             this->KdTreeDirty=false;
         }
-        index=this->f_KdTree.getClosest(p,f_pos);
+        index=this->f_pointTree.getClosest(p,f_pos);
         x=f_pos[index];
     }
     else
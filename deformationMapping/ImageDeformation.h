@@ -271,12 +271,18 @@ protected:
             outImg.fill(0);
 
             Real tolerance=1e-5;  if(params.size()) tolerance=(Real)params[0];
-            bool usekdtree=1;
             unsigned int nbMaxIt=10;
 
             if(weightByVolumeChange.getValue()) {serr<<"weightByVolumeChange not supported!"<<sendl;}
 
-            if(usekdtree) {Coord p,p0,q; deformationMapping-> getClosestMappedPoint(p, p0, q, usekdtree); } // first, update kd tree to avoid conflict during parallelization
+            // invert all voxel centers at once, in parallel whatever the parallel flag of the mapping (as the other passes of this engine)
+            const size_t nbVoxels = (size_t)outImg.width()*outImg.height()*outImg.depth();
+            type::vector<Coord> p(nbVoxels),p0;
+            for(int z=0; z<outImg.depth(); z++)
+                for(int y=0; y<outImg.height(); y++)
+                    for(int x=0; x<outImg.width(); x++)
+                        p[x+(size_t)outImg.width()*(y+(size_t)outImg.height()*z)]=outT->fromImage(Coord(x,y,z));
+            deformationMapping->BackwardMapping(p0,p,tolerance,nbMaxIt,true);
 
 #ifdef _OPENMP
             #pragma omp parallel for
@@ -285,13 +291,11 @@ protected:
                 for(int y=0; y<outImg.height(); y++)
                     for(int x=0; x<outImg.width(); x++)
                     {
-                        Coord p=outT->fromImage(Coord(x,y,z)),p0,q;
-                        deformationMapping-> getClosestMappedPoint(p, p0, q, usekdtree);
-                        deformationMapping->BackwardMapping(p0,p,tolerance,nbMaxIt);
+                        const Coord& q0=p0[x+(size_t)outImg.width()*(y+(size_t)outImg.height()*z)];
                         Coord pi;
-                        if(p0[0] || p0[1] || p0[2]) // discard non mapped points
+                        if(q0[0] || q0[1] || q0[2]) // discard non mapped points
                         {
-                            pi = inT->toImage(p0);
+                            pi = inT->toImage(q0);
                             if(pi[0]>=0) if(pi[1]>=0) if(pi[2]>=0) if(pi[0]<img.width()) if(pi[1]<img.height()) if(pi[2]<img.depth())
                                                 {
                                                     if(interp==0)        cimg_forC(img,c) outImg(x,y,z,c) = img.atXYZ(sofa::helper::round((double)pi[0]),sofa::helper::round((double)pi[1]),sofa::helper::round((double)pi[2]),c);
@@ -151,6 +151,7 @@ public:
     typedef type::Mat<dim,mdim,Real> MaterialToSpatial;
 
     typedef type::Vec<mdim,Real> mGradient;
+    typedef typename F331(Real)::Coord BlockCoord;  ///< coefficients are stored in the parent precision (children may be single precision)
 
     /**
     Mapping:
@@ -167,7 +168,7 @@ public:
     static const bool constant=true;
 
     mGradient Ft;       ///< =   grad w.M     =  d F/dt
-    OutCoord PFa;      ///< =   q0.grad w.M + w.A0^{-1}.M   =  dF/dA
+    BlockCoord PFa;      ///< =   q0.grad w.M + w.A0^{-1}.M   =  dF/dA
 
     void init( const LinearJacobianBlock<In,Out>& block) // copy
     {
@@ -185,21 +186,22 @@ public:
 
     void addapply( OutCoord& result, const InCoord& data )
     {
-        result.getF() +=  covMN(data.getCenter(),Ft) + data.getAffine()*PFa.getF();
+        addCast( result.getF() , covMN(data.getCenter(),Ft) + data.getAffine()*PFa.getF() );
     }
 
     void addmult( OutDeriv& result,const InDeriv& data )
     {
-        result.getF() += covMN(data.getVCenter(),Ft) + data.getVAffine()*PFa.getF();
+        addCast( result.getF() , covMN(data.getVCenter(),Ft) + data.getVAffine()*PFa.getF() );
     }
 
     void addMultTranspose( InDeriv& result, const OutDeriv& data )
     {
-        result.getVCenter() += data.getF() * Ft ;
+        const MaterialToSpatial F = castMat<Real>(data.getF());
+        result.getVCenter() += F * Ft ;
 
         for (unsigned int j = 0; j < dim; ++j)
         {
-            result.getVAffine()[j] += PFa.getF() * (data.getF()[j]);
+            result.getVAffine()[j] += PFa.getF() * F[j];
         }
     }
 
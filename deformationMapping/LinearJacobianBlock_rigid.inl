@@ -180,6 +180,7 @@ class LinearJacobianBlock< Rigid3(InReal) , F331(OutReal) > :
     typedef type::Mat<dim,mdim,Real> MaterialToSpatial;
 
     typedef type::Vec<mdim,Real> mGradient;
+    typedef typename F331(Real)::Coord BlockCoord;  ///< coefficients are stored in the parent precision (children may be single precision)
 
     typedef type::Mat<dim,adim,Real> cpMatrix; // cross product matrix of angular part
     typedef type::Mat<dim,dim,Real> rotMat;
@@ -201,8 +202,8 @@ class LinearJacobianBlock< Rigid3(InReal) , F331(OutReal) > :
     static const bool constant=false;
 
     mGradient Ft;       ///< =   grad w.M     =  d F/dt
-    OutCoord PFa0;      ///< =   q0.grad w.M + w.A0^{-1}.M
-    OutCoord PFa;      ///< =    A.PFa0
+    BlockCoord PFa0;      ///< =   q0.grad w.M + w.A0^{-1}.M
+    BlockCoord PFa;      ///< =    A.PFa0
 
     void init( const InCoord& InPos, const OutCoord& /*OutPos*/, const SpatialCoord& SPos, const MaterialToSpatial& F0, const Real& w, const Gradient& dw, const Hessian& /*ddw*/)
     {
@@ -220,20 +221,21 @@ class LinearJacobianBlock< Rigid3(InReal) , F331(OutReal) > :
         rotMat A; data.getOrientation().toMatrix(A);
         PFa.getF()= A * PFa0.getF();  // = update of J according to current transform
 
-        result.getF() +=  covMN(data.getCenter(),Ft) + PFa.getF();
+        addCast( result.getF() , covMN(data.getCenter(),Ft) + PFa.getF() );
     }
 
     void addmult( OutDeriv& result,const InDeriv& data )
     {
         const cpMatrix W = type::crossProductMatrix(getAngular(data));
-        result.getF() += covMN(getLinear(data),Ft) + W * PFa.getF();
+        addCast( result.getF() , covMN(getLinear(data),Ft) + W * PFa.getF() );
     }
 
     void addMultTranspose( InDeriv& result, const OutDeriv& data )
     {
-        getLinear(result) += data.getF() * Ft ;
+        const MaterialToSpatial F = castMat<Real>(data.getF());
+        getLinear(result) += F * Ft ;
 
-        for(unsigned int i=0; i<mdim; ++i) getAngular(result) += cross(PFa.getF().col(i),data.getF().col(i));
+        for(unsigned int i=0; i<mdim; ++i) getAngular(result) += cross(PFa.getF().col(i),F.col(i));
 
         //        getAngular(result)[0] += dot(PFa.getF()[1],data.getF()[2]) - dot(PFa.getF()[2],data.getF()[1]);
         //        getAngular(result)[1] += dot(PFa.getF()[2],data.getF()[0]) - dot(PFa.getF()[0],data.getF()[2]);
@@ -258,9 +260,10 @@ class LinearJacobianBlock< Rigid3(InReal) , F331(OutReal) > :
     {
         // will only work for 3d rigids
         KBlock K = KBlock();
+        const MaterialToSpatial F = castMat<Real>(childForce.getF());
         for(unsigned int k=0; k<mdim; ++k)
         {
-            type::Mat<adim,adim,Real> block = type::crossProductMatrix( childForce.getF().col(k) ) * type::crossProductMatrix( PFa.getF().col(k) );
+            type::Mat<adim,adim,Real> block = type::crossProductMatrix( F.col(k) ) * type::crossProductMatrix( PFa.getF().col(k) );
 
             if( stabilization )
             {
@@ -277,7 +280,8 @@ class LinearJacobianBlock< Rigid3(InReal) , F331(OutReal) > :
 
     void addDForce( InDeriv& df, const InDeriv& dx,  const OutDeriv& childForce, const SReal& kfactor )
     {
-        for(unsigned int i=0; i<mdim; ++i) getAngular(df) += In::crosscross( childForce.getF().col(i), PFa.getF().col(i), getAngular(dx) ) * kfactor;
+        const MaterialToSpatial F = castMat<Real>(childForce.getF());
+        for(unsigned int i=0; i<mdim; ++i) getAngular(df) += In::crosscross( F.col(i), PFa.getF().col(i), getAngular(dx) ) * kfactor;
     }
 };
 
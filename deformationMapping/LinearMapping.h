@@ -29,6 +29,8 @@
 #include "LinearJacobianBlock_rigid.inl"
 #include "LinearJacobianBlock_affine.inl"
 #include "LinearJacobianBlock_quadratic.inl"
+#include "LinearSkinningKernel.h"
+#include <sofa/helper/IndexOpenMP.h>
 
 #ifdef __APPLE__
 // a strange behaviour of the mac's linker requires to compile a few stuffs again
@@ -44,6 +46,12 @@ namespace mapping
 {
 
 
+/// Linear mappings from 3d frames to 3d points (linear blend skinning), evaluated with the batched kernels of LinearSkinningKernel.h
+template <class TIn, class TOut> struct LinearSkinningTraits { static const bool affine=false, rigid=false, batched=false; };
+template <class Real> struct LinearSkinningTraits< defaulttype::StdAffineTypes<3,Real>, defaulttype::StdVectorTypes<type::Vec<3,Real>,type::Vec<3,Real>,Real> > { static const bool affine=true, rigid=false, batched=true; };
+template <class Real> struct LinearSkinningTraits< defaulttype::StdRigidTypes<3,Real>, defaulttype::StdVectorTypes<type::Vec<3,Real>,type::Vec<3,Real>,Real> > { static const bool affine=false, rigid=true, batched=true; };
+
+
 ///Generic linear mapping, from a variety of input types to a variety of output types.
 template <class TIn, class TOut>
 class LinearMapping : public BaseDeformationMappingT<defaulttype::LinearJacobianBlock<TIn,TOut> >
@@ -57,14 +65,20 @@ public:
     typedef typename Inherit::InVecCoord InVecCoord;
     typedef typename Inherit::InVecDeriv InVecDeriv;
     typedef typename Inherit::OutVecCoord OutVecCoord;
+    typedef typename Inherit::OutVecDeriv OutVecDeriv;
 
     typedef typename Inherit::MaterialToSpatial MaterialToSpatial;
+    typedef typename Inherit::VMaterialToSpatial VMaterialToSpatial;
     typedef typename Inherit::VRef VRef;
+    typedef typename Inherit::VecVRef VecVRef;
     typedef typename Inherit::VReal VReal;
+    typedef typename Inherit::VecVReal VecVReal;
     typedef typename Inherit::Gradient Gradient;
     typedef typename Inherit::VGradient VGradient;
+    typedef typename Inherit::VecVGradient VecVGradient;
     typedef typename Inherit::Hessian Hessian;
     typedef typename Inherit::VHessian VHessian;
+    typedef typename Inherit::VecVHessian VecVHessian;
 
     typedef defaulttype::StdVectorTypes<type::Vec<Inherit::spatial_dimensions,Real>,type::Vec<Inherit::spatial_dimensions,Real>,Real> VecSpatialDimensionType;
     typedef defaulttype::LinearJacobianBlock<TIn,VecSpatialDimensionType> PointMapperType;
@@ -83,6 +97,78 @@ protected:
 
 
 public :
+    using Inherit::apply;
+    using Inherit::applyJ;
+    using Inherit::applyJT;
+
+    /** @name Batched evaluation
+     * Frames to points mappings bypass the generic per-block loops and use the SIMD kernels (when not assembled, nor incremental, and when all children are active).
+     */
+    //@{
+    virtual void apply(OutVecCoord& out, const InVecCoord& in) override
+    {
+        if constexpr( Skinning::batched )
+        {
+            this->updateActiveChildren();
+            if( this->activeMask.empty() ) { applySkinning(out,in); return; }
+            skinningRotations.clear(); // block by block evaluation
+        }
+        Inherit::apply(out,in);
+    }
+
+    virtual void apply(const core::MechanicalParams* mparams, Data<OutVecCoord>& dOut, const Data<InVecCoord>& dIn) override
+    {
+        if constexpr( Skinning::batched )
+        {
+            this->updateActiveChildren();
+            if( !this->f_printLog.getValue() && !this->d_incremental.getValue() && this->activeMask.empty() )
+            {
+                applySkinning(*dOut.beginWriteOnly(),dIn.getValue());
+                dOut.endEdit();
+                return;
+            }
+            skinningRotations.clear(); // block by block evaluation
+        }
+        Inherit::apply(mparams,dOut,dIn);
+    }
+
+    virtual void applyJ(OutVecDeriv& out, const InVecDeriv& in) override
+    {
+        if constexpr( Skinning::batched )
+            if( !this->assemble.getValue() && skinningReady(in.size()) ) { applyJSkinning(out,in); return; }
+        Inherit::applyJ(out,in);
+    }
+
+    virtual void applyJ(const core::MechanicalParams* mparams, Data<OutVecDeriv>& dOut, const Data<InVecDeriv>& dIn) override
+    {
+        if constexpr( Skinning::batched )
+            if( !this->assemble.getValue() && skinningReady(dIn.getValue().size()) )
+            {
+                applyJSkinning(*dOut.beginWriteOnly(),dIn.getValue());
+                dOut.endEdit();
+                return;
+            }
+        Inherit::applyJ(mparams,dOut,dIn);
+    }
+
+    virtual void applyJT(const core::MechanicalParams* mparams, Data<InVecDeriv>& dIn, const Data<OutVecDeriv>& dOut) override
+    {
+        if constexpr( Skinning::batched )
+            if( !this->assemble.getValue() && skinningReady(dIn.getValue().size()) )
+            {
+                applyJTSkinning(*dIn.beginEdit(),dOut.getValue());
+                dIn.endEdit();
+                return;
+            }
+        Inherit::applyJT(mparams,dIn,dOut);
+    }
+    //@}
+
+    virtual size_t getMemoryUsage() const override
+    {
+        return Inherit::getMemoryUsage() + skinning.memoryUsage() + skinningFrames.capacity()*sizeof(Real) + skinningRotations.capacity()*sizeof(SkinningMatrix);
+    }
+
     virtual void mapPosition(Coord& p,const Coord &p0, const VRef& ref, const VReal& w) override
     {
         helper::ReadAccessor<Data<InVecCoord> > in0 (*this->fromModel->read(core::ConstVecCoordId::restPosition()));
@@ -152,47 +238,202 @@ public :
         helper::ReadAccessor<Data<InVecCoord> > in (*this->fromModel->read(core::ConstVecCoordId::restPosition()));
         helper::ReadAccessor<Data<OutVecCoord> > out (*this->toModel->read(core::ConstVecCoordId::position()));
 
-        std::size_t size=this->f_pos0.getValue().size();
+        initBlocks(in.ref(),out.ref());
+    }
+
+    virtual void initJacobianBlocks(const InVecCoord& inCoord, const OutVecCoord& outCoord) override
+    {
+        if(this->f_printLog.getValue())
+            std::cout<<this->getName()<< "::" << SOFA_CLASS_METHOD <<std::endl;
+
+        initBlocks(inCoord,outCoord);
+    }
 
-        bool dw  = !this->f_dw.getValue().empty();
-        bool ddw = !this->f_ddw.getValue().empty();
-        bool F0  = !this->f_F0.getValue().empty();
+protected:
 
+    /// initialize the jacobian blocks from the parent and child positions, the weights and the rest deformation gradients.
+    /// Storage is set at once from f_index (and reused on reinit), then the children are initialized in parallel.
+    void initBlocks(const InVecCoord& in, const OutVecCoord& out)
+    {
+        const VecVRef& index = this->f_index.getValue();
+        const VecVReal& w = this->f_w.getValue();
+        const VecVGradient& dw = this->f_dw.getValue();
+        const VecVHessian& ddw = this->f_ddw.getValue();
+        const VMaterialToSpatial& F0 = this->f_F0.getValue();
+        const VecCoord& pos0 = this->f_pos0.getValue();
+
+        const std::size_t size=pos0.size();
+        const bool hasdw = !dw.empty(), hasddw = !ddw.empty(), hasF0 = !F0.empty();
         static const MaterialToSpatial FI = identity<MaterialToSpatial>();
-        this->jacobian.resize(size);
-        for( std::size_t i=0; i<size; i++ )
+
+        typename Inherit::SparseMatrix& J = this->jacobian;
+        J.setPattern(index,size);
+
+#ifdef _OPENMP
+#pragma omp parallel for if (this->d_parallel.getValue())
+#endif
+        for(helper::IndexOpenMP<unsigned int>::type i=0; i<(helper::IndexOpenMP<unsigned int>::type)size; i++ )
         {
-            std::size_t nbref=this->f_index.getValue()[i].size();
-            this->jacobian[i].resize(nbref);
-            for( std::size_t j=0; j<nbref; j++ )
+            const MaterialToSpatial& F0i = hasF0 ? F0[i] : FI;
+            for(std::size_t k=J.rowBegin(i), j=0; k<J.rowEnd(i); k++, j++ )
+                J.block(k).init( in[J.index(k)],out[i],pos0[i],F0i,
+                                 w[i][j],
+                                 hasdw  ? dw[i][j]  : Gradient(),
+                                 hasddw ? ddw[i][j] : Hessian()
+                               );
+        }
+
+        if constexpr( Skinning::batched ) updateSkinning(in.size());
+    }
+
+    typedef LinearSkinningTraits<TIn,TOut> Skinning;
+    typedef type::Mat<3,3,Real> SkinningMatrix;
+
+    defaulttype::LinearSkinningData<Real> skinning;   ///< copy of the jacobian blocks for the batched kernels (frames to points only)
+    type::vector<Real> skinningFrames;                ///< 12 reals per parent: (t,M) given to skinning::apply, or the sums returned by skinning::applyTranspose
+    type::vector<SkinningMatrix> skinningRotations;   ///< rigid frames: rotations of the last apply, used by applyJ and applyJT
+
+    /// number of groups of children given to a thread at once
+    enum { SkinningChunk = 64 };
+
+    void updateSkinning(std::size_t nbParents)
+    {
+        if constexpr( Skinning::batched )
+        {
+            const typename Inherit::SparseMatrix& J = this->jacobian;
+            skinning.set(J.getOffsets().data(),J.getIndices().data(),J.size(),nbParents,[&J](std::size_t k, Real& pt, Real* pa)
+            {
+                const BlockType& b = J.block(k);
+                pt = b.Pt;
+                for(unsigned int r=0; r<3; r++)
+                {
+                    if constexpr( Skinning::rigid ) pa[r] = b.Pa0[r]; // local point, rotated through the frames given to the kernels
+                    else pa[r] = b.Pa[r];
+                }
+            });
+            skinningRotations.clear();
+
+            msg_info() << "batched evaluation ("<< defaulttype::simd::getSimdLevelName(defaulttype::simd::getSimdLevel()) <<"): "
+                       << skinning.nbGroups() << " groups, "<< skinning.nbUniformSlots() <<" uniform slots out of "<< skinning.uniform.size();
+        }
+    }
+
+    /// is the batched evaluation of the derivatives possible (the rotations of rigid frames are known only after a batched apply)
+    bool skinningReady(std::size_t nbParents)
+    {
+        if( !this->activeMask.empty() ) return false;
+        if( !skinning.matches(this->jacobian.size(),nbParents) ) updateSkinning(nbParents);
+        return !Skinning::rigid || skinningRotations.size()==nbParents;
+    }
+
+    static void setSkinningFrame(Real* F, const type::Vec<3,Real>& t, const SkinningMatrix& M)
+    {
+        for(unsigned int r=0; r<3; r++)
+        {
+            F[r] = t[r];
+            for(unsigned int c=0; c<3; c++) F[3+3*r+c] = M[r][c];
+        }
+    }
+
+    void runSkinning(Real* out)
+    {
+        const std::size_t nbGroups = skinning.nbGroups(), nbChunks = (nbGroups+SkinningChunk-1)/SkinningChunk;
+#ifdef _OPENMP
+#pragma omp parallel for if (this->d_parallel.getValue())
+#endif
+        for(helper::IndexOpenMP<unsigned int>::type c=0; c<nbChunks; c++)
+            defaulttype::skinning::apply(out,skinningFrames.data(),skinning,c*SkinningChunk,std::min<std::size_t>(nbGroups,(c+1)*SkinningChunk));
+    }
+
+    void applySkinning(OutVecCoord& out, const InVecCoord& in)
+    {
+        if constexpr( Skinning::batched )
+        {
+            if( !skinning.matches(this->jacobian.size(),in.size()) ) updateSkinning(in.size());
+
+            skinningFrames.resize(12*in.size());
+            if constexpr( Skinning::rigid ) skinningRotations.resize(in.size());
+            for(std::size_t p=0; p<in.size(); p++)
             {
-                std::size_t index=this->f_index.getValue()[i][j];
-                this->jacobian[i][j].init( in[index],out[i],this->f_pos0.getValue()[i],
-                                           F0 ? this->f_F0.getValue()[i] : FI,
-                                           this->f_w.getValue()[i][j],
-                                           dw  ? this->f_dw.getValue()[i][j]  : Gradient(),
-                                           ddw ? this->f_ddw.getValue()[i][j] : Hessian()
-                                         );
+                if constexpr( Skinning::rigid )
+                {
+                    in[p].getOrientation().toMatrix(skinningRotations[p]);
+                    setSkinningFrame(&skinningFrames[12*p],in[p].getCenter(),skinningRotations[p]);
+                }
+                else setSkinningFrame(&skinningFrames[12*p],in[p].getCenter(),in[p].getAffine());
             }
+
+            if( skinning.nbChildren() ) runSkinning(out[0].ptr());
+
+            if constexpr( Skinning::rigid )
+            {
+                // rotated points are still needed by the blocks to assemble J and K
+                if( this->isMechanical() )
+                {
+#ifdef _OPENMP
+#pragma omp parallel for if (this->d_parallel.getValue())
+#endif
+                    for(helper::IndexOpenMP<unsigned int>::type i=0; i<this->jacobian.size(); i++)
+                        for(std::size_t k=this->jacobian.rowBegin(i); k<this->jacobian.rowEnd(i); k++)
+                        {
+                            BlockType& b = this->jacobian.block(k);
+                            b.Pa = skinningRotations[this->jacobian.index(k)]*b.Pa0;
+                        }
+                }
+                if( this->assemble.getValue() ) this->eigenJacobianDirty=true; // J needs to be updated later where the dof mask can be activated
+            }
+
+            this->missingInformationDirty=true; this->KdTreeDirty=true; // need to update spatial positions of defo grads if needed for visualization
         }
     }
 
-    virtual void initJacobianBlocks(const InVecCoord& inCoord, const OutVecCoord& outCoord) override
+    void applyJSkinning(OutVecDeriv& out, const InVecDeriv& in)
     {
-        if(this->f_printLog.getValue())
-            std::cout<<this->getName()<< "::" << SOFA_CLASS_METHOD <<std::endl;
+        if constexpr( Skinning::batched )
+        {
+            skinningFrames.resize(12*in.size());
+            for(std::size_t p=0; p<in.size(); p++)
+            {
+                if constexpr( Skinning::rigid ) setSkinningFrame(&skinningFrames[12*p],getLinear(in[p]),type::crossProductMatrix(getAngular(in[p]))*skinningRotations[p]);
+                else setSkinningFrame(&skinningFrames[12*p],in[p].getVCenter(),in[p].getVAffine());
+            }
 
-        unsigned int cSize = this->f_pos0.getValue().size();
-        this->jacobian.resize(cSize);
-        for(unsigned int i=0; i<cSize; i++ )
+            if( skinning.nbChildren() ) runSkinning(out[0].ptr());
+        }
+    }
+
+    void applyJTSkinning(InVecDeriv& in, const OutVecDeriv& out)
+    {
+        if constexpr( Skinning::batched )
         {
-            unsigned int nbref=this->f_index.getValue()[i].size();
-            this->jacobian[i].resize(nbref);
-            for(unsigned int j=0; j<nbref; j++ )
+            if( !skinning.nbChildren() ) return;
+            skinningFrames.resize(12*in.size());
+
+            // sums per parent of Pt.f and f.Pa^T, gathered over its children (no race, see BaseDeformationMappingT::applyJT)
+#ifdef _OPENMP
+#pragma omp parallel for if (this->d_parallel.getValue())
+#endif
+            for(helper::IndexOpenMP<unsigned int>::type p=0; p<in.size(); p++)
             {
-                unsigned int index=this->f_index.getValue()[i][j];
-                this->jacobian[i][j].init( inCoord[index],outCoord[i],this->f_pos0.getValue()[i], this->f_F0.getValue()[i],
-                                           this->f_w.getValue()[i][j], this->f_dw.getValue()[i][j], this->f_ddw.getValue()[i][j] );
+                defaulttype::skinning::applyTranspose(skinningFrames.data(),out[0].ptr(),skinning,p,p+1);
+                const Real* o = &skinningFrames[12*p];
+                if constexpr( Skinning::rigid )
+                {
+                    // omega = sum (R.Pa0) x f, computed from the skew part of R.(sum Pa0.f^T)
+                    const SkinningMatrix& R = skinningRotations[p];
+                    SkinningMatrix T;
+                    for(unsigned int r=0; r<3; r++) for(unsigned int c=0; c<3; c++) T[r][c] = R[r][0]*o[3+3*c] + R[r][1]*o[4+3*c] + R[r][2]*o[5+3*c];
+                    getLinear(in[p]) += type::Vec<3,Real>(o[0],o[1],o[2]);
+                    getAngular(in[p]) += type::Vec<3,Real>(T[1][2]-T[2][1],T[2][0]-T[0][2],T[0][1]-T[1][0]);
+                }
+                else
+                {
+                    for(unsigned int r=0; r<3; r++)
+                    {
+                        in[p].getVCenter()[r] += o[r];
+                        for(unsigned int c=0; c<3; c++) in[p].getVAffine()[r][c] += o[3+3*r+c];
+                    }
+                }
             }
         }
     }
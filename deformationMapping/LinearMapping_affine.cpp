@@ -50,6 +50,7 @@ int LinearMappingClass_affine = core::RegisterObject("Map child positions as a l
         .add< LinearMapping< Affine3Types, F311Types > >()
         .add< LinearMapping< Affine3Types, F332Types > >()
         .add< LinearMapping< Affine3Types, Affine3Types > >()
+        .add< LinearMapping< Affine3Types, F331OtherTypes > >()
         ;
 
 template class SOFA_Flexible_API LinearMapping< Affine3Types, Vec3Types >;
@@ -58,6 +59,7 @@ template class SOFA_Flexible_API LinearMapping< Affine3Types, F332Types >;
 template class SOFA_Flexible_API LinearMapping< Affine3Types, F321Types >;
 template class SOFA_Flexible_API LinearMapping< Affine3Types, F311Types >;
 template class SOFA_Flexible_API LinearMapping< Affine3Types, Affine3Types >;
+template class SOFA_Flexible_API LinearMapping< Affine3Types, F331OtherTypes >;
 
 
 } // namespace mapping
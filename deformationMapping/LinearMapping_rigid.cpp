@@ -50,6 +50,7 @@ int LinearMappingClass_rigid = core::RegisterObject("Map child positions as a li
         .add< LinearMapping< Rigid3Types, F311Types > >()
         .add< LinearMapping< Rigid3Types, F332Types > >()
         .add< LinearMapping< Rigid3Types, Affine3Types > >()
+        .add< LinearMapping< Rigid3Types, F331OtherTypes > >()
         ;
 
 template class SOFA_Flexible_API LinearMapping< Rigid3Types, Vec3Types >;
@@ -58,6 +59,7 @@ template class SOFA_Flexible_API LinearMapping< Rigid3Types, F321Types >;
 template class SOFA_Flexible_API LinearMapping< Rigid3Types, F311Types >;
 template class SOFA_Flexible_API LinearMapping< Rigid3Types, F332Types >;
 template class SOFA_Flexible_API LinearMapping< Rigid3Types, Affine3Types >;
+template class SOFA_Flexible_API LinearMapping< Rigid3Types, F331OtherTypes >;
 
 } // namespace mapping
 } // namespace component
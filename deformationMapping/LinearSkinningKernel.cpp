@@ -0,0 +1,302 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include "LinearSkinningKernel.h"
+
+// the vectorized kernels are compiled for their instruction set with function attributes, whatever the compilation flags,
+// and selected at runtime according to the cpu
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define FLEXIBLE_SKINNING_X86
+#include <immintrin.h>
+#endif
+
+namespace sofa
+{
+
+namespace defaulttype
+{
+
+namespace skinning
+{
+
+#ifdef FLEXIBLE_SKINNING_X86
+
+typedef LinearSkinningData<double> Data;
+
+// In the kernels below, the contribution of a slot is computed as (Pt.t + M0.ax) + (M1.ay + M2.az) before being accumulated,
+// so that the dependency chain between two slots is a single addition.
+
+//////////////////////////////////////////////////////////////////////////////////
+////  AVX2: 4 children per register, the two halves of a group are interleaved
+//////////////////////////////////////////////////////////////////////////////////
+
+/// gather of base[index[l]] with an explicit source (the unmasked intrinsic leaves it undefined, which gcc reports as maybe uninitialized)
+__attribute__((target("avx2,fma"),always_inline))
+static inline __m256d gather(const double* base, __m128i index)
+{
+    return _mm256_mask_i32gather_pd(_mm256_setzero_pd(),base,index,_mm256_castsi256_pd(_mm256_set1_epi64x(-1)),8);
+}
+
+__attribute__((target("avx2,fma"),always_inline))
+static inline __m256d contribution(__m256d pt, __m256d ax, __m256d ay, __m256d az, __m256d t, __m256d m0, __m256d m1, __m256d m2)
+{
+    return _mm256_add_pd(_mm256_fmadd_pd(m0,ax,_mm256_mul_pd(pt,t)),_mm256_fmadd_pd(m2,az,_mm256_mul_pd(m1,ay)));
+}
+
+/// accumulate slot s (4 children) in x,y,z
+__attribute__((target("avx2,fma"),always_inline))
+static inline void accumulate(__m256d& x, __m256d& y, __m256d& z, const double* frames, const Data& data, std::size_t s, bool uniform)
+{
+    const __m256d pt=_mm256_load_pd(data.Pt.data()+s), ax=_mm256_load_pd(data.Pax.data()+s), ay=_mm256_load_pd(data.Pay.data()+s), az=_mm256_load_pd(data.Paz.data()+s);
+    __m256d F[12];
+    if( uniform )
+    {
+        const double* f=frames+12*data.parent[s];
+        F[0]=_mm256_broadcast_sd(f+0); F[1]=_mm256_broadcast_sd(f+1); F[2]=_mm256_broadcast_sd(f+2);
+        F[3]=_mm256_broadcast_sd(f+3); F[4]=_mm256_broadcast_sd(f+4); F[5]=_mm256_broadcast_sd(f+5);
+        F[6]=_mm256_broadcast_sd(f+6); F[7]=_mm256_broadcast_sd(f+7); F[8]=_mm256_broadcast_sd(f+8);
+        F[9]=_mm256_broadcast_sd(f+9); F[10]=_mm256_broadcast_sd(f+10); F[11]=_mm256_broadcast_sd(f+11);
+    }
+    else
+    {
+        const __m128i p = _mm_mullo_epi32(_mm_load_si128((const __m128i*)(data.parent.data()+s)),_mm_set1_epi32(12));
+        F[0]=gather(frames+0,p); F[1]=gather(frames+1,p); F[2]=gather(frames+2,p);
+        F[3]=gather(frames+3,p); F[4]=gather(frames+4,p); F[5]=gather(frames+5,p);
+        F[6]=gather(frames+6,p); F[7]=gather(frames+7,p); F[8]=gather(frames+8,p);
+        F[9]=gather(frames+9,p); F[10]=gather(frames+10,p); F[11]=gather(frames+11,p);
+    }
+    x=_mm256_add_pd(x,contribution(pt,ax,ay,az,F[0],F[3],F[4],F[5]));
+    y=_mm256_add_pd(y,contribution(pt,ax,ay,az,F[1],F[6],F[7],F[8]));
+    z=_mm256_add_pd(z,contribution(pt,ax,ay,az,F[2],F[9],F[10],F[11]));
+}
+
+__attribute__((target("avx2,fma")))
+static void applyAVX2(double* out, const double* frames, const Data& data, std::size_t gBegin, std::size_t gEnd)
+{
+    enum { W = Data::W };
+    static_assert(W==8, "two AVX2 registers per group");
+    alignas(32) double res[3][W];
+
+    for(std::size_t g=gBegin; g<gEnd; g++)
+    {
+        const std::size_t b=data.groupOffsets[g], n=(data.groupOffsets[g+1]-b)/W;
+        __m256d x0=_mm256_setzero_pd(), y0=_mm256_setzero_pd(), z0=_mm256_setzero_pd();
+        __m256d x1=_mm256_setzero_pd(), y1=_mm256_setzero_pd(), z1=_mm256_setzero_pd();
+        for(std::size_t j=0; j<n; j++)
+        {
+            const std::size_t s=b+j*W;
+            const bool uniform = data.uniform[s/W];
+            accumulate(x0,y0,z0,frames,data,s,uniform);
+            accumulate(x1,y1,z1,frames,data,s+4,uniform);
+        }
+        _mm256_store_pd(res[0],x0); _mm256_store_pd(res[1],y0); _mm256_store_pd(res[2],z0);
+        _mm256_store_pd(res[0]+4,x1); _mm256_store_pd(res[1]+4,y1); _mm256_store_pd(res[2]+4,z1);
+        for(std::size_t l=0; l<W && g*W+l<data.nbChildren(); l++)
+        {
+            double* o=out+3*(g*W+l);
+            o[0]=res[0][l]; o[1]=res[1][l]; o[2]=res[2][l];
+        }
+    }
+}
+
+__attribute__((target("avx2,fma"),always_inline))
+static inline double hsum(__m256d v)
+{
+    __m128d s = _mm_add_pd(_mm256_castpd256_pd128(v),_mm256_extractf128_pd(v,1));
+    return _mm_cvtsd_f64(_mm_add_sd(s,_mm_unpackhi_pd(s,s)));
+}
+
+__attribute__((target("avx2,fma")))
+static void applyTransposeAVX2(double* out, const double* f, const Data& data, std::size_t pBegin, std::size_t pEnd)
+{
+    const __m128i three = _mm_set1_epi32(3);
+
+    for(std::size_t p=pBegin; p<pEnd; p++)
+    {
+        __m256d acc[12];
+        for(unsigned int c=0; c<12; c++) acc[c]=_mm256_setzero_pd();
+
+        const std::size_t b=data.tOffsets[p], e=data.tOffsets[p+1];
+        std::size_t k=b;
+        for( ; k+4<=e; k+=4)
+        {
+            const __m128i i = _mm_mullo_epi32(_mm_loadu_si128((const __m128i*)(data.tChild.data()+k)),three);
+            const __m256d fi[3] = { gather(f+0,i), gather(f+1,i), gather(f+2,i) };
+            const __m256d pt=_mm256_loadu_pd(data.tPt.data()+k);
+            const __m256d a[3] = { _mm256_loadu_pd(data.tPax.data()+k), _mm256_loadu_pd(data.tPay.data()+k), _mm256_loadu_pd(data.tPaz.data()+k) };
+            for(unsigned int r=0; r<3; r++)
+            {
+                acc[r]=_mm256_fmadd_pd(pt,fi[r],acc[r]);
+                for(unsigned int c=0; c<3; c++) acc[3+3*r+c]=_mm256_fmadd_pd(fi[r],a[c],acc[3+3*r+c]);
+            }
+        }
+
+        double* o=out+12*p;
+        for(unsigned int c=0; c<12; c++) o[c]=hsum(acc[c]);
+        if(k<e) applyTransposeScalar(out,f,data,p,p+1,k-b);
+    }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////////
+////  AVX-512: one group (8 children) per register
+//////////////////////////////////////////////////////////////////////////////////
+
+__attribute__((target("avx512f"),always_inline))
+static inline __m512d gather(const double* base, __m256i index)
+{
+    return _mm512_mask_i32gather_pd(_mm512_setzero_pd(),0xFF,index,base,8);
+}
+
+/// horizontal sum (_mm512_reduce_add_pd extracts through an undefined register as well)
+__attribute__((target("avx512f"),always_inline))
+static inline double hsum(__m512d v)
+{
+    alignas(64) double t[8];
+    _mm512_store_pd(t,v);
+    return ((t[0]+t[1])+(t[2]+t[3]))+((t[4]+t[5])+(t[6]+t[7]));
+}
+
+__attribute__((target("avx512f"),always_inline))
+static inline __m512d contribution(__m512d pt, __m512d ax, __m512d ay, __m512d az, __m512d t, __m512d m0, __m512d m1, __m512d m2)
+{
+    return _mm512_add_pd(_mm512_fmadd_pd(m0,ax,_mm512_mul_pd(pt,t)),_mm512_fmadd_pd(m2,az,_mm512_mul_pd(m1,ay)));
+}
+
+__attribute__((target("avx512f")))
+static void applyAVX512(double* out, const double* frames, const Data& data, std::size_t gBegin, std::size_t gEnd)
+{
+    enum { W = Data::W };
+    static_assert(W==8, "one AVX-512 register per group");
+    const __m256i twelve = _mm256_set1_epi32(12);
+    alignas(64) double res[3][W];
+
+    for(std::size_t g=gBegin; g<gEnd; g++)
+    {
+        const std::size_t b=data.groupOffsets[g], n=(data.groupOffsets[g+1]-b)/W;
+        __m512d x=_mm512_setzero_pd(), y=_mm512_setzero_pd(), z=_mm512_setzero_pd();
+        for(std::size_t j=0; j<n; j++)
+        {
+            const std::size_t s=b+j*W;
+            const __m512d pt=_mm512_load_pd(data.Pt.data()+s), ax=_mm512_load_pd(data.Pax.data()+s), ay=_mm512_load_pd(data.Pay.data()+s), az=_mm512_load_pd(data.Paz.data()+s);
+            __m512d F[12];
+            if( data.uniform[s/W] )
+            {
+                const double* f=frames+12*data.parent[s];
+                F[0]=_mm512_set1_pd(f[0]); F[1]=_mm512_set1_pd(f[1]); F[2]=_mm512_set1_pd(f[2]);
+                F[3]=_mm512_set1_pd(f[3]); F[4]=_mm512_set1_pd(f[4]); F[5]=_mm512_set1_pd(f[5]);
+                F[6]=_mm512_set1_pd(f[6]); F[7]=_mm512_set1_pd(f[7]); F[8]=_mm512_set1_pd(f[8]);
+                F[9]=_mm512_set1_pd(f[9]); F[10]=_mm512_set1_pd(f[10]); F[11]=_mm512_set1_pd(f[11]);
+            }
+            else
+            {
+                const __m256i p = _mm256_mullo_epi32(_mm256_load_si256((const __m256i*)(data.parent.data()+s)),twelve);
+                F[0]=gather(frames+0,p); F[1]=gather(frames+1,p); F[2]=gather(frames+2,p);
+                F[3]=gather(frames+3,p); F[4]=gather(frames+4,p); F[5]=gather(frames+5,p);
+                F[6]=gather(frames+6,p); F[7]=gather(frames+7,p); F[8]=gather(frames+8,p);
+                F[9]=gather(frames+9,p); F[10]=gather(frames+10,p); F[11]=gather(frames+11,p);
+            }
+            x=_mm512_add_pd(x,contribution(pt,ax,ay,az,F[0],F[3],F[4],F[5]));
+            y=_mm512_add_pd(y,contribution(pt,ax,ay,az,F[1],F[6],F[7],F[8]));
+            z=_mm512_add_pd(z,contribution(pt,ax,ay,az,F[2],F[9],F[10],F[11]));
+        }
+        _mm512_store_pd(res[0],x); _mm512_store_pd(res[1],y); _mm512_store_pd(res[2],z);
+        for(std::size_t l=0; l<W && g*W+l<data.nbChildren(); l++)
+        {
+            double* o=out+3*(g*W+l);
+            o[0]=res[0][l]; o[1]=res[1][l]; o[2]=res[2][l];
+        }
+    }
+}
+
+__attribute__((target("avx512f")))
+static void applyTransposeAVX512(double* out, const double* f, const Data& data, std::size_t pBegin, std::size_t pEnd)
+{
+    const __m256i three = _mm256_set1_epi32(3);
+
+    for(std::size_t p=pBegin; p<pEnd; p++)
+    {
+        __m512d acc[12];
+        for(unsigned int c=0; c<12; c++) acc[c]=_mm512_setzero_pd();
+
+        const std::size_t b=data.tOffsets[p], e=data.tOffsets[p+1];
+        std::size_t k=b;
+        for( ; k+8<=e; k+=8)
+        {
+            const __m256i i = _mm256_mullo_epi32(_mm256_loadu_si256((const __m256i*)(data.tChild.data()+k)),three);
+            const __m512d fi[3] = { gather(f+0,i), gather(f+1,i), gather(f+2,i) };
+            const __m512d pt=_mm512_loadu_pd(data.tPt.data()+k);
+            const __m512d a[3] = { _mm512_loadu_pd(data.tPax.data()+k), _mm512_loadu_pd(data.tPay.data()+k), _mm512_loadu_pd(data.tPaz.data()+k) };
+            for(unsigned int r=0; r<3; r++)
+            {
+                acc[r]=_mm512_fmadd_pd(pt,fi[r],acc[r]);
+                for(unsigned int c=0; c<3; c++) acc[3+3*r+c]=_mm512_fmadd_pd(fi[r],a[c],acc[3+3*r+c]);
+            }
+        }
+
+        double* o=out+12*p;
+        for(unsigned int c=0; c<12; c++) o[c]=hsum(acc[c]);
+        if(k<e) applyTransposeScalar(out,f,data,p,p+1,k-b);
+    }
+}
+
+#endif // FLEXIBLE_SKINNING_X86
+
+
+
+void apply(double* out, const double* frames, const LinearSkinningData<double>& data, std::size_t gBegin, std::size_t gEnd)
+{
+    switch(simd::getSimdLevel())
+    {
+#ifdef FLEXIBLE_SKINNING_X86
+    case simd::SIMD_AVX512: applyAVX512(out,frames,data,gBegin,gEnd); break;
+    case simd::SIMD_AVX2: applyAVX2(out,frames,data,gBegin,gEnd); break;
+#endif
+    default: applyScalar(out,frames,data,gBegin,gEnd);
+    }
+}
+
+void apply(float* out, const float* frames, const LinearSkinningData<float>& data, std::size_t gBegin, std::size_t gEnd)
+{
+    applyScalar(out,frames,data,gBegin,gEnd);
+}
+
+void applyTranspose(double* out, const double* f, const LinearSkinningData<double>& data, std::size_t pBegin, std::size_t pEnd)
+{
+    switch(simd::getSimdLevel())
+    {
+#ifdef FLEXIBLE_SKINNING_X86
+    case simd::SIMD_AVX512: applyTransposeAVX512(out,f,data,pBegin,pEnd); break;
+    case simd::SIMD_AVX2: applyTransposeAVX2(out,f,data,pBegin,pEnd); break;
+#endif
+    default: applyTransposeScalar(out,f,data,pBegin,pEnd);
+    }
+}
+
+void applyTranspose(float* out, const float* f, const LinearSkinningData<float>& data, std::size_t pBegin, std::size_t pEnd)
+{
+    applyTransposeScalar(out,f,data,pBegin,pEnd);
+}
+
+} // namespace skinning
+
+} // namespace defaulttype
+} // namespace sofa
@@ -0,0 +1,239 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#ifndef FLEXIBLE_LinearSkinningKernel_H
+#define FLEXIBLE_LinearSkinningKernel_H
+
+#include <Flexible/config.h>
+#include "../BlockCSRMatrix.h"
+#include "../SimdLevel.h"
+#include <algorithm>
+
+namespace sofa
+{
+
+namespace defaulttype
+{
+
+
+/** Structure of arrays copy of the jacobian blocks of a linear skinning (frame -> Vec3) mapping, for batched evaluation.
+
+  Each block contributes \f$ Pt.t + M.Pa \f$ to its child, where (t,M) is given per parent (frame center and matrix, or their derivatives).
+
+  Children are packed by groups of W, in the sliced ELLPACK format: inside a group, the j-th blocks of the W children are contiguous,
+  so that a SIMD register processes W children at once with aligned loads. Rows shorter than the group width are padded with null blocks.
+  Blocks of a row are sorted by parent index: neighbouring children generally share their parents, in which case a slot of the group
+  (the j-th blocks of its W children) refers to a single parent, flagged as uniform, and is evaluated with broadcasts instead of gathers.
+
+  A transposed copy (blocks sorted by parent, then by increasing child index) is used to gather child contributions per parent.
+*/
+template<class TReal>
+class LinearSkinningData
+{
+public:
+    typedef TReal Real;
+    enum { W = 8 };  ///< number of children per group (one AVX-512 register, or two AVX2 registers, of doubles)
+    typedef std::vector<Real,AlignedAllocator<Real> > VecReal;
+    typedef std::vector<unsigned int,AlignedAllocator<unsigned int> > VecIndex;
+
+    LinearSkinningData() : _nbChildren(0), _nbParents(0) {}
+
+    std::size_t nbChildren() const { return _nbChildren; }
+    std::size_t nbParents() const { return _nbParents; }
+    std::size_t nbGroups() const { return groupOffsets.size()-1; }
+    std::size_t nbUniformSlots() const { std::size_t n=0; for(std::size_t s=0; s<uniform.size(); s++) n+=uniform[s]; return n; }
+    bool matches(std::size_t nbc, std::size_t nbp) const { return nbc==_nbChildren && nbp==_nbParents && !groupOffsets.empty(); }
+    std::size_t memoryUsage() const ///< bytes held by the arrays
+    {
+        return (groupOffsets.capacity()+parent.capacity()+tOffsets.capacity()+tChild.capacity())*sizeof(unsigned int) + uniform.capacity()
+                + (Pt.capacity()+Pax.capacity()+Pay.capacity()+Paz.capacity()+tPt.capacity()+tPax.capacity()+tPay.capacity()+tPaz.capacity())*sizeof(Real);
+    }
+
+    void clear()
+    {
+        _nbChildren=_nbParents=0;
+        groupOffsets.clear(); parent.clear(); uniform.clear(); Pt.clear(); Pax.clear(); Pay.clear(); Paz.clear();
+        tOffsets.clear(); tChild.clear(); tPt.clear(); tPax.clear(); tPay.clear(); tPaz.clear();
+    }
+
+    /// copy the blocks of a compressed row storage pattern (row i owns blocks [offsets[i],offsets[i+1]) with parents indices[k]).
+    /// get(k,pt,pa) returns the weight and the weighted local point of block k.
+    template<class Getter>
+    void set(const unsigned int* offsets, const unsigned int* indices, std::size_t nbc, std::size_t nbp, Getter get)
+    {
+        _nbChildren=nbc; _nbParents=nbp;
+        const std::size_t nbg = (nbc+W-1)/W;
+
+        groupOffsets.resize(nbg+1);
+        groupOffsets[0]=0;
+        for(std::size_t g=0; g<nbg; g++)
+        {
+            unsigned int width=0;
+            for(std::size_t i=g*W; i<(g+1)*W && i<nbc; i++) if(offsets[i+1]-offsets[i]>width) width=offsets[i+1]-offsets[i];
+            groupOffsets[g+1]=groupOffsets[g]+width*W;
+        }
+
+        const std::size_t size=groupOffsets.back();
+        parent.assign(size,0); Pt.assign(size,0); Pax.assign(size,0); Pay.assign(size,0); Paz.assign(size,0);
+
+        tOffsets.assign(nbp+1,0);
+        for(std::size_t k=0; k<offsets[nbc]; k++) tOffsets[indices[k]+1]++;
+        for(std::size_t p=0; p<nbp; p++) tOffsets[p+1]+=tOffsets[p];
+        const std::size_t tsize=tOffsets.back();
+        tChild.resize(tsize); tPt.resize(tsize); tPax.resize(tsize); tPay.resize(tsize); tPaz.resize(tsize);
+        VecIndex fill(tOffsets.begin(),tOffsets.end()-1);
+
+        Real pt, pa[3];
+        std::vector<unsigned int> row;
+        for(std::size_t i=0; i<nbc; i++)
+        {
+            const std::size_t g=i/W, l=i%W, n=(groupOffsets[g+1]-groupOffsets[g])/W;
+            row.resize(offsets[i+1]-offsets[i]);
+            for(std::size_t j=0; j<row.size(); j++) row[j]=offsets[i]+(unsigned int)j;
+            std::sort(row.begin(),row.end(),[indices](unsigned int a,unsigned int b){ return indices[a]<indices[b]; });
+            for(std::size_t j=0; j<n; j++)
+            {
+                const std::size_t s=groupOffsets[g]+j*W+l;
+                if(j<row.size())
+                {
+                    const std::size_t k=row[j];
+                    get(k,pt,pa);
+                    parent[s]=indices[k]; Pt[s]=pt; Pax[s]=pa[0]; Pay[s]=pa[1]; Paz[s]=pa[2];
+
+                    const unsigned int t=fill[indices[k]]++;
+                    tChild[t]=(unsigned int)i; tPt[t]=pt; tPax[t]=pa[0]; tPay[t]=pa[1]; tPaz[t]=pa[2];
+                }
+                else if(!row.empty()) parent[s]=indices[row.back()]; // null block
+            }
+        }
+
+        // a slot is uniform when all its actual blocks have the same parent: null blocks are then redirected to this parent
+        uniform.assign(size/W,0);
+        for(std::size_t g=0; g<nbg; g++)
+            for(std::size_t j=0, s=groupOffsets[g]; s<groupOffsets[g+1]; j++, s+=W)
+            {
+                std::size_t first=W;
+                bool u=true;
+                for(std::size_t l=0; l<W && u; l++)
+                {
+                    const std::size_t i=g*W+l;
+                    if(i>=nbc || offsets[i]+j>=offsets[i+1]) continue; // null block
+                    if(first==W) first=l;
+                    else if(parent[s+l]!=parent[s+first]) u=false;
+                }
+                if(u && first<W) for(std::size_t l=0; l<W; l++) parent[s+l]=parent[s+first];
+                uniform[s/W]=u;
+            }
+    }
+
+    /** @name sliced ELLPACK storage, children order */
+    //@{
+    VecIndex groupOffsets;  ///< nbGroups()+1 offsets of the groups in the following arrays (multiples of W)
+    VecIndex parent;        ///< parent index of each block
+    VecReal Pt, Pax, Pay, Paz;
+    std::vector<unsigned char> uniform; ///< for each slot (W consecutive blocks), tells if all its blocks have the same parent
+    //@}
+
+    /** @name compressed row storage of the transpose, parents order */
+    //@{
+    VecIndex tOffsets;      ///< nbParents()+1 offsets
+    VecIndex tChild;        ///< child index of each block
+    VecReal tPt, tPax, tPay, tPaz;
+    //@}
+
+protected:
+    std::size_t _nbChildren;
+    std::size_t _nbParents;
+};
+
+
+namespace skinning
+{
+
+/** Children of the groups [gBegin,gEnd): \f$ out_i = \sum_j Pt_{ij}.t_p + M_p.Pa_{ij} \f$
+  @param out 3 reals per child (overwritten)
+  @param frames 12 reals per parent: t, then M in row major order
+*/
+SOFA_Flexible_API void apply(double* out, const double* frames, const LinearSkinningData<double>& data, std::size_t gBegin, std::size_t gEnd);
+SOFA_Flexible_API void apply(float* out, const float* frames, const LinearSkinningData<float>& data, std::size_t gBegin, std::size_t gEnd);
+
+/** Parents [pBegin,pEnd): sums of the child contributions \f$ \sum_i Pt_{ij}.f_i \f$ and \f$ \sum_i f_i.Pa_{ij}^T \f$
+  @param out 12 reals per parent (overwritten): the 3-vector, then the 3x3 matrix in row major order
+  @param f 3 reals per child
+*/
+SOFA_Flexible_API void applyTranspose(double* out, const double* f, const LinearSkinningData<double>& data, std::size_t pBegin, std::size_t pEnd);
+SOFA_Flexible_API void applyTranspose(float* out, const float* f, const LinearSkinningData<float>& data, std::size_t pBegin, std::size_t pEnd);
+
+
+/// portable implementations, also used for the remainders of the vectorized ones
+template<class Real>
+void applyScalar(Real* out, const Real* frames, const LinearSkinningData<Real>& data, std::size_t gBegin, std::size_t gEnd)
+{
+    enum { W = LinearSkinningData<Real>::W };
+    for(std::size_t g=gBegin; g<gEnd; g++)
+    {
+        const std::size_t b=data.groupOffsets[g], n=(data.groupOffsets[g+1]-b)/W;
+        for(std::size_t l=0; l<W && g*W+l<data.nbChildren(); l++)
+        {
+            Real x=0,y=0,z=0;
+            for(std::size_t j=0; j<n; j++)
+            {
+                const std::size_t s=b+j*W+l;
+                const Real* F=frames+12*data.parent[s];
+                const Real pt=data.Pt[s], ax=data.Pax[s], ay=data.Pay[s], az=data.Paz[s];
+                x += pt*F[0] + F[3]*ax + F[4]*ay + F[5]*az;
+                y += pt*F[1] + F[6]*ax + F[7]*ay + F[8]*az;
+                z += pt*F[2] + F[9]*ax + F[10]*ay + F[11]*az;
+            }
+            Real* o=out+3*(g*W+l);
+            o[0]=x; o[1]=y; o[2]=z;
+        }
+    }
+}
+
+template<class Real>
+void applyTransposeScalar(Real* out, const Real* f, const LinearSkinningData<Real>& data, std::size_t pBegin, std::size_t pEnd, std::size_t kBegin=0)
+{
+    for(std::size_t p=pBegin; p<pEnd; p++)
+    {
+        Real* o=out+12*p;
+        if(!kBegin) for(unsigned int c=0; c<12; c++) o[c]=0;
+        for(std::size_t k=data.tOffsets[p]+kBegin; k<data.tOffsets[p+1]; k++)
+        {
+            const Real* fi=f+3*data.tChild[k];
+            const Real pt=data.tPt[k], a[3]={data.tPax[k],data.tPay[k],data.tPaz[k]};
+            for(unsigned int r=0; r<3; r++)
+            {
+                o[r] += pt*fi[r];
+                for(unsigned int c=0; c<3; c++) o[3+3*r+c] += fi[r]*a[c];
+            }
+        }
+    }
+}
+
+} // namespace skinning
+
+} // namespace defaulttype
+} // namespace sofa
+
+
+
+#endif
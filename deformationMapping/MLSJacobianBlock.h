@@ -30,6 +30,8 @@
 #include <sofa/type/MatSym.h>
 #include <sofa/type/Mat.h>
 #include <sofa/type/Vec.h>
+#include <limits>
+#include <cmath>
 
 namespace sofa
 {
@@ -230,6 +232,55 @@ public:
 };
 
 
+/** Inverse of a symmetric positive definite moment matrix, from its \f$ L.D.L^T \f$ factorization.
+  All loops have compile-time lengths, so that they are unrolled and vectorized for each basis size.
+  Returns false (leaving Minv unchanged) when a pivot is not positive, i.e. when M is singular or indefinite.
+*/
+template<Size N,typename Real>
+bool invertLDLT(type::MatSym<N,Real>& Minv, const type::MatSym<N,Real>& M)
+{
+    // M = L.D.L^T, with L unit lower triangular
+    Real L[N][N], D[N], invD[N];
+    for(Size j=0;j<N;j++)
+    {
+        Real d = M(j,j);
+        for(Size k=0;k<j;k++) d -= L[j][k]*L[j][k]*D[k];
+        if( !(d > std::numeric_limits<Real>::epsilon()*std::abs(M(j,j))) ) return false;
+        D[j] = d;
+        invD[j] = (Real)1./d;
+        for(Size i=j+1;i<N;i++)
+        {
+            Real s = M(i,j);
+            for(Size k=0;k<j;k++) s -= L[i][k]*L[j][k]*D[k];
+            L[i][j] = s*invD[j];
+        }
+    }
+
+    // X = L^-1, unit lower triangular
+    Real X[N][N];
+    for(Size i=0;i<N;i++)
+    {
+        for(Size c=0;c<i;c++)
+        {
+            Real s = -L[i][c];
+            for(Size k=c+1;k<i;k++) s -= L[i][k]*X[k][c];
+            X[i][c] = s;
+        }
+        X[i][i] = 1;
+    }
+
+    // M^-1 = X^T.D^-1.X
+    for(Size i=0;i<N;i++)
+        for(Size j=0;j<=i;j++)
+        {
+            Real s = 0;
+            for(Size k=i;k<N;k++) s += X[k][i]*X[k][j]*invD[k];
+            Minv(i,j) = s;
+        }
+    return true;
+}
+
+
 template<class basis>
 const type::Vec<basis::spatial_dimensions-1,typename basis::value_type>& BasisToCoord(const basis& v) { return *reinterpret_cast<const type::Vec<basis::spatial_dimensions-1,typename basis::value_type>*>(&v[1]); }
 
@@ -25,6 +25,7 @@
 #include <Flexible/config.h>
 #include "BaseDeformationMapping.h"
 #include "BaseDeformationImpl.inl"
+#include <sofa/helper/IndexOpenMP.h>
 #include "MLSJacobianBlock_point.inl"
 #include "MLSJacobianBlock_affine.inl"
 #include "MLSJacobianBlock_rigid.inl"
@@ -59,12 +60,17 @@ public:
     typedef typename Inherit::OutVecCoord OutVecCoord;
 
     typedef typename Inherit::MaterialToSpatial MaterialToSpatial;
+    typedef typename Inherit::VMaterialToSpatial VMaterialToSpatial;
     typedef typename Inherit::VRef VRef;
+    typedef typename Inherit::VecVRef VecVRef;
     typedef typename Inherit::VReal VReal;
+    typedef typename Inherit::VecVReal VecVReal;
     typedef typename Inherit::Gradient Gradient;
     typedef typename Inherit::VGradient VGradient;
+    typedef typename Inherit::VecVGradient VecVGradient;
     typedef typename Inherit::Hessian Hessian;
     typedef typename Inherit::VHessian VHessian;
+    typedef typename Inherit::VecVHessian VecVHessian;
 
     typedef defaulttype::MLSJacobianBlock<TIn,defaulttype::Vec3Types> PointMapperType;
     typedef defaulttype::DefGradientTypes<Inherit::spatial_dimensions, Inherit::material_dimensions, 0, Real> FType;
@@ -87,66 +93,107 @@ protected:
     typedef typename mlsinfo::basis basis;
     typedef typename mlsinfo::moment moment;
 
+    typedef type::Vec<spatial_dimensions, moment> MomentGradient;
+    typedef type::Mat<spatial_dimensions,spatial_dimensions, moment> MomentHessian;
+    typedef type::Vec<spatial_dimensions, basis> BasisGradient;
+    typedef type::Mat<spatial_dimensions,spatial_dimensions, basis> BasisHessian;
+
+    /// packed storage of the symmetric moment matrices (upper triangle), used for fixed-size accumulations
+    enum { msize = mlsinfo::bdim*(mlsinfo::bdim+1)/2 };
+    typedef type::Vec<msize,Real> PackedMoment;
+    static PackedMoment& packed(moment& m) { return m; }
+    static const PackedMoment& packed(const moment& m) { return m; }
+
     ///< Compute the moment matrix \f$ M = sum w_i.xi*.xi*^T \f$ and its spatial derivatives (xi is the initial spatial position of node i)
-    void computeMLSMatrices(moment& M, type::Vec<spatial_dimensions, moment>& dM, type::Mat<spatial_dimensions,spatial_dimensions, moment>& ddM,
-                                const VRef& index, const InVecCoord& in, const VReal& w, const VGradient& dw, const VHessian& ddw)
+    /// cov[index[j]] is the precomputed covariance \f$ xi*.xi*^T \f$ of the j-th parent
+    void computeMLSMatrices(moment& M, MomentGradient& dM, MomentHessian& ddM,
+                                const VRef& index, const type::vector<moment>& cov, const VReal& w, const VGradient& dw, const VHessian& ddw)
     {
-        M=moment();
-        for(unsigned int k=0; k<spatial_dimensions; k++ ) dM(k)=moment();
-        for(unsigned int i=0; i<spatial_dimensions; i++ ) for(unsigned int k=0; k<spatial_dimensions; k++ ) ddM(i,k)=moment();
+        PackedMoment& m = packed(M); m.clear();
+        for(unsigned int k=0; k<spatial_dimensions; k++ ) packed(dM[k]).clear();
+        for(unsigned int i=0; i<spatial_dimensions; i++ ) for(unsigned int k=i; k<spatial_dimensions; k++ ) packed(ddM(i,k)).clear();
 
         for(unsigned int j=0; j<index.size(); j++ )
         {
-            moment XXT=mlsinfo::getCov(ininfo::getCenter(in[index[j]]));
-            M += XXT * w[j];
-            if(j<dw.size()) for(unsigned int k=0; k<spatial_dimensions; k++ ) dM(k)+=XXT * dw[j][k];
-            if(j<ddw.size()) for(unsigned int i=0; i<spatial_dimensions; i++ ) for(unsigned int k=0; k<spatial_dimensions; k++ ) ddM(i,k)+=XXT * ddw[j](i,k);
+            const PackedMoment& XXT = packed(cov[index[j]]);
+            const Real wj = w[j];
+            for(unsigned int e=0; e<msize; e++ ) m[e] += XXT[e]*wj;
+            if(j<dw.size()) for(unsigned int k=0; k<spatial_dimensions; k++ )
+            {
+                PackedMoment& dm = packed(dM[k]); const Real dwj = dw[j][k];
+                for(unsigned int e=0; e<msize; e++ ) dm[e] += XXT[e]*dwj;
+            }
+            if(j<ddw.size()) for(unsigned int i=0; i<spatial_dimensions; i++ ) for(unsigned int k=i; k<spatial_dimensions; k++ )
+            {
+                PackedMoment& ddm = packed(ddM(i,k)); const Real ddwj = ddw[j](i,k);
+                for(unsigned int e=0; e<msize; e++ ) ddm[e] += XXT[e]*ddwj;
+            }
         }
+        for(unsigned int i=0; i<spatial_dimensions; i++ ) for(unsigned int k=i+1; k<spatial_dimensions; k++ ) ddM(k,i)=ddM(i,k);
+    }
+
+    ///< Same as above, computing the covariances of the parents on the fly
+    void computeMLSMatrices(moment& M, MomentGradient& dM, MomentHessian& ddM,
+                                const VRef& index, const InVecCoord& in, const VReal& w, const VGradient& dw, const VHessian& ddw)
+    {
+        type::vector<moment> cov(index.size());
+        VRef localIndex(index.size());
+        for(unsigned int j=0; j<index.size(); j++ ) { cov[j]=mlsinfo::getCov(ininfo::getCenter(in[index[j]])); localIndex[j]=j; }
+        computeMLSMatrices(M,dM,ddM,localIndex,cov,w,dw,ddw);
     }
 
     void invertMomentMatrix(moment& Minv,const moment& M)
     {
-        // Minv.invert(M);
+        // the moment matrix is symmetric positive definite for well-posed fits: fixed-size LDL^T inversion
+        if( defaulttype::invertLDLT(Minv,M) ) return;
+
+        // degenerate configurations: fall back to the general inverse
         static const unsigned int bdim=mlsinfo::bdim;
         Eigen::Matrix<Real,bdim,bdim>  eM;
         for(unsigned int k=0; k<bdim; k++ ) for(unsigned int l=0; l<bdim; l++ ) eM(k,l)=M(k,l);
         Eigen::Matrix<Real,bdim,bdim>  eMinv = eM.inverse();
-        for(unsigned int k=0; k<bdim; k++ ) for(unsigned int l=0; l<bdim; l++ ) Minv(k,l)=eMinv(k,l);
+        for(unsigned int k=0; k<bdim; k++ ) for(unsigned int l=0; l<=k; l++ ) Minv(k,l)=eMinv(k,l);
     }
 
 
-    ///< Compute the mls coordinates \f$ C = w.x*.x*^T M^{-1} p* \f$ and its spatial derivatives (p is the initial spatial position of a material point and x the initial spatial position of a node)
-    void computeMLSCoordinates(basis& P, type::Vec<spatial_dimensions, basis>& dP, type::Mat<spatial_dimensions,spatial_dimensions, basis>& ddP,
-                               const moment& Minv, const type::Vec<spatial_dimensions, moment>& dM, const type::Mat<spatial_dimensions,spatial_dimensions, moment>& ddM,
-                               const Coord& p0, const InCoord& in, const Real& w, const Gradient& dw, const Hessian& ddw)
+    ///< Compute the terms of the mls coordinates that only depend on the material point p:
+    /// \f$ A = M^{-1} p0* \f$ and its spatial derivatives \f$ B(i) = dA/di \f$, \f$ C(i,j) = d^2A/didj \f$
+    void computeMLSChildTerms(basis& A, BasisGradient& B, BasisHessian& C,
+                              const moment& Minv, const MomentGradient& dM, const MomentHessian& ddM, const Coord& p0)
     {
-        moment XXT=mlsinfo::getCov(ininfo::getCenter(in));
-
-        basis P0 = mlsinfo::getBasis(defaulttype::InInfo<Coord>::getCenter(p0));
-        type::Vec<spatial_dimensions, basis> dP0; for(unsigned int k=0; k<spatial_dimensions; k++ ) dP0[k]=mlsinfo::getBasisGradient(defaulttype::InInfo<Coord>::getCenter(p0),k);
-        type::Mat<spatial_dimensions,spatial_dimensions, basis> ddP0; for(unsigned int j=0; j<spatial_dimensions; j++ ) for(unsigned int k=0; k<spatial_dimensions; k++ ) ddP0(j,k)=mlsinfo::getBasisHessian(defaulttype::InInfo<Coord>::getCenter(p0),j,k);
+        const typename mlsinfo::coord x0 = defaulttype::InInfo<Coord>::getCenter(p0);
 
-        // P = w.x*.x*^T M^{-1} p0*
-        P = XXT*(Minv * P0) * w;
+        A = Minv * mlsinfo::getBasis(x0);
 
-        // dP(i) = x*.x*^T M^{-1} [p0*.dw(i) + w.dp0*(i) - w.dM(i) M^{-1} p0* ]
+        // B(i) = M^{-1} [ dp0*(i) - dM(i) A ]
         for(unsigned int i=0; i<spatial_dimensions; i++ )
+            B[i] = Minv * ( mlsinfo::getBasisGradient(x0,i) - dM[i]*A );
+
+        // C(i,j) = M^{-1} [ ddp0*(i,j) - ddM(i,j) A - dM(i) B(j) - dM(j) B(i) ]
+        for(unsigned int i=0; i<spatial_dimensions; i++ ) for(unsigned int j=i; j<spatial_dimensions; j++ )
         {
-            dP[i]= XXT*(Minv * (P0*dw[i] +  (dP0[i] - dM[i]*(Minv*P0))*w ));
+            C(i,j) = Minv * ( mlsinfo::getBasisHessian(x0,i,j) - ddM(i,j)*A - dM[i]*B[j] - dM[j]*B[i] );
+            if(j!=i) C(j,i)=C(i,j);
         }
+    }
+
+    ///< Compute the mls coordinates \f$ C = w.x*.x*^T M^{-1} p* \f$ and its spatial derivatives (p is the initial spatial position of a material point and x the initial spatial position of a node)
+    /// XXT is the covariance \f$ x*.x*^T \f$ of the node, and (A,B,C) the terms returned by computeMLSChildTerms
+    void computeMLSCoordinates(basis& P, BasisGradient& dP, BasisHessian& ddP,
+                               const moment& XXT, const basis& A, const BasisGradient& B, const BasisHessian& C,
+                               const Real& w, const Gradient& dw, const Hessian& ddw)
+    {
+        // P = w.x*.x*^T M^{-1} p0*
+        P = XXT*(A*w);
 
-        // ddP(i,j) = x*.x*^T M^{-1} [  p0*.ddw(i,j) + w.ddp0*(i,j) + w(j).dp0*(i) + dp0*(j).dw(i)
-        //                              - w *dM(i) M^{-1} p0*(j) - w * dM(j) M^{-1} dp0*(i)
-        //                              + w.( dM(j) M^{-1} dM(i) + dM(i) M^{-1} dM(j) ).M^{-1} p0*
-        //                              - dM(j) M^{-1} p0*.dw(i)     - dM(i) M^{-1} p0*.dw(j)
-        //                              - w *ddM(i,j) M^{-1} p0* ]
+        // dP(i) = x*.x*^T [ A.dw(i) + w.B(i) ]
+        for(unsigned int i=0; i<spatial_dimensions; i++ )
+            dP[i] = XXT*(A*dw[i] + B[i]*w);
+
+        // ddP(i,j) = x*.x*^T [ A.ddw(i,j) + w.C(i,j) + B(i).dw(j) + B(j).dw(i) ]
         for(unsigned int i=0; i<spatial_dimensions; i++ ) for(unsigned int j=i; j<spatial_dimensions; j++ )
         {
-            ddP(i,j)= XXT*(Minv * ( P0*ddw(i,j) + ddP0(i,j)*w + dP0[i]*dw[j] + dP0[j]*dw[i]
-                                    -  dM[i]*(Minv*dP0[j])*w -  dM[j]*(Minv*dP0[i])*w
-                                    +  dM[j]*(Minv*(dM[i]*(Minv*P0)))*w +  dM[i]*(Minv*(dM[j]*(Minv*P0)))*w
-                                    - dM[j]*(Minv*P0)*dw[i]   - dM[i]*(Minv*P0)*dw[j]
-                                    - ddM(i,j)*(Minv*P0)*w));
+            ddP(i,j) = XXT*(A*ddw(i,j) + C(i,j)*w + B[i]*dw[j] + B[j]*dw[i]);
             if(j!=i) ddP(j,i)=ddP(i,j);
         }
     }
@@ -159,30 +206,45 @@ protected:
         helper::ReadAccessor<Data<InVecCoord> > in (*this->fromModel->read(core::ConstVecCoordId::restPosition()));
         helper::ReadAccessor<Data<OutVecCoord> > out (*this->toModel->read(core::ConstVecCoordId::position()));
 
-        unsigned int size=this->f_pos0.getValue().size();
-        this->jacobian.resize(size);
-
-        moment M,Minv;
-        type::Vec<spatial_dimensions, moment > dM;
-        type::Mat<spatial_dimensions,spatial_dimensions, moment> ddM;
-
-        basis P;
-        type::Vec<spatial_dimensions, basis> dP;
-        type::Mat<spatial_dimensions,spatial_dimensions, basis> ddP;
+        const VecVRef& index = this->f_index.getValue();
+        const VecVReal& w = this->f_w.getValue();
+        const VecVGradient& dw = this->f_dw.getValue();
+        const VecVHessian& ddw = this->f_ddw.getValue();
+        const VecCoord& pos0 = this->f_pos0.getValue();
+        const VMaterialToSpatial& F0 = this->f_F0.getValue();
+
+        unsigned int size=pos0.size();
+        typename Inherit::SparseMatrix& J = this->jacobian;
+        J.setPattern(index,size);
+
+        // parent covariances, shared by all the children they influence
+        type::vector<moment> cov(in.size());
+#ifdef _OPENMP
+#pragma omp parallel for if (this->d_parallel.getValue())
+#endif
+        for(helper::IndexOpenMP<unsigned int>::type p=0; p<(helper::IndexOpenMP<unsigned int>::type)in.size(); p++ )
+            cov[p]=mlsinfo::getCov(ininfo::getCenter(in[p]));
 
-        for(unsigned int i=0; i<size; i++ )
+#ifdef _OPENMP
+#pragma omp parallel for if (this->d_parallel.getValue())
+#endif
+        for(helper::IndexOpenMP<unsigned int>::type i=0; i<(helper::IndexOpenMP<unsigned int>::type)size; i++ )
         {
-            unsigned int nbref=this->f_index.getValue()[i].size();
-            this->jacobian[i].resize(nbref);
+            moment M,Minv;
+            MomentGradient dM;
+            MomentHessian ddM;
+            basis A; BasisGradient B; BasisHessian C;
+            basis P; BasisGradient dP; BasisHessian ddP;
 
-            computeMLSMatrices(M,dM,ddM,this->f_index.getValue()[i],in.ref(),this->f_w.getValue()[i],this->f_dw.getValue()[i],this->f_ddw.getValue()[i]);
+            computeMLSMatrices(M,dM,ddM,index[i],cov,w[i],dw[i],ddw[i]);
             invertMomentMatrix(Minv,M);
+            computeMLSChildTerms(A,B,C,Minv,dM,ddM,pos0[i]);
 
-            for(unsigned int j=0; j<nbref; j++ )
+            for(std::size_t k=J.rowBegin(i), j=0; k<J.rowEnd(i); k++, j++ )
             {
-                unsigned int index=this->f_index.getValue()[i][j];
-                computeMLSCoordinates(P,dP,ddP,Minv,dM,ddM,this->f_pos0.getValue()[i],in[index],this->f_w.getValue()[i][j],this->f_dw.getValue()[i][j],this->f_ddw.getValue()[i][j]);
-                this->jacobian[i][j].init(in[index] ,out[i],this->f_pos0.getValue()[i],this->f_F0.getValue()[i],P,dP,ddP);
+                const unsigned int p=J.index(k);
+                computeMLSCoordinates(P,dP,ddP,cov[p],A,B,C,w[i][j],dw[i][j],ddw[i][j]);
+                J.block(k).init(in[p],out[i],pos0[i],F0[i],P,dP,ddP);
             }
         }
     }
@@ -204,20 +266,21 @@ protected:
         VHessian ddw(1);
 
         moment M,Minv;
-        type::Vec<spatial_dimensions, moment > dM;
-        type::Mat<spatial_dimensions,spatial_dimensions, moment> ddM;
-        basis P;
-        type::Vec<spatial_dimensions, basis> dP;
-        type::Mat<spatial_dimensions,spatial_dimensions, basis> ddP;
+        MomentGradient dM;
+        MomentHessian ddM;
+        basis A,P;
+        BasisGradient B,dP;
+        BasisHessian C,ddP;
 
         computeMLSMatrices(M,dM,ddM,ref,in0.ref(),w,dw,ddw);
         invertMomentMatrix(Minv,M);
+        computeMLSChildTerms(A,B,C,Minv,dM,ddM,p0);
 
         p=Coord();
         for(unsigned int j=0; j<ref.size(); j++ )
         {
             unsigned int index=ref[j];
-            computeMLSCoordinates(P,dP,ddP,Minv,dM,ddM,p0,in0[index],w[j],dw[0],ddw[0]);
+            computeMLSCoordinates(P,dP,ddP,mlsinfo::getCov(ininfo::getCenter(in0[index])),A,B,C,w[j],dw[0],ddw[0]);
             mapper.init( in0[index],o,p0,MtoS0,P,dP,ddP);
             mapper.addapply(p,in[index]);
         }
@@ -235,20 +298,21 @@ protected:
         VHessian ddw(1);
 
         moment M,Minv;
-        type::Vec<spatial_dimensions, moment > dM;
-        type::Mat<spatial_dimensions,spatial_dimensions, moment> ddM;
-        basis P;
-        type::Vec<spatial_dimensions, basis> dP;
-        type::Mat<spatial_dimensions,spatial_dimensions, basis> ddP;
+        MomentGradient dM;
+        MomentHessian ddM;
+        basis A,P;
+        BasisGradient B,dP;
+        BasisHessian C,ddP;
 
         computeMLSMatrices(M,dM,ddM,ref,in0.ref(),w,dw,ddw);
         invertMomentMatrix(Minv,M);
+        computeMLSChildTerms(A,B,C,Minv,dM,ddM,p0);
 
         typename DeformationGradientMapperType::OutCoord Fc;
         for(unsigned int j=0; j<ref.size(); j++ )
         {
             unsigned int index=ref[j];
-            computeMLSCoordinates(P,dP,ddP,Minv,dM,ddM,p0,in0[index],w[j],dw[j],ddw[0]);
+            computeMLSCoordinates(P,dP,ddP,mlsinfo::getCov(ininfo::getCenter(in0[index])),A,B,C,w[j],dw[j],ddw[0]);
             mapper.init( in0[index],o,p0,MtoS,P,dP,ddP);
             mapper.addapply(Fc,in[index]);
         }
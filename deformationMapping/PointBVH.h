@@ -0,0 +1,189 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#ifndef FLEXIBLE_PointBVH_H
+#define FLEXIBLE_PointBVH_H
+
+#include <sofa/type/vector.h>
+#include <algorithm>
+#include <limits>
+
+namespace sofa
+{
+
+namespace defaulttype
+{
+
+
+/** Bounding volume hierarchy of a point set, for closest point queries on moving points.
+
+  The hierarchy is built once (median splits along the largest extent, up to LeafSize points per leaf),
+  then only its boxes are refit when the points move: O(n), without any allocation nor reordering.
+  When the boxes have grown too much with respect to the built ones (the hierarchy does not fit the points anymore), it is rebuilt.
+  Queries are const, so that they can run in parallel between two updates.
+*/
+template<class Coord>
+class PointBVH
+{
+public:
+    typedef typename Coord::value_type Real;
+    enum { N = Coord::total_size };
+    enum { LeafSize = 8 };
+    typedef type::vector<Coord> VecCoord;
+
+    PointBVH() : builtSize(0), nbBuilds(0), nbRefits(0) {}
+
+    bool empty() const { return nodes.empty(); }
+    std::size_t size() const { return order.size(); }
+    unsigned int getNbBuilds() const { return nbBuilds; }
+    unsigned int getNbRefits() const { return nbRefits; }
+
+    void clear() { nodes.clear(); order.clear(); builtSize=0; }
+
+    /// build the hierarchy
+    void build(const VecCoord& points)
+    {
+        clear();
+        if( points.empty() ) return;
+        order.resize(points.size());
+        for(std::size_t i=0; i<order.size(); i++) order[i]=(unsigned int)i;
+        nodes.reserve(2*(points.size()/LeafSize+1));
+        split(points,0,(unsigned int)points.size());
+        builtSize = leafSize();
+        nbBuilds++;
+    }
+
+    /// update the hierarchy for new positions of the same points: refit, or rebuild when the leaf boxes grew by more than \p maxGrowth
+    void update(const VecCoord& points, const Real maxGrowth=2)
+    {
+        if( points.size()!=order.size() ) { build(points); return; }
+        refit(points);
+        if( leafSize() > maxGrowth*builtSize ) build(points);
+    }
+
+    /// index of the closest point to \p p (-1 if empty)
+    unsigned int getClosest(const Coord& p, const VecCoord& points) const
+    {
+        unsigned int closest = (unsigned int)-1;
+        if( empty() ) return closest;
+
+        Real dmin = std::numeric_limits<Real>::max();
+        unsigned int stack[64]; // enough for the depth of a median split hierarchy
+        unsigned int top=0;
+        stack[top++]=0;
+        while(top)
+        {
+            const Node& node = nodes[stack[--top]];
+            if( distance2(node,p)>=dmin ) continue;
+            if( !node.left )
+            {
+                for(unsigned int k=node.begin; k<node.end; k++)
+                {
+                    const Real d = (points[order[k]]-p).norm2();
+                    if( d<dmin ) { dmin=d; closest=order[k]; }
+                }
+                continue;
+            }
+            // visit the closest child first
+            const Real dl=distance2(nodes[node.left],p), dr=distance2(nodes[node.right],p);
+            if( dl<dr ) { if(dr<dmin) stack[top++]=node.right; stack[top++]=node.left; }
+            else        { if(dl<dmin) stack[top++]=node.left; stack[top++]=node.right; }
+        }
+        return closest;
+    }
+
+protected:
+    /// children are stored after their parent, leaves have no child (left=0)
+    struct Node
+    {
+        Coord bmin, bmax;
+        unsigned int begin, end;  ///< range in order
+        unsigned int left, right;
+    };
+
+    type::vector<Node> nodes;
+    type::vector<unsigned int> order;  ///< point indices, sorted by leaf
+    Real builtSize;                    ///< leafSize() at build
+    unsigned int nbBuilds, nbRefits;
+
+    unsigned int split(const VecCoord& points, unsigned int begin, unsigned int end)
+    {
+        const unsigned int n = (unsigned int)nodes.size();
+        nodes.push_back(Node());
+        nodes[n].begin=begin; nodes[n].end=end; nodes[n].left=nodes[n].right=0;
+        setBox(nodes[n],points);
+        if( end-begin<=LeafSize ) return n;
+
+        unsigned int axis=0;
+        for(unsigned int d=1; d<N; d++) if( nodes[n].bmax[d]-nodes[n].bmin[d] > nodes[n].bmax[axis]-nodes[n].bmin[axis] ) axis=d;
+        const unsigned int mid = begin+(end-begin)/2;
+        std::nth_element(order.begin()+begin,order.begin()+mid,order.begin()+end,[&points,axis](unsigned int a,unsigned int b){ return points[a][axis]<points[b][axis]; });
+
+        const unsigned int left = split(points,begin,mid);
+        const unsigned int right = split(points,mid,end);
+        nodes[n].left=left; nodes[n].right=right;
+        return n;
+    }
+
+    void refit(const VecCoord& points)
+    {
+        for(std::size_t n=nodes.size(); n-->0; )
+        {
+            Node& node = nodes[n];
+            if( !node.left ) { setBox(node,points); continue; }
+            const Node& l = nodes[node.left], & r = nodes[node.right];
+            for(unsigned int d=0; d<N; d++) { node.bmin[d]=std::min(l.bmin[d],r.bmin[d]); node.bmax[d]=std::max(l.bmax[d],r.bmax[d]); }
+        }
+        nbRefits++;
+    }
+
+    void setBox(Node& node, const VecCoord& points) const
+    {
+        node.bmin = node.bmax = points[order[node.begin]];
+        for(unsigned int k=node.begin+1; k<node.end; k++)
+            for(unsigned int d=0; d<N; d++) { node.bmin[d]=std::min(node.bmin[d],points[order[k]][d]); node.bmax[d]=std::max(node.bmax[d],points[order[k]][d]); }
+    }
+
+    /// sum of the extents of the leaves: a measure of the quality of the hierarchy that does not vanish for flat boxes
+    Real leafSize() const
+    {
+        Real s=0;
+        for(std::size_t n=0; n<nodes.size(); n++) if( !nodes[n].left ) for(unsigned int d=0; d<N; d++) s+=nodes[n].bmax[d]-nodes[n].bmin[d];
+        return s;
+    }
+
+    static Real distance2(const Node& node, const Coord& p)
+    {
+        Real d2=0;
+        for(unsigned int d=0; d<N; d++)
+        {
+            const Real e = p[d]<node.bmin[d] ? node.bmin[d]-p[d] : p[d]>node.bmax[d] ? p[d]-node.bmax[d] : (Real)0;
+            d2+=e*e;
+        }
+        return d2;
+    }
+};
+
+
+} // namespace defaulttype
+} // namespace sofa
+
+#endif
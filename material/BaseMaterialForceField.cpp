@@ -48,6 +48,12 @@ template class SOFA_Flexible_API ForceField< I331Types >;
 
 template class SOFA_Flexible_API ForceField< F331Types >;
 
+template class SOFA_Flexible_API ForceField< E331OtherTypes >;
+template class SOFA_Flexible_API ForceField< E321OtherTypes >;
+template class SOFA_Flexible_API ForceField< E311OtherTypes >;
+template class SOFA_Flexible_API ForceField< E332OtherTypes >;
+template class SOFA_Flexible_API ForceField< I331OtherTypes >;
+
 }
 }
 }
@@ -46,6 +46,10 @@ int HookeForceFieldClass = core::RegisterObject("Hooke's Law for isotropic homog
         .add< HookeForceField< E221Types > >()
         .add< HookeForceField< U331Types > >()
         .add< HookeForceField< U321Types > >()
+        .add< HookeForceField< E331OtherTypes > >()
+        .add< HookeForceField< E321OtherTypes > >()
+        .add< HookeForceField< E311OtherTypes > >()
+        .add< HookeForceField< E332OtherTypes > >()
         ;
 
 template class SOFA_Flexible_API HookeForceField< E331Types >;
@@ -56,6 +60,10 @@ template class SOFA_Flexible_API HookeForceField< E333Types >;
 template class SOFA_Flexible_API HookeForceField< E221Types >;
 template class SOFA_Flexible_API HookeForceField< U331Types >;
 template class SOFA_Flexible_API HookeForceField< U321Types >;
+template class SOFA_Flexible_API HookeForceField< E331OtherTypes >;
+template class SOFA_Flexible_API HookeForceField< E321OtherTypes >;
+template class SOFA_Flexible_API HookeForceField< E311OtherTypes >;
+template class SOFA_Flexible_API HookeForceField< E332OtherTypes >;
 
 // Register in the Factory
 int HookeOrthotropicForceFieldClass = core::RegisterObject("Hooke's Law for Orthotropic homogeneous materials")
@@ -49,6 +49,12 @@ template class SOFA_Flexible_API Mapping< E311Types, E311Types >;
 template class SOFA_Flexible_API Mapping< E332Types, E332Types >;
 template class SOFA_Flexible_API Mapping< E333Types, E333Types >;
 
+template class SOFA_Flexible_API Mapping< F331OtherTypes, E331OtherTypes >;
+template class SOFA_Flexible_API Mapping< F321OtherTypes, E321OtherTypes >;
+template class SOFA_Flexible_API Mapping< F311OtherTypes, E311OtherTypes >;
+template class SOFA_Flexible_API Mapping< F332OtherTypes, E332OtherTypes >;
+template class SOFA_Flexible_API Mapping< F331OtherTypes, I331OtherTypes >;
+
 
 } // namespace core
 
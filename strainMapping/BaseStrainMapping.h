@@ -33,6 +33,7 @@
 #include <SofaEigen2Solver/EigenSparseMatrix.h>
 
 #include <sofa/helper/IndexOpenMP.h>
+#include <algorithm>
 
 
 #include "../types/DeformationGradientTypes.h"
@@ -141,6 +142,8 @@ public:
 
     void reinit() override
     {
+        standaloneJacobianValid = false;
+
         if(this->assemble.getValue()) updateJ();
 
         // clear forces and force apply       
@@ -166,12 +169,7 @@ public:
     {
         if(this->f_printLog.getValue()) std::cout<<this->getName()<<":apply"<<std::endl;
 
-        const InVecCoord&  in = dIn.getValue();
-
-        type::vector< BlockType > jacobianBlock;
-        jacobianBlock.resize(in.size());
-        initJacobianBlock(jacobianBlock);
-        applyBlock(dOut, dIn, jacobianBlock);
+        applyBlock(dOut, dIn, getStandaloneJacobian(dIn.getValue().size()));
     }
 
     virtual void applyJ(Data<OutVecDeriv>& dOut, const Data<InVecDeriv>& dIn)
@@ -180,9 +178,7 @@ public:
 
         const InVecDeriv&  in = dIn.getValue();
 
-        type::vector< BlockType > jacobianBlock;
-        jacobianBlock.resize(in.size());
-        initJacobianBlock(jacobianBlock);
+        SparseMatrix& jacobianBlock = getStandaloneJacobian(in.size());
 
         OutVecDeriv& out = *dOut.beginWriteOnly();
 #ifdef _OPENMP
@@ -266,6 +262,84 @@ public:
 
     }
 
+    /** @name Several right-hand sides
+     * Products with k vectors at once (e.g. for block Krylov solvers or sensitivity analysis): the jacobian is traversed once,
+     * and each block is loaded once for the k products. Same semantics as the single vector versions (applyJ overwrites dOut[v], applyJT accumulates into dIn[v]).
+     */
+    //@{
+    virtual void applyJ(const core::MechanicalParams * /*mparams*/ , const type::vector<Data<OutVecDeriv>*>& dOut, const type::vector<const Data<InVecDeriv>*>& dIn)
+    {
+        enum { NIn = In::deriv_total_size, NOut = Out::deriv_total_size };
+        const size_t nbRhs = std::min(dOut.size(),dIn.size());
+        if( !nbRhs ) return;
+
+        type::vector<OutVecDeriv*> out(nbRhs);
+        type::vector<const InVecDeriv*> in(nbRhs);
+        for(size_t v=0; v<nbRhs; v++) { out[v] = dOut[v]->beginWriteOnly(); in[v] = &dIn[v]->getValue(); }
+
+        if(this->assemble.getValue())
+        {
+            // one sparse x dense product
+            typedef Eigen::Matrix<typename SparseMatrixEigen::CompressedMatrix::Scalar,Eigen::Dynamic,Eigen::Dynamic> DenseMatrix;
+            DenseMatrix X(eigenJacobian.cols(),nbRhs);
+            for(size_t v=0; v<nbRhs; v++) for(size_t i=0; i<in[v]->size(); i++) for(size_t c=0; c<NIn; c++) X(i*NIn+c,v) = (*in[v])[i][c];
+            const DenseMatrix Y = eigenJacobian.compressedMatrix * X;
+            for(size_t v=0; v<nbRhs; v++) for(size_t i=0; i<out[v]->size(); i++) for(size_t a=0; a<NOut; a++) (*out[v])[i][a] = Y(i*NOut+a,v);
+        }
+        else
+        {
+#ifdef _OPENMP
+        #pragma omp parallel for if (this->d_parallel.getValue())
+#endif
+            for(int i=0; i < static_cast<int>(jacobian.size()); i++)
+            {
+                BlockType& b = jacobian[i];
+                for(size_t v=0; v<nbRhs; v++)
+                {
+                    (*out[v])[i]=OutDeriv();
+                    b.addmult((*out[v])[i],(*in[v])[i]);
+                }
+            }
+        }
+
+        for(size_t v=0; v<nbRhs; v++) dOut[v]->endEdit();
+    }
+
+    virtual void applyJT(const core::MechanicalParams * /*mparams*/ , const type::vector<Data<InVecDeriv>*>& dIn, const type::vector<const Data<OutVecDeriv>*>& dOut)
+    {
+        enum { NIn = In::deriv_total_size, NOut = Out::deriv_total_size };
+        const size_t nbRhs = std::min(dOut.size(),dIn.size());
+        if( !nbRhs ) return;
+
+        type::vector<InVecDeriv*> in(nbRhs);
+        type::vector<const OutVecDeriv*> out(nbRhs);
+        for(size_t v=0; v<nbRhs; v++) { in[v] = dIn[v]->beginEdit(); out[v] = &dOut[v]->getValue(); }
+
+        if(this->assemble.getValue())
+        {
+            // one sparse x dense product
+            typedef Eigen::Matrix<typename SparseMatrixEigen::CompressedMatrix::Scalar,Eigen::Dynamic,Eigen::Dynamic> DenseMatrix;
+            DenseMatrix Y(eigenJacobian.rows(),nbRhs);
+            for(size_t v=0; v<nbRhs; v++) for(size_t i=0; i<out[v]->size(); i++) for(size_t a=0; a<NOut; a++) Y(i*NOut+a,v) = (*out[v])[i][a];
+            const DenseMatrix X = eigenJacobian.compressedMatrix.transpose() * Y;
+            for(size_t v=0; v<nbRhs; v++) for(size_t i=0; i<in[v]->size(); i++) for(size_t c=0; c<NIn; c++) (*in[v])[i][c] += X(i*NIn+c,v);
+        }
+        else
+        {
+#ifdef _OPENMP
+        #pragma omp parallel for if (this->d_parallel.getValue())
+#endif
+            for(int i=0; i < static_cast<int>(jacobian.size()); i++)
+            {
+                BlockType& b = jacobian[i];
+                for(size_t v=0; v<nbRhs; v++) b.addMultTranspose((*in[v])[i],(*out[v])[i]);
+            }
+        }
+
+        for(size_t v=0; v<nbRhs; v++) dIn[v]->endEdit();
+    }
+    //@}
+
 
     virtual void applyDJT(const core::MechanicalParams* mparams, core::MultiVecDerivId parentDfId, core::ConstMultiVecDerivId childForceId ) override
     {
@@ -281,7 +355,7 @@ public:
 
         if( assemble.getValue() ) // assembled version
         {
-            if( K.compressedMatrix.nonZeros() )
+            if( !KDirty )
             {
                 K.addMult(parentForceData,parentDisplacementData,sofa::core::mechanicalparams::kFactor(mparams));
             }
@@ -289,7 +363,7 @@ public:
             {
                 updateK( mparams, childForceId );
                 K.addMult(parentForceData,parentDisplacementData,sofa::core::mechanicalparams::kFactor(mparams));
-                K.resize(0,0); // forgot about this matrix
+                KDirty=true; // forget about these values (the pattern is kept for the next time)
             }
         }
         else
@@ -328,21 +402,35 @@ public:
     virtual void updateK( const core::MechanicalParams* mparams, core::ConstMultiVecDerivId childForceId ) override
     {
         SOFA_UNUSED(mparams);
-        if( BlockType::constant /*|| !assemble.getValue()*/ ) { K.resize(0,0); return; }
+        if( BlockType::constant /*|| !assemble.getValue()*/ ) { K.resize(0,0); KDirty=true; return; }
 
         const OutVecDeriv& childForce = childForceId[this->toModel.get()].read()->getValue();
 
-        unsigned int size = this->fromModel->getSize();
-        K.resizeBlocks(size,size);
-        for(size_t i=0; i<jacobian.size(); i++)
-            K.insertBackBlock( i, i, jacobian[i].getK(childForce[i]) );
-        K.compress();
+        enum { NIn = In::deriv_total_size };
+        const size_t size = this->fromModel->getSize();
+        if( (size_t)K.rows()!=size*NIn || (size_t)K.compressedMatrix.nonZeros()!=size*NIn*NIn ) updateKPattern(size);
+
+        // one diagonal block per sample, written in place
+        auto* values = K.compressedMatrix.valuePtr();
+#ifdef _OPENMP
+#pragma omp parallel for if (this->d_parallel.getValue())
+#endif
+        for(sofa::helper::IndexOpenMP<unsigned int>::type i=0; i<size; i++)
+        {
+            const KBlock Kb = i<jacobian.size() ? jacobian[i].getK(childForce[i]) : KBlock();
+            auto* v = values + i*NIn*NIn;
+            for(size_t a=0; a<NIn; a++)
+                for(size_t b=0; b<NIn; b++)
+                    v[a*NIn+b] = Kb[a][b];
+        }
+
+        KDirty=false;
     }
 
 
     virtual const defaulttype::BaseMatrix* getK() override
     {
-        if( BlockType::constant || !K.compressedMatrix.nonZeros() ) return NULL;
+        if( BlockType::constant || KDirty ) return NULL;
         else return &K;
     }
 
@@ -363,6 +451,8 @@ protected:
         : Inherit ( from, to )
         , assemble ( initData ( &assemble,false, "assemble","Assemble the matrices (Jacobian and Geometric Stiffness) or use optimized matrix/vector multiplications" ) )
         , d_parallel(initData(&d_parallel, false, "parallel", "use openmp parallelisation?"))
+        , standaloneJacobianValid(false)
+        , KDirty(true)
     {
 
     }
@@ -371,20 +461,90 @@ protected:
 
     SparseMatrix jacobian;   ///< Jacobian of the mapping
 
+    /** @name Jacobian of the standalone entry points apply(dOut,dIn) and applyJ(dOut,dIn)
+     * The blocks are kept between calls, like the jacobian of the component: applyJ uses the blocks updated by the last apply.
+     * They are initialized again when the input size changes, and after reinit (e.g. when the decomposition method changes).
+     */
+    //@{
+    SparseMatrix standaloneJacobian;
+    bool standaloneJacobianValid;
+
+    SparseMatrix& getStandaloneJacobian(size_t size)
+    {
+        if( !standaloneJacobianValid || standaloneJacobian.size()!=size )
+        {
+            standaloneJacobian.resize(size);
+            initJacobianBlock(standaloneJacobian);
+            standaloneJacobianValid = true;
+        }
+        return standaloneJacobian;
+    }
+    //@}
+
+    /** @name Assembled matrices
+     * Both are block diagonal (one block per sample): their compressed patterns are built once (with full blocks,
+     * so that they do not depend on the values), then only their values are overwritten, in parallel.
+     */
+    //@{
     SparseMatrixEigen eigenJacobian;  ///< Assembled Jacobian matrix
     type::vector<defaulttype::BaseMatrix*> baseMatrices;      ///< Vector of jacobian matrices, for the Compliant plugin API
     void updateJ()
     {
-        unsigned int insize = this->fromModel->getSize();
-        unsigned int outsize = this->toModel->getSize();
+        enum { NIn = In::deriv_total_size, NOut = Out::deriv_total_size };
+        const size_t insize = this->fromModel->getSize();
+        const size_t outsize = jacobian.size();
 
-        eigenJacobian.resizeBlocks(outsize,insize);
-        for(size_t i=0; i<jacobian.size(); i++)
-            eigenJacobian.insertBackBlock( i, i, jacobian[i].getJ() );
-        eigenJacobian.compress();
+        if( (size_t)eigenJacobian.rows()!=outsize*NOut || (size_t)eigenJacobian.cols()!=insize*NIn || (size_t)eigenJacobian.compressedMatrix.nonZeros()!=outsize*NOut*NIn )
+            updateJPattern(outsize,insize);
+
+        auto* values = eigenJacobian.compressedMatrix.valuePtr();
+#ifdef _OPENMP
+#pragma omp parallel for if (this->d_parallel.getValue())
+#endif
+        for(sofa::helper::IndexOpenMP<unsigned int>::type i=0; i<outsize; i++)
+        {
+            const MatBlock Jb = jacobian[i].getJ();
+            auto* v = values + i*NOut*NIn;
+            for(size_t a=0; a<NOut; a++)
+                for(size_t c=0; c<NIn; c++)
+                    v[a*NIn+c] = Jb[a][c];
+        }
+    }
+    /// the scalar row a of sample i holds the row a of its block: the nonzeros of the row start at (i*NOut+a)*NIn
+    void updateJPattern(const size_t childSize, const size_t parentSize)
+    {
+        enum { NIn = In::deriv_total_size, NOut = Out::deriv_total_size };
+        eigenJacobian.resize(childSize*NOut,parentSize*NIn);
+        typename SparseMatrixEigen::CompressedMatrix& M = eigenJacobian.compressedMatrix;
+        M.resizeNonZeros(childSize*NOut*NIn);
+        auto* outer = M.outerIndexPtr();
+        auto* inner = M.innerIndexPtr();
+        for(size_t r=0; r<childSize*NOut; r++)
+        {
+            outer[r] = r*NIn;
+            for(size_t c=0; c<NIn; c++) inner[r*NIn+c] = (r/NOut)*NIn+c;
+        }
+        outer[childSize*NOut] = childSize*NOut*NIn;
     }
 
     SparseKMatrixEigen K;  ///< Assembled geometric stiffness matrix
+    bool KDirty;           ///< tells if the values of K are not up to date with the child forces
+    void updateKPattern(const size_t parentSize)
+    {
+        enum { NIn = In::deriv_total_size };
+        K.resize(parentSize*NIn,parentSize*NIn);
+        typename SparseKMatrixEigen::CompressedMatrix& M = K.compressedMatrix;
+        M.resizeNonZeros(parentSize*NIn*NIn);
+        auto* outer = M.outerIndexPtr();
+        auto* inner = M.innerIndexPtr();
+        for(size_t r=0; r<parentSize*NIn; r++)
+        {
+            outer[r] = r*NIn;
+            for(size_t c=0; c<NIn; c++) inner[r*NIn+c] = (r/NIn)*NIn+c;
+        }
+        outer[parentSize*NIn] = parentSize*NIn*NIn;
+    }
+    //@}
 };
 
 
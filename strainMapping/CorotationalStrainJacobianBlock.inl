@@ -156,6 +156,43 @@ void extractRotation(const Mat<3,3,Real> &_A, Mat<3,3,Real> &_R, const unsigned
 }
 
 
+/// rotation R of the polar decomposition A = R.S (for det(A)>0), by Newton iterations seeded with R (warm start)
+/// each iteration rotates R by the solution of \f$ (tr(S)I-S).\omega = axl(R^T A - A^T R) \f$ with \f$ S = sym(R^T A) \f$
+/// the convergence is quadratic: two or three iterations from the rotation of a close matrix
+/// @returns false if the iterations did not converge (R is then meaningless)
+template<typename Real>
+bool polarRotationNewton(const Mat<3,3,Real> &A, Mat<3,3,Real> &R, const unsigned int maxIter=4, const Real tolerance = helper::Decompose<Real>::zeroTolerance())
+{
+    for (unsigned int iter = 0; iter < maxIter; iter++)
+    {
+        const Mat<3,3,Real> B = R.multTranspose( A ); // B = Rt * A
+        const Vec<3,Real> v( B[2][1]-B[1][2], B[0][2]-B[2][0], B[1][0]-B[0][1] );
+        const Real trace = B[0][0]+B[1][1]+B[2][2];
+        Mat<3,3,Real> H; // H = tr(S)I - S, positive definite close to the solution
+        for(unsigned int i=0; i<3; i++) for(unsigned int j=0; j<3; j++) H[i][j] = (i==j?trace:(Real)0) - (B[i][j]+B[j][i])*(Real)0.5;
+        if( H[0][0] <= 0 || H[0][0]*H[1][1]-H[0][1]*H[1][0] <= 0 || type::determinant( H ) <= 0 ) return false;
+
+        Mat<3,3,Real> invH;
+        invH.invert( H );
+        const Vec<3,Real> omega = invH * v;
+        const Real w = omega.norm();
+
+        if( w > 0 ) // R = R * exp([omega]x), Rodrigues formula
+        {
+            Mat<3,3,Real> K;
+            K[0][1] = -omega[2]; K[0][2] =  omega[1];
+            K[1][0] =  omega[2]; K[1][2] = -omega[0];
+            K[2][0] = -omega[1]; K[2][1] =  omega[0];
+            Mat<3,3,Real> E = K*(std::sin(w)/w) + (K*K)*((1-std::cos(w))/(w*w));
+            for(unsigned int i=0; i<3; i++) E[i][i] += 1;
+            R = R*E;
+        }
+        if( w < tolerance ) return true;
+    }
+    return false;
+}
+
+
 
 
 ////////////////////////////////////////////////////////
@@ -307,17 +344,21 @@ public:
 
     CorotationalStrainJacobianBlockGeometricStiffnessData<material_dimensions,frame_size,Real> _geometricStiffnessData; ///< store stuff dedicated to geometric stiffness
 
+    Frame _Fref;        ///< deformation gradient of the last decomposition, reused by addapply_incremental
+    bool _hasRotation;  ///< do _R and _geometricStiffnessData come from the decomposition of _Fref?
+
 
     CorotationalStrainJacobianBlock()
         : Inherit()
+        , _hasRotation( false )
     {
     }
 
-    void init_small() { _geometricStiffnessData.init_small(); }
-    void init_qr( bool geometricStiffness ) { _geometricStiffnessData.init_qr( geometricStiffness ); }
-    void init_polar( bool geometricStiffness ) { _geometricStiffnessData.init_polar( geometricStiffness ); }
-    void init_svd( bool geometricStiffness ) { _geometricStiffnessData.init_svd( geometricStiffness ); }
-    void init_frobenius( bool geometricStiffness ) { _geometricStiffnessData.init_frobenius( geometricStiffness ); _R.identity(); }
+    void init_small() { _geometricStiffnessData.init_small(); _hasRotation=false; }
+    void init_qr( bool geometricStiffness ) { _geometricStiffnessData.init_qr( geometricStiffness ); _hasRotation=false; }
+    void init_polar( bool geometricStiffness ) { _geometricStiffnessData.init_polar( geometricStiffness ); _hasRotation=false; }
+    void init_svd( bool geometricStiffness ) { _geometricStiffnessData.init_svd( geometricStiffness ); _hasRotation=false; }
+    void init_frobenius( bool geometricStiffness ) { _geometricStiffnessData.init_frobenius( geometricStiffness ); _R.identity(); _hasRotation=false; }
 
 
     void addapply( OutCoord& /*result*/, const InCoord& /*data*/ ) {}
@@ -349,6 +390,7 @@ public:
     void addapply_polar( OutCoord& result, const InCoord& data )
     {
         StrainMat strainmat;
+        _hasRotation = false;
 
         helper::Decompose<Real>::polarDecomposition( data.getF(), _R, strainmat );
 
@@ -363,6 +405,7 @@ public:
     void addapply_svd( OutCoord& result, const InCoord& data )
     {
         StrainMat strainmat;
+        _hasRotation = false;
 
 
         //_geometricStiffnessData.degenerated() = computeSVD( data.getF(), _R, strainmat, U, S, V ) || determinant( data.getF() ) < helper::Decompose<Real>::zeroTolerance();
@@ -379,6 +422,92 @@ public:
         addapply_common( result, data, strainmat );
     }
 
+    /// addapply_svd from a given decomposition F = U.diag(S).V^T (U and V rotations, S[2]<0 for inverted F), e.g. computed by the batched corotational::svd
+    void addapply_svd( OutCoord& result, const InCoord& data, const Affine& U, const Vec<material_dimensions,Real>& S, const Affine& V )
+    {
+        _R = U.multTransposed( V ); // r = U * Vt
+        StrainMat strainmat = _R.multTranspose( data.getF() ); // s = rt * F
+        _hasRotation = false;
+
+        if( _geometricStiffnessData.dROverdF() )
+        {
+            _geometricStiffnessData.degenerated() = S[material_dimensions-1] < helper::Decompose<Real>::zeroTolerance()
+                    || !helper::Decompose<Real>::polarDecomposition_stable_Gradient_dQOverdM( U, S, V, *_geometricStiffnessData.dROverdF() )
+                    || type::determinant( data.getF() ) < helper::Decompose<Real>::zeroTolerance();
+        }
+
+        addapply_common( result, data, strainmat );
+    }
+    /// addapply_polar from a given decomposition F = U.diag(S).V^T: the orthogonal factor of the polar decomposition is U.diag(1,1,sign(S[2])).V^T
+    void addapply_polar( OutCoord& result, const InCoord& data, const Affine& U, const Vec<material_dimensions,Real>& S, const Affine& V )
+    {
+        Affine US = U;
+        if( S[material_dimensions-1] < 0 ) for(unsigned int r=0; r<spatial_dimensions; r++) US[r][material_dimensions-1] = -US[r][material_dimensions-1];
+        _R = US.multTransposed( V );
+        StrainMat strainmat = cauchyStrainTensor( _R.multTranspose( data.getF() ) ); // symmetric stretch = V.|diag(S)|.Vt
+        _hasRotation = false;
+
+        if( _geometricStiffnessData.invG() )
+        {
+            helper::Decompose<Real>::polarDecompositionGradient_G( _R, strainmat, *_geometricStiffnessData.invG() );
+            _geometricStiffnessData.degenerated() = type::determinant( data.getF() ) < helper::Decompose<Real>::zeroTolerance();
+        }
+
+        addapply_common( result, data, strainmat );
+    }
+
+    /// how the rotation has been obtained by addapply_incremental
+    enum RotationUpdate { ROTATION_SKIPPED=0, ROTATION_WARMSTARTED, ROTATION_DECOMPOSED, NB_RotationUpdate };
+
+    /** addapply_polar (svd=false) or addapply_svd (svd=true) reusing the last decomposition, computed for _Fref:
+      - skipped (the previous rotation is kept) when \f$ ||F-F_{ref}|| <= skipTolerance \f$,
+      - warm started when warmStart is set: polarRotationNewton seeded with the previous rotation, for non inverted F,
+        and when dR/dF is not needed (svd with geometric stiffness),
+      - otherwise (or when the warm start does not converge), computed from scratch.
+      */
+    RotationUpdate addapply_incremental( OutCoord& result, const InCoord& data, bool svd, Real skipTolerance, bool warmStart )
+    {
+        const Frame& F = data.getF();
+        if( _hasRotation )
+        {
+            if( skipTolerance>0 )
+            {
+                Real d2 = 0;
+                for(unsigned int r=0; r<spatial_dimensions; r++) for(unsigned int c=0; c<material_dimensions; c++) d2 += (F[r][c]-_Fref[r][c])*(F[r][c]-_Fref[r][c]);
+                if( d2 <= skipTolerance*skipTolerance )
+                {
+                    StrainMat strainmat = _R.multTranspose( F );
+                    if( !svd ) strainmat = cauchyStrainTensor( strainmat );
+                    addapply_common( result, data, strainmat );
+                    return ROTATION_SKIPPED;
+                }
+            }
+
+            if( warmStart && !( svd && _geometricStiffnessData.dROverdF() ) && type::determinant( F ) > helper::Decompose<Real>::zeroTolerance() )
+            {
+                if( polarRotationNewton<Real>( F, _R ) ) // rotation of the polar decomposition, as the one of the svd method for non inverted F
+                {
+                    StrainMat strainmat = _R.multTranspose( F );
+                    if( !svd ) strainmat = cauchyStrainTensor( strainmat );
+                    if( !svd && _geometricStiffnessData.invG() )
+                    {
+                        helper::Decompose<Real>::polarDecompositionGradient_G( _R, strainmat, *_geometricStiffnessData.invG() );
+                        _geometricStiffnessData.degenerated() = false;
+                    }
+                    addapply_common( result, data, strainmat );
+                    _Fref = F;
+                    return ROTATION_WARMSTARTED;
+                }
+            }
+        }
+
+        if( svd ) addapply_svd( result, data );
+        else addapply_polar( result, data );
+        _Fref = F;
+        _hasRotation = true;
+        return ROTATION_DECOMPOSED;
+    }
+
     void addapply_frobenius( OutCoord& result, const InCoord& data )
     {
         extractRotation<Real>( data.getF(), _R );
@@ -0,0 +1,203 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#define SOFA_COMPONENT_MAPPING_CorotationalStrainKernel_CPP
+
+#include "CorotationalStrainKernel.h"
+
+#include <cmath>
+#include <limits>
+
+// the lane loops below are written once, and compiled for each instruction set with function attributes, whatever the compilation flags.
+// They are vectorized when sqrt does not set errno (this file is compiled with -fno-math-errno, sqrt is only called on positive values)
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define FLEXIBLE_COROTATIONAL_X86
+#endif
+#if defined(__GNUC__) || defined(__clang__)
+#define FLEXIBLE_COROTATIONAL_INLINE __attribute__((always_inline)) inline
+#else
+#define FLEXIBLE_COROTATIONAL_INLINE inline
+#endif
+
+namespace sofa
+{
+
+namespace defaulttype
+{
+
+namespace corotational
+{
+
+template<class Real>
+static FLEXIBLE_COROTATIONAL_INLINE Real absolute(Real x) { return x<0 ? -x : x; }
+
+/// one Jacobi rotation of the symmetric matrices a, cancelling a(p,q), accumulated in v (r is the remaining index)
+template<class Real, std::size_t W, int p, int q, int r>
+static FLEXIBLE_COROTATIONAL_INLINE void jacobi(Real (&a)[3][3][W], Real (&v)[3][3][W])
+{
+    for(std::size_t l=0; l<W; l++)
+    {
+        const Real apq=a[p][q][l], app=a[p][p][l], aqq=a[q][q][l], arp=a[r][p][l], arq=a[r][q][l];
+        // t = tan(angle) = sign(theta)/(|theta|+sqrt(theta^2+1)), with theta = (aqq-app)/(2.apq), written without division by apq
+        // so that it is null (no rotation) when apq=0, without any branch
+        const Real d = aqq-app;
+        const Real t = 2*apq*std::copysign((Real)1,d)/(absolute(d)+std::sqrt(d*d+4*apq*apq)+std::numeric_limits<Real>::min());
+        const Real c = 1/std::sqrt(t*t+1), s = t*c;
+        a[p][p][l]=app-t*apq; a[q][q][l]=aqq+t*apq; a[p][q][l]=a[q][p][l]=0;
+        a[r][p][l]=a[p][r][l]=c*arp-s*arq; a[r][q][l]=a[q][r][l]=s*arp+c*arq;
+        for(int k=0; k<3; k++) { const Real vp=v[k][p][l], vq=v[k][q][l]; v[k][p][l]=c*vp-s*vq; v[k][q][l]=s*vp+c*vq; }
+    }
+}
+
+/// order the eigenvalues a(i,i)>=a(j,j), swapping the columns of v (and changing the sign of one of them, so that v remains a rotation)
+template<class Real, std::size_t W, int i, int j>
+static FLEXIBLE_COROTATIONAL_INLINE void sort(Real (&a)[3][3][W], Real (&v)[3][3][W])
+{
+    for(std::size_t l=0; l<W; l++)
+    {
+        const Real ai=a[i][i][l], aj=a[j][j][l];
+        const bool swap = ai<aj;
+        a[i][i][l] = swap ? aj : ai; a[j][j][l] = swap ? ai : aj;
+        for(int k=0; k<3; k++) { const Real vi=v[k][i][l], vj=v[k][j][l]; v[k][i][l] = swap ? vj : vi; v[k][j][l] = swap ? -vi : vj; }
+    }
+}
+
+/// Givens rotation of the rows i and j of b, cancelling b(j,c), accumulated in u
+template<class Real, std::size_t W, int i, int j, int c>
+static FLEXIBLE_COROTATIONAL_INLINE void givens(Real (&b)[3][3][W], Real (&u)[3][3][W])
+{
+    for(std::size_t l=0; l<W; l++)
+    {
+        const Real x=b[i][c][l], y=b[j][c][l];
+        // cs = x/n, sn = y/n, and the identity for a null column (n.invn=0), without any branch
+        const Real n = std::sqrt(x*x+y*y), invn = 1/(n+std::numeric_limits<Real>::min());
+        const Real cs = x*invn + (1-n*invn), sn = y*invn;
+        for(int k=0; k<3; k++)
+        {
+            const Real bi=b[i][k][l], bj=b[j][k][l]; b[i][k][l]=cs*bi+sn*bj; b[j][k][l]=cs*bj-sn*bi;
+            const Real ui=u[k][i][l], uj=u[k][j][l]; u[k][i][l]=cs*ui+sn*uj; u[k][j][l]=cs*uj-sn*ui;
+        }
+    }
+}
+
+/// decomposition of W matrices, one per lane
+template<class Real, std::size_t W>
+static FLEXIBLE_COROTATIONAL_INLINE void svdBatch(Real* U, Real* S, Real* V, const Real* F)
+{
+    // quadratic convergence of the cyclic Jacobi method: a few sweeps reach the machine precision
+    enum { nbSweeps = sizeof(Real)<=4 ? 4 : 6 };
+
+    Real f[3][3][W], a[3][3][W], u[3][3][W], v[3][3][W];
+    for(int r=0; r<3; r++) for(int c=0; c<3; c++) for(std::size_t l=0; l<W; l++)
+    {
+        f[r][c][l]=F[9*l+3*r+c];
+        u[r][c][l]=v[r][c][l]=(r==c)?(Real)1:(Real)0;
+    }
+
+    // a = F^T.F
+    for(int r=0; r<3; r++) for(int c=r; c<3; c++) for(std::size_t l=0; l<W; l++)
+        a[r][c][l]=a[c][r][l]=f[0][r][l]*f[0][c][l]+f[1][r][l]*f[1][c][l]+f[2][r][l]*f[2][c][l];
+
+    // V: eigenvectors of F^T.F, ordered by decreasing eigenvalues
+    for(int k=0; k<nbSweeps; k++)
+    {
+        jacobi<Real,W,0,1,2>(a,v);
+        jacobi<Real,W,0,2,1>(a,v);
+        jacobi<Real,W,1,2,0>(a,v);
+    }
+    sort<Real,W,0,1>(a,v);
+    sort<Real,W,0,2>(a,v);
+    sort<Real,W,1,2>(a,v);
+
+    // F.V = U.diag(S), from a QR factorization
+    Real b[3][3][W];
+    for(int r=0; r<3; r++) for(int c=0; c<3; c++) for(std::size_t l=0; l<W; l++)
+        b[r][c][l]=f[r][0][l]*v[0][c][l]+f[r][1][l]*v[1][c][l]+f[r][2][l]*v[2][c][l];
+    givens<Real,W,0,1,0>(b,u);
+    givens<Real,W,0,2,0>(b,u);
+    givens<Real,W,1,2,1>(b,u);
+
+    for(std::size_t l=0; l<W; l++)
+    {
+        for(int r=0; r<3; r++) for(int c=0; c<3; c++) { U[9*l+3*r+c]=u[r][c][l]; V[9*l+3*r+c]=v[r][c][l]; }
+        for(int k=0; k<3; k++) S[3*l+k]=b[k][k][l];
+    }
+}
+
+/// full batches, then the remaining matrices in a batch padded with identities
+template<class Real, std::size_t W>
+static FLEXIBLE_COROTATIONAL_INLINE void svdLoop(Real* U, Real* S, Real* V, const Real* F, std::size_t n)
+{
+    std::size_t i=0;
+    for(; i+W<=n; i+=W) svdBatch<Real,W>(U+9*i,S+3*i,V+9*i,F+9*i);
+    if(i<n)
+    {
+        Real f[9*W], u[9*W], s[3*W], v[9*W];
+        for(std::size_t l=0; l<W; l++) for(int k=0; k<9; k++) f[9*l+k] = i+l<n ? F[9*(i+l)+k] : (k%4==0 ? (Real)1 : (Real)0);
+        svdBatch<Real,W>(u,s,v,f);
+        for(std::size_t l=0; i+l<n; l++)
+        {
+            for(int k=0; k<9; k++) { U[9*(i+l)+k]=u[9*l+k]; V[9*(i+l)+k]=v[9*l+k]; }
+            for(int k=0; k<3; k++) S[3*(i+l)+k]=s[3*l+k];
+        }
+    }
+}
+
+template<class Real>
+static void svdScalar(Real* U, Real* S, Real* V, const Real* F, std::size_t n) { svdLoop<Real,SVDBatch<Real>::W>(U,S,V,F,n); }
+
+#ifdef FLEXIBLE_COROTATIONAL_X86
+template<class Real>
+static __attribute__((target("avx2,fma"))) void svdAVX2(Real* U, Real* S, Real* V, const Real* F, std::size_t n) { svdLoop<Real,SVDBatch<Real>::W>(U,S,V,F,n); }
+
+template<class Real>
+static __attribute__((target("avx512f"))) void svdAVX512(Real* U, Real* S, Real* V, const Real* F, std::size_t n) { svdLoop<Real,SVDBatch<Real>::W>(U,S,V,F,n); }
+#endif
+
+template<class Real>
+static void svdDispatch(Real* U, Real* S, Real* V, const Real* F, std::size_t n)
+{
+    switch(simd::getSimdLevel())
+    {
+#ifdef FLEXIBLE_COROTATIONAL_X86
+    case simd::SIMD_AVX512: svdAVX512(U,S,V,F,n); break;
+    case simd::SIMD_AVX2: svdAVX2(U,S,V,F,n); break;
+#endif
+    default: svdScalar(U,S,V,F,n);
+    }
+}
+
+
+
+void svd(double* U, double* S, double* V, const double* F, std::size_t n)
+{
+    svdDispatch(U,S,V,F,n);
+}
+
+void svd(float* U, float* S, float* V, const float* F, std::size_t n)
+{
+    svdDispatch(U,S,V,F,n);
+}
+
+} // namespace corotational
+
+} // namespace defaulttype
+} // namespace sofa
@@ -0,0 +1,63 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#ifndef FLEXIBLE_CorotationalStrainKernel_H
+#define FLEXIBLE_CorotationalStrainKernel_H
+
+#include <Flexible/config.h>
+#include "../SimdLevel.h"
+#include <cstddef>
+
+namespace sofa
+{
+
+namespace defaulttype
+{
+
+namespace corotational
+{
+
+/// number of matrices decomposed at once, one per SIMD lane (one AVX-512 register, or two AVX2 registers)
+template<class Real> struct SVDBatch { enum { W = 64/sizeof(Real) }; };
+
+/** Singular value decompositions \f$ F_i = U_i.diag(S_i).V_i^T \f$ of n 3x3 matrices, by batches of SVDBatch<Real>::W matrices.
+
+  The decomposition is branch-free, so that each lane processes one matrix: a fixed number of cyclic Jacobi sweeps diagonalizes \f$ F^T.F \f$
+  (giving V), the singular values are sorted, and the Givens QR factorization of F.V gives U and the singular values.
+  U and V are rotations. For inverted matrices (det F<0) the smallest singular value is negative, as in helper::Decompose::SVD_stable,
+  and flat matrices give a null singular value with well defined rotations.
+  The instruction set is given by simd::getSimdLevel.
+
+  @param U,V 9 reals per matrix, row major
+  @param S 3 reals per matrix, by decreasing magnitude
+  @param F 9 reals per matrix, row major
+*/
+SOFA_Flexible_API void svd(double* U, double* S, double* V, const double* F, std::size_t n);
+SOFA_Flexible_API void svd(float* U, float* S, float* V, const float* F, std::size_t n);
+
+} // namespace corotational
+
+} // namespace defaulttype
+} // namespace sofa
+
+
+
+#endif
@@ -43,13 +43,22 @@ int CorotationalStrainMappingClass = core::RegisterObject("Map Deformation Gradi
         .add< CorotationalStrainMapping< F321Types, E321Types > >()
         .add< CorotationalStrainMapping< F311Types, E311Types > >()
         .add< CorotationalStrainMapping< F332Types, E332Types > >()
-        .add< CorotationalStrainMapping< F221Types, E221Types > >();
+        .add< CorotationalStrainMapping< F221Types, E221Types > >()
+        .add< CorotationalStrainMapping< F331OtherTypes, E331OtherTypes > >()
+        .add< CorotationalStrainMapping< F321OtherTypes, E321OtherTypes > >()
+        .add< CorotationalStrainMapping< F311OtherTypes, E311OtherTypes > >()
+        .add< CorotationalStrainMapping< F332OtherTypes, E332OtherTypes > >()
+        ;
 
 template class SOFA_Flexible_API CorotationalStrainMapping< F331Types, E331Types >;
 template class SOFA_Flexible_API CorotationalStrainMapping< F321Types, E321Types >;
 template class SOFA_Flexible_API CorotationalStrainMapping< F311Types, E311Types >;
 template class SOFA_Flexible_API CorotationalStrainMapping< F332Types, E332Types >;
 template class SOFA_Flexible_API CorotationalStrainMapping< F221Types, E221Types >;
+template class SOFA_Flexible_API CorotationalStrainMapping< F331OtherTypes, E331OtherTypes >;
+template class SOFA_Flexible_API CorotationalStrainMapping< F321OtherTypes, E321OtherTypes >;
+template class SOFA_Flexible_API CorotationalStrainMapping< F311OtherTypes, E311OtherTypes >;
+template class SOFA_Flexible_API CorotationalStrainMapping< F332OtherTypes, E332OtherTypes >;
 
 } // namespace mapping
 } // namespace component
@@ -25,6 +25,7 @@
 #include <Flexible/config.h>
 #include "../strainMapping/BaseStrainMapping.h"
 #include "../strainMapping/CorotationalStrainJacobianBlock.inl"
+#include "../strainMapping/CorotationalStrainKernel.h"
 
 #include <sofa/helper/OptionsGroup.h>
 
@@ -65,6 +66,16 @@ public:
 
 
     Data<bool> f_geometricStiffness; ///< should geometricStiffness be considered?
+    Data<bool> d_simd; ///< batched decompositions (svd and polar methods, 3D deformation gradients)
+
+    /** @name Reuse of the previous decompositions (svd and polar methods, 3D deformation gradients)
+       The previous rotation of each sample is kept, or used to seed a few Newton iterations of the polar decomposition.
+    */
+    //@{
+    Data<bool> d_warmStart; ///< warm-started rotation extraction
+    Data<typename Inherit::Real> d_skipTolerance; ///< keep the previous rotation when the deformation gradient moved less than this tolerance
+    Data<type::Vec<3,unsigned int> > d_rotationStatistics; ///< output: number of skipped, warm started and computed decompositions at the last apply
+    //@}
 
     //Pierre-Luc : I added this function to use some functionalities of the mapping component whitout using it as a sofa graph component (protected)
     virtual void initJacobianBlock( type::vector<BlockType>& jacobianBlock ) override
@@ -172,6 +183,10 @@ protected:
         : Inherit ( from, to )
         , f_method( initData( &f_method, "method", "Decomposition method" ) )
         , f_geometricStiffness( initData( &f_geometricStiffness, false, "geometricStiffness", "Should geometricStiffness be considered?" ) )
+        , d_simd( initData( &d_simd, false, "simd", "Compute the svd and polar decompositions of 3D deformation gradients by batches, using SIMD instructions?" ) )
+        , d_warmStart( initData( &d_warmStart, false, "warmStart", "Extract the rotations of 3D deformation gradients (svd and polar methods) from the previous ones, with a few iterations, instead of decomposing them from scratch?" ) )
+        , d_skipTolerance( initData( &d_skipTolerance, (typename Inherit::Real)0, "skipTolerance", "Keep the previous rotation of 3D deformation gradients (svd and polar methods) when the Frobenius norm of their change since the last decomposition is below this tolerance (0 to disable)" ) )
+        , d_rotationStatistics( initData( &d_rotationStatistics, "rotationStatistics", "output: number of skipped, warm started and computed decompositions at the last apply (when warmStart or skipTolerance are set)" ) )
     {
         helper::OptionsGroup Options;
         Options.setNbItems( NB_DecompositionMethod );
@@ -221,6 +236,16 @@ protected:
         }
         case POLAR:
         {
+            if( decompositions3D && ( d_warmStart.getValue() || d_skipTolerance.getValue()>0 ) )
+            {
+                applyIncremental( out, in, jacobianBlock, false );
+                break;
+            }
+            if( decompositions3D && d_simd.getValue() )
+            {
+                applyBatched( out, in, jacobianBlock, false );
+                break;
+            }
 #ifdef _OPENMP
         #pragma omp parallel for if (this->d_parallel.getValue())
 #endif
@@ -234,6 +259,16 @@ protected:
         }
         case SVD:
         {
+            if( decompositions3D && ( d_warmStart.getValue() || d_skipTolerance.getValue()>0 ) )
+            {
+                applyIncremental( out, in, jacobianBlock, true );
+                break;
+            }
+            if( decompositions3D && d_simd.getValue() )
+            {
+                applyBatched( out, in, jacobianBlock, true );
+                break;
+            }
 #ifdef _OPENMP
         #pragma omp parallel for if (this->d_parallel.getValue())
 #endif
@@ -300,6 +335,16 @@ protected:
         }
         case POLAR:
         {
+            if( decompositions3D && ( d_warmStart.getValue() || d_skipTolerance.getValue()>0 ) )
+            {
+                applyIncremental( out, in, this->jacobian, false );
+                break;
+            }
+            if( decompositions3D && d_simd.getValue() )
+            {
+                applyBatched( out, in, this->jacobian, false );
+                break;
+            }
 #ifdef _OPENMP
         #pragma omp parallel for if (this->d_parallel.getValue())
 #endif
@@ -312,6 +357,16 @@ protected:
         }
         case SVD:
         {
+            if( decompositions3D && ( d_warmStart.getValue() || d_skipTolerance.getValue()>0 ) )
+            {
+                applyIncremental( out, in, this->jacobian, true );
+                break;
+            }
+            if( decompositions3D && d_simd.getValue() )
+            {
+                applyBatched( out, in, this->jacobian, true );
+                break;
+            }
 #ifdef _OPENMP
         #pragma omp parallel for if (this->d_parallel.getValue())
 #endif
@@ -341,6 +396,72 @@ protected:
         if(!BlockType::constant && this->assemble.getValue()) this->updateJ();
     }
 
+    /// batched and incremental decompositions are implemented for 3D deformation gradients only
+    static const bool decompositions3D = BlockType::material_dimensions==3 && BlockType::spatial_dimensions==3;
+
+    /// number of deformation gradients given to a thread at once
+    enum { SVDChunk = 64 };
+
+    void applyBatched( typename Inherit::OutVecCoord& out, const typename Inherit::InVecCoord& in, type::vector<BlockType>& jacobianBlock, bool svd )
+    {
+        if constexpr( decompositions3D )
+        {
+            typedef typename BlockType::Real Real;
+            typedef typename BlockType::Affine Affine;
+            const std::size_t nbChunks = (jacobianBlock.size()+SVDChunk-1)/SVDChunk;
+#ifdef _OPENMP
+#pragma omp parallel for if (this->d_parallel.getValue())
+#endif
+            for(helper::IndexOpenMP<unsigned int>::type c=0; c<nbChunks; c++)
+            {
+                const std::size_t begin = c*SVDChunk, n = std::min<std::size_t>(jacobianBlock.size(),begin+SVDChunk)-begin;
+                Real F[9*SVDChunk], U[9*SVDChunk], S[3*SVDChunk], V[9*SVDChunk];
+                for(std::size_t i=0; i<n; i++)
+                    for(unsigned int r=0; r<3; r++) for(unsigned int k=0; k<3; k++) F[9*i+3*r+k] = (Real)in[begin+i].getF()[r][k];
+
+                defaulttype::corotational::svd(U,S,V,F,n);
+
+                for(std::size_t i=0; i<n; i++)
+                {
+                    Affine u, v; type::Vec<3,Real> s;
+                    for(unsigned int r=0; r<3; r++)
+                    {
+                        for(unsigned int k=0; k<3; k++) { u[r][k] = U[9*i+3*r+k]; v[r][k] = V[9*i+3*r+k]; }
+                        s[r] = S[3*i+r];
+                    }
+                    out[begin+i] = typename Inherit::OutCoord();
+                    if( svd ) jacobianBlock[begin+i].addapply_svd( out[begin+i], in[begin+i], u, s, v );
+                    else jacobianBlock[begin+i].addapply_polar( out[begin+i], in[begin+i], u, s, v );
+                }
+            }
+        }
+    }
+
+    void applyIncremental( typename Inherit::OutVecCoord& out, const typename Inherit::InVecCoord& in, type::vector<BlockType>& jacobianBlock, bool svd )
+    {
+        if constexpr( decompositions3D )
+        {
+            const typename Inherit::Real skipTolerance = d_skipTolerance.getValue();
+            const bool warmStart = d_warmStart.getValue();
+            unsigned int nbSkipped = 0, nbWarmStarted = 0, nbDecomposed = 0;
+#ifdef _OPENMP
+#pragma omp parallel for if (this->d_parallel.getValue()) reduction(+:nbSkipped,nbWarmStarted,nbDecomposed)
+#endif
+            for(helper::IndexOpenMP<unsigned int>::type i=0; i<jacobianBlock.size(); i++)
+            {
+                out[i] = typename Inherit::OutCoord();
+                switch( jacobianBlock[i].addapply_incremental( out[i], in[i], svd, skipTolerance, warmStart ) )
+                {
+                case BlockType::ROTATION_SKIPPED: nbSkipped++; break;
+                case BlockType::ROTATION_WARMSTARTED: nbWarmStarted++; break;
+                default: nbDecomposed++;
+                }
+            }
+            d_rotationStatistics.setValue( type::Vec<3,unsigned int>( nbSkipped, nbWarmStarted, nbDecomposed ) );
+            msg_info() << "rotations: " << nbSkipped << " skipped, " << nbWarmStarted << " warm started, " << nbDecomposed << " decomposed";
+        }
+    }
+
     virtual void applyDJT(const core::MechanicalParams* mparams, core::MultiVecDerivId parentDfId, core::ConstMultiVecDerivId ) override
     {
         if( !f_geometricStiffness.getValue() ) return;
@@ -44,13 +44,22 @@ int GreenStrainMappingClass = core::RegisterObject("Map Deformation Gradients to
         .add< GreenStrainMapping< F321Types, E321Types > >()
         .add< GreenStrainMapping< F311Types, E311Types > >()
         .add< GreenStrainMapping< F332Types, E332Types > >()
-        .add< GreenStrainMapping< F332Types, E333Types > >();
+        .add< GreenStrainMapping< F332Types, E333Types > >()
+        .add< GreenStrainMapping< F331OtherTypes, E331OtherTypes > >()
+        .add< GreenStrainMapping< F321OtherTypes, E321OtherTypes > >()
+        .add< GreenStrainMapping< F311OtherTypes, E311OtherTypes > >()
+        .add< GreenStrainMapping< F332OtherTypes, E332OtherTypes > >()
+        ;
 
 template class SOFA_Flexible_API GreenStrainMapping< F331Types, E331Types >;
 template class SOFA_Flexible_API GreenStrainMapping< F321Types, E321Types >;
 template class SOFA_Flexible_API GreenStrainMapping< F311Types, E311Types >;
 template class SOFA_Flexible_API GreenStrainMapping< F332Types, E332Types >;
 template class SOFA_Flexible_API GreenStrainMapping< F332Types, E333Types >;
+template class SOFA_Flexible_API GreenStrainMapping< F331OtherTypes, E331OtherTypes >;
+template class SOFA_Flexible_API GreenStrainMapping< F321OtherTypes, E321OtherTypes >;
+template class SOFA_Flexible_API GreenStrainMapping< F311OtherTypes, E311OtherTypes >;
+template class SOFA_Flexible_API GreenStrainMapping< F332OtherTypes, E332OtherTypes >;
 
 } // namespace mapping
 } // namespace component
@@ -41,6 +41,7 @@ using namespace defaulttype;
 int InvariantMappingClass = core::RegisterObject("Map deformation gradients to the invariants of the right Cauchy Green deformation tensor: I1, I2 and J")
 
         .add< InvariantMapping< F331Types, I331Types > >(true)
+        .add< InvariantMapping< F331OtherTypes, I331OtherTypes > >()
 //.add< InvariantMapping< F332Types, I332Types > >()
 //.add< InvariantMapping< F332Types, I333Types > >()
 
@@ -48,6 +49,7 @@ int InvariantMappingClass = core::RegisterObject("Map deformation gradients to t
         ;
 
 template class SOFA_Flexible_API InvariantMapping< F331Types, I331Types >;
+template class SOFA_Flexible_API InvariantMapping< F331OtherTypes, I331OtherTypes >;
 //template class SOFA_Flexible_API InvariantMapping< F332Types, I332Types >;
 //template class SOFA_Flexible_API InvariantMapping< F332Types, I333Types >;
 //template class SOFA_Flexible_API InvariantMapping< U331Types, I331Types >;
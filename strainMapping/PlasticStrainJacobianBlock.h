@@ -28,6 +28,8 @@
 #include <sofa/type/Mat.h>
 #include "../types/StrainTypes.h"
 #include "../helper.h"
+#include <algorithm>
+#include <cmath>
 
 namespace sofa
 {
@@ -65,25 +67,19 @@ public:
     Mapping:   ADDITION       -> \f$ E_elastic = E_total - E_plastic \f$
                MULTIPLICATION -> \f$ E_elastic = E_total * E_plastic^-1 \f$
     Jacobian:                    \f$  dE = Id \f$
-    */
-
 
-    InCoord _plasticStrain;
-
-    void reset()
-    {
-        _plasticStrain.clear();
-    }
+    The plastic strains of all the samples are stored by the mapping (see PlasticStrainState) and given to the block.
+    */
 
 
     void addapply( OutCoord& /*result*/, const InCoord& /*data*/ ) {}
 
-    void addapply_multiplication( OutCoord& result, const InCoord& data, Real max, Real squaredYield, Real creep )
+    void addapply_multiplication( OutCoord& result, const InCoord& data, InCoord& plasticStrain, Real max, Real squaredYield, Real creep )
     {
         // eventually remove a part of the strain to simulate plasticity
 
         // could be optimized by storing the computation of the previous time step
-        StrainMat plasticStrainMat = StrainVoigtToMat( _plasticStrain.getStrain() ) + StrainMat::s_identity;
+        StrainMat plasticStrainMat = StrainVoigtToMat( plasticStrain.getStrain() ) + StrainMat::s_identity;
         StrainMat plasticStrainMatInverse; plasticStrainMatInverse.invert( plasticStrainMat );
 
         // elasticStrain = totalStrain * plasticStrain^-1
@@ -92,14 +88,14 @@ public:
 
         // if( ||elasticStrain||  > c_yield ) plasticStrain += dt * c_creep * dt * elasticStrain
         if( elasticStrainVec.norm2() > squaredYield )
-            _plasticStrain.getStrain() += creep * elasticStrainVec;
+            plasticStrain.getStrain() += creep * elasticStrainVec;
 
         // if( ||plasticStrain|| > c_max ) plasticStrain *= c_max / ||plasticStrain||
-        Real plasticStrainNorm2 = _plasticStrain.getStrain().norm2();
+        Real plasticStrainNorm2 = plasticStrain.getStrain().norm2();
         if( plasticStrainNorm2 > max*max )
-            _plasticStrain.getStrain() *= max / helper::rsqrt( plasticStrainNorm2 );
+            plasticStrain.getStrain() *= max / helper::rsqrt( plasticStrainNorm2 );
 
-        plasticStrainMat = StrainVoigtToMat( _plasticStrain.getStrain() ) + StrainMat::s_identity;
+        plasticStrainMat = StrainVoigtToMat( plasticStrain.getStrain() ) + StrainMat::s_identity;
 
         // remaining elasticStrain = totalStrain * plasticStrain^-1
         plasticStrainMatInverse.invert( plasticStrainMat );
@@ -109,22 +105,22 @@ public:
         result.getStrain() += elasticStrainVec;
     }
 
-    void addapply_addition( OutCoord& result, const InCoord& data, Real max, Real squaredYield, Real creep )
+    void addapply_addition( OutCoord& result, const InCoord& data, InCoord& plasticStrain, Real max, Real squaredYield, Real creep )
     {
         // eventually remove a part of the strain to simulate plasticity
 
         // elasticStrain = totalStrain - plasticStrain
-        InCoord elasticStrain = data - _plasticStrain;
+        InCoord elasticStrain = data - plasticStrain;
 
         if( elasticStrain.getStrain().norm2() > squaredYield )
-            _plasticStrain += elasticStrain * creep;
+            plasticStrain += elasticStrain * creep;
 
-        Real plasticStrainNorm2 = _plasticStrain.getStrain().norm2();
+        Real plasticStrainNorm2 = plasticStrain.getStrain().norm2();
         if( plasticStrainNorm2 > max*max )
-            _plasticStrain.getStrain() *= max / helper::rsqrt( plasticStrainNorm2 );
+            plasticStrain.getStrain() *= max / helper::rsqrt( plasticStrainNorm2 );
 
         // remaining elasticStrain = totatStrain - plasticStrain
-        elasticStrain = data - _plasticStrain;
+        elasticStrain = data - plasticStrain;
 
         result += elasticStrain;
     }
@@ -156,6 +152,133 @@ public:
 }; // class PlasticStrainJacobianBlock
 
 
+
+/** Plastic strains of all the samples and their plasticity parameters, in structure of arrays.
+  The component c of the plastic strain of sample i is stored at c*size()+i, so that consecutive samples are updated with vector instructions.
+  The parameters are expanded per sample once, instead of being resolved at each step.
+*/
+template<class TStrain>
+class PlasticStrainState
+{
+public:
+    typedef typename TStrain::Coord Coord;
+    typedef typename TStrain::Real Real;
+    enum { VSize = TStrain::coord_total_size };
+    enum { strain_size = TStrain::strain_size };
+
+    /// number of samples updated at once by addition()
+    enum { Chunk = 64 };
+
+    type::vector<Real> plasticStrain;   ///< VSize arrays of size() reals
+    type::vector<Real> max;             ///< Plastic Max Threshold of each sample
+    type::vector<Real> squaredYield;    ///< squared Plastic Yield Threshold of each sample
+    type::vector<Real> creep;           ///< Plastic Creep Factor * dt of each sample
+
+    size_t size() const { return max.size(); }
+
+    /// expands the parameters (one value per sample, or the first value for the remaining samples)
+    /// and resizes the plastic strains, keeping the ones of the remaining samples
+    void resize( size_t n, const type::vector<Real>& maxs, const type::vector<Real>& yields, const type::vector<Real>& creeps )
+    {
+        const size_t old = size();
+        if( n!=old )
+        {
+            type::vector<Real> p( VSize*n, (Real)0 );
+            for( size_t c=0 ; c<VSize ; c++ ) std::copy( plasticStrain.begin()+c*old, plasticStrain.begin()+c*old+std::min(n,old), p.begin()+c*n );
+            plasticStrain.swap( p );
+        }
+
+        max.resize( n ); squaredYield.resize( n ); creep.resize( n );
+        for( size_t i=0 ; i<n ; i++ )
+        {
+            max[i] = expand( maxs, i );
+            const Real yield = expand( yields, i );
+            squaredYield[i] = yield*yield;
+            creep[i] = expand( creeps, i );
+        }
+    }
+
+    void reset() { std::fill( plasticStrain.begin(), plasticStrain.end(), (Real)0 ); }
+
+    Coord get( size_t i ) const
+    {
+        Coord p;
+        for( size_t c=0 ; c<VSize ; c++ ) p.getVec()[c] = plasticStrain[c*size()+i];
+        return p;
+    }
+
+    void set( size_t i, const Coord& p )
+    {
+        for( size_t c=0 ; c<VSize ; c++ ) plasticStrain[c*size()+i] = p.getVec()[c];
+    }
+
+    /// ADDITION method (PlasticStrainJacobianBlock::addapply_addition) for the samples [begin,end): out = in - plastic strain, after the plastic update
+    /// Each chunk of samples is gathered per component, so that the per sample loops are branch free and vectorized.
+    void addition( Coord* out, const Coord* in, size_t begin, size_t end )
+    {
+        const size_t n = size();
+        for( size_t b=begin ; b<end ; b+=Chunk )
+        {
+            const size_t m = std::min<size_t>( end-b, Chunk );
+            Real x[VSize][Chunk];   // total strains of the chunk, then remaining elastic strains
+            Real e2[Chunk], f[Chunk], p2[Chunk];
+
+            for( size_t k=0 ; k<m ; k++ )
+            {
+                const Real* xk = in[b+k].getVec().ptr();
+                for( size_t c=0 ; c<VSize ; c++ ) x[c][k] = xk[c];
+            }
+
+            // creep factor: creep when the elastic strain exceeds the yield threshold, 0 otherwise
+            for( size_t k=0 ; k<m ; k++ ) e2[k] = 0;
+            for( size_t c=0 ; c<strain_size ; c++ )
+            {
+                const Real* p = &plasticStrain[c*n+b];
+                for( size_t k=0 ; k<m ; k++ ) { const Real d = x[c][k]-p[k]; e2[k] += d*d; }
+            }
+            const Real* y2 = &squaredYield[b];
+            const Real* cr = &creep[b];
+            for( size_t k=0 ; k<m ; k++ ) f[k] = e2[k] > y2[k] ? cr[k] : (Real)0;
+
+            // creep
+            for( size_t k=0 ; k<m ; k++ ) p2[k] = 0;
+            for( size_t c=0 ; c<VSize ; c++ )
+            {
+                Real* p = &plasticStrain[c*n+b];
+                for( size_t k=0 ; k<m ; k++ ) p[k] += f[k]*(x[c][k]-p[k]);
+                if( c<strain_size ) for( size_t k=0 ; k<m ; k++ ) p2[k] += p[k]*p[k];
+            }
+
+            // clamp the plastic strain to the max threshold: scale factor min(1,max/|p|) (|p|=0 gives inf or nan, and 1)
+            const Real* mx = &max[b];
+            for( size_t k=0 ; k<m ; k++ ) f[k] = std::min( (Real)1, mx[k]/std::sqrt(p2[k]) );
+            for( size_t c=0 ; c<strain_size ; c++ )
+            {
+                Real* p = &plasticStrain[c*n+b];
+                for( size_t k=0 ; k<m ; k++ ) p[k] *= f[k];
+            }
+
+            // remaining elastic strain
+            for( size_t c=0 ; c<VSize ; c++ )
+            {
+                const Real* p = &plasticStrain[c*n+b];
+                for( size_t k=0 ; k<m ; k++ ) x[c][k] -= p[k];
+            }
+            for( size_t k=0 ; k<m ; k++ )
+            {
+                Real* yk = out[b+k].getVec().ptr();
+                for( size_t c=0 ; c<VSize ; c++ ) yk[c] = x[c][k];
+            }
+        }
+    }
+
+protected:
+
+    static Real expand( const type::vector<Real>& v, size_t i ) { return v.empty() ? (Real)0 : v.size()<=i ? v[0] : v[i]; }
+
+}; // class PlasticStrainState
+
+
 } // namespace defaulttype
 } // namespace sofa
 
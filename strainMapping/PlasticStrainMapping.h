@@ -63,7 +63,6 @@ public:
     //@{
     Data<type::vector<Real> > _max; ///< Plastic Max Threshold (2-norm of the strain)
     Data<type::vector<Real> > _yield; ///< Plastic Yield Threshold (2-norm of the strain)
-    type::vector<Real> _squaredYield;
     Data<type::vector<Real> > _creep; ///< this parameter is different from the article, here it includes the multiplication by dt
     //@}
 
@@ -71,8 +70,7 @@ public:
 
     virtual void reinit() override
     {
-        _squaredYield.resize(_yield.getValue().size());
-        for(size_t i=0;i<_yield.getValue().size();i++) _squaredYield[i] = _yield.getValue()[i] * _yield.getValue()[i];
+        updateState();
 
         Inherit::reinit();
     }
@@ -82,8 +80,7 @@ public:
         //serr<<"PlasticStrainMapping::reset"<<sendl;
         Inherit::reset();
 
-        for( size_t i=0 ; i<this->jacobian.size() ; i++ )
-            this->jacobian[i].reset();
+        plasticState.reset();
     }
 
 
@@ -95,6 +92,7 @@ protected:
         , _max(initData(&_max,type::vector<Real>((int)1,(Real)0.1f),"max","Plastic Max Threshold (2-norm of the strain)"))
         , _yield(initData(&_yield,type::vector<Real>((int)1,(Real)0.0001f),"yield","Plastic Yield Threshold (2-norm of the strain)"))
         , _creep(initData(&_creep,type::vector<Real>((int)1,(Real)1.f),"creep","Plastic Creep Factor * dt [0,1]. 1 <-> pure plastic ; <1 <-> visco-plastic (warning depending on dt)"))
+        , maxCounter(-1), yieldCounter(-1), creepCounter(-1)
     {
         helper::OptionsGroup Options;
         Options.setNbItems( NB_PlasticMethod );
@@ -106,6 +104,21 @@ protected:
 
     virtual ~PlasticStrainMapping() { }
 
+    defaulttype::PlasticStrainState<TStrain> plasticState; ///< plastic strains and parameters of all the samples
+    int maxCounter, yieldCounter, creepCounter; ///< counters of _max, _yield and _creep when they were expanded in plasticState
+
+    /// expands the parameters per sample (at reinit, or when the number of samples or the parameters change), keeping the plastic strains
+    void updateState()
+    {
+        plasticState.resize( this->jacobian.size(), _max.getValue(), _yield.getValue(), _creep.getValue() );
+        maxCounter = _max.getCounter(); yieldCounter = _yield.getCounter(); creepCounter = _creep.getCounter();
+    }
+
+    bool stateChanged() const
+    {
+        return plasticState.size()!=this->jacobian.size() || _max.getCounter()!=maxCounter || _yield.getCounter()!=yieldCounter || _creep.getCounter()!=creepCounter;
+    }
+
     virtual void apply( const core::MechanicalParams * /*mparams*/ , Data<typename Inherit::OutVecCoord>& dOut, const Data<typename Inherit::InVecCoord>& dIn ) override
     {
         helper::ReadAccessor<Data<typename Inherit::InVecCoord> > inpos (*this->fromModel->read(core::ConstVecCoordId::position()));
@@ -115,6 +128,8 @@ protected:
         typename Inherit::OutVecCoord& out = *dOut.beginWriteOnly();
         const typename Inherit::InVecCoord&  in  =  dIn.getValue();
 
+        if( stateChanged() ) updateState();
+
         switch( f_method.getValue().getSelectedId() )
         {
         case MULTIPLICATION:
@@ -125,24 +140,21 @@ protected:
 			for(sofa::helper::IndexOpenMP<unsigned int>::type i=0 ; i<this->jacobian.size() ; i++ )
             {
                 out[i] = typename Inherit::OutCoord();
-                Real Max=(_max.getValue().size()<=i)?_max.getValue()[0]:_max.getValue()[i],SquaredYield=(_squaredYield.size()<=i)?_squaredYield[0]:_squaredYield[i] ,Creep=(_creep.getValue().size()<=i)?_creep.getValue()[0]:_creep.getValue()[i];
-
-                this->jacobian[i].addapply_multiplication( out[i], in[i], Max, SquaredYield, Creep );
+                typename Inherit::InCoord plasticStrain = plasticState.get(i);
+                this->jacobian[i].addapply_multiplication( out[i], in[i], plasticStrain, plasticState.max[i], plasticState.squaredYield[i], plasticState.creep[i] );
+                plasticState.set(i,plasticStrain);
             }
             break;
         }
         case ADDITION:
         {
+            typedef defaulttype::PlasticStrainState<TStrain> State;
+            const size_t nbChunks = (this->jacobian.size()+State::Chunk-1)/State::Chunk;
 #ifdef _OPENMP
         #pragma omp parallel for if (this->d_parallel.getValue())
 #endif
-			for(sofa::helper::IndexOpenMP<unsigned int>::type i=0 ; i<this->jacobian.size() ; i++ )
-            {
-                out[i] = typename Inherit::OutCoord();
-                Real Max=(_max.getValue().size()<=i)?_max.getValue()[0]:_max.getValue()[i],SquaredYield=(_squaredYield.size()<=i)?_squaredYield[0]:_squaredYield[i] ,Creep=(_creep.getValue().size()<=i)?_creep.getValue()[0]:_creep.getValue()[i];
-
-                this->jacobian[i].addapply_addition( out[i], in[i],  Max, SquaredYield, Creep );
-            }
+			for(sofa::helper::IndexOpenMP<unsigned int>::type c=0 ; c<nbChunks ; c++ )
+                plasticState.addition( &out[0], &in[0], c*State::Chunk, std::min<size_t>(this->jacobian.size(),(c+1)*State::Chunk) );
             break;
         }
         }
@@ -43,6 +43,11 @@ template class SOFA_Flexible_API State<F321Types>;
 template class SOFA_Flexible_API State<F311Types>;
 template class SOFA_Flexible_API State<F332Types>;
 template class SOFA_Flexible_API State<F221Types>;
+template class SOFA_Flexible_API State<F331OtherTypes>;
+template class SOFA_Flexible_API State<F321OtherTypes>;
+template class SOFA_Flexible_API State<F311OtherTypes>;
+template class SOFA_Flexible_API State<F332OtherTypes>;
+template class SOFA_Flexible_API State<F221OtherTypes>;
 
 } // namespace core
 
@@ -61,6 +66,11 @@ int DefGradientMechanicalObjectClass = core::RegisterObject ("Mechanical state v
         .add< MechanicalObject<F321Types> >()
         .add< MechanicalObject<F311Types> >()
         .add< MechanicalObject<F221Types> >()
+        .add< MechanicalObject<F331OtherTypes> >()
+        .add< MechanicalObject<F332OtherTypes> >()
+        .add< MechanicalObject<F321OtherTypes> >()
+        .add< MechanicalObject<F311OtherTypes> >()
+        .add< MechanicalObject<F221OtherTypes> >()
 		;
 
 template class SOFA_Flexible_API MechanicalObject<F331Types>;
@@ -68,6 +78,11 @@ template class SOFA_Flexible_API MechanicalObject<F332Types>;
 template class SOFA_Flexible_API MechanicalObject<F321Types>;
 template class SOFA_Flexible_API MechanicalObject<F311Types>;
 template class SOFA_Flexible_API MechanicalObject<F221Types>;
+template class SOFA_Flexible_API MechanicalObject<F331OtherTypes>;
+template class SOFA_Flexible_API MechanicalObject<F332OtherTypes>;
+template class SOFA_Flexible_API MechanicalObject<F321OtherTypes>;
+template class SOFA_Flexible_API MechanicalObject<F311OtherTypes>;
+template class SOFA_Flexible_API MechanicalObject<F221OtherTypes>;
 
 static RegisterTemplateAlias alias0("F331", F331Types::Name() );
 static RegisterTemplateAlias alias4("F332", F332Types::Name() );
@@ -75,24 +90,6 @@ static RegisterTemplateAlias alias2("F321", F321Types::Name() );
 static RegisterTemplateAlias alias3("F311", F311Types::Name() );
 static RegisterTemplateAlias alias5("F221", F221Types::Name() );
 
-namespace f
-{
-static RegisterTemplateAlias alias0("F331f", F331Types::Name(), isSRealDouble());
-static RegisterTemplateAlias alias1("F332f", F332Types::Name(), isSRealDouble());
-static RegisterTemplateAlias alias2("F321f", F321Types::Name(), isSRealDouble());
-static RegisterTemplateAlias alias3("F311f", F311Types::Name(), isSRealDouble());
-static RegisterTemplateAlias alias5("F221f", F221Types::Name(), isSRealDouble());
-}
-
-namespace d
-{
-static RegisterTemplateAlias alias0("F331d", F331Types::Name(), isSRealFloat());
-static RegisterTemplateAlias alias1("F332d", F332Types::Name(), isSRealFloat());
-static RegisterTemplateAlias alias2("F321d", F321Types::Name(), isSRealFloat());
-static RegisterTemplateAlias alias3("F311d", F311Types::Name(), isSRealFloat());
-static RegisterTemplateAlias alias5("F221d", F221Types::Name(), isSRealFloat());
-}
-
 
 
 } // namespace container
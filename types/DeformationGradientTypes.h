@@ -211,21 +211,36 @@ struct DefGradientTypes
 
 // ==========================================================================
 typedef DefGradientTypes<3, 3, 0, double> F331dTypes;
+typedef DefGradientTypes<3, 3, 0, float>  F331fTypes;
 typedef DefGradientTypes<3, 3, 1, double> F332dTypes;
+typedef DefGradientTypes<3, 3, 1, float>  F332fTypes;
 typedef DefGradientTypes<3, 2, 0, double> F321dTypes; // for planar deformations
+typedef DefGradientTypes<3, 2, 0, float>  F321fTypes;
 typedef DefGradientTypes<3, 1, 0, double> F311dTypes; // for linear deformations
+typedef DefGradientTypes<3, 1, 0, float>  F311fTypes;
 typedef DefGradientTypes<2, 2, 0, double> F221dTypes; // 2d planar deformations
+typedef DefGradientTypes<2, 2, 0, float>  F221fTypes;
 template<> inline const char* F331dTypes::Name() { return "F331d"; }
+template<> inline const char* F331fTypes::Name() { return "F331f"; }
 template<> inline const char* F332dTypes::Name() { return "F332d"; }
+template<> inline const char* F332fTypes::Name() { return "F332f"; }
 template<> inline const char* F321dTypes::Name() { return "F321d"; }
+template<> inline const char* F321fTypes::Name() { return "F321f"; }
 template<> inline const char* F311dTypes::Name() { return "F311d"; }
+template<> inline const char* F311fTypes::Name() { return "F311f"; }
 template<> inline const char* F221dTypes::Name() { return "F221d"; }
+template<> inline const char* F221fTypes::Name() { return "F221f"; }
 
 template<> struct DataTypeInfo< F331dTypes::Deriv > : public FixedArrayTypeInfo< F331dTypes::Deriv, F331dTypes::Deriv::total_size > {    static std::string name() { std::ostringstream o; o << "F331<" << DataTypeName<double>::name() << ">"; return o.str(); } };
+template<> struct DataTypeInfo< F331fTypes::Deriv > : public FixedArrayTypeInfo< F331fTypes::Deriv, F331fTypes::Deriv::total_size > {    static std::string name() { std::ostringstream o; o << "F331<" << DataTypeName<float>::name() << ">"; return o.str(); } };
 template<> struct DataTypeInfo< F332dTypes::Deriv > : public FixedArrayTypeInfo< F332dTypes::Deriv, F332dTypes::Deriv::total_size > {    static std::string name() { std::ostringstream o; o << "F332<" << DataTypeName<double>::name() << ">"; return o.str(); } };
+template<> struct DataTypeInfo< F332fTypes::Deriv > : public FixedArrayTypeInfo< F332fTypes::Deriv, F332fTypes::Deriv::total_size > {    static std::string name() { std::ostringstream o; o << "F332<" << DataTypeName<float>::name() << ">"; return o.str(); } };
 template<> struct DataTypeInfo< F321dTypes::Deriv > : public FixedArrayTypeInfo< F321dTypes::Deriv, F321dTypes::Deriv::total_size > {    static std::string name() { std::ostringstream o; o << "F321<" << DataTypeName<double>::name() << ">"; return o.str(); } };
+template<> struct DataTypeInfo< F321fTypes::Deriv > : public FixedArrayTypeInfo< F321fTypes::Deriv, F321fTypes::Deriv::total_size > {    static std::string name() { std::ostringstream o; o << "F321<" << DataTypeName<float>::name() << ">"; return o.str(); } };
 template<> struct DataTypeInfo< F311dTypes::Deriv > : public FixedArrayTypeInfo< F311dTypes::Deriv, F311dTypes::Deriv::total_size > {    static std::string name() { std::ostringstream o; o << "F311<" << DataTypeName<double>::name() << ">"; return o.str(); } };
+template<> struct DataTypeInfo< F311fTypes::Deriv > : public FixedArrayTypeInfo< F311fTypes::Deriv, F311fTypes::Deriv::total_size > {    static std::string name() { std::ostringstream o; o << "F311<" << DataTypeName<float>::name() << ">"; return o.str(); } };
 template<> struct DataTypeInfo< F221dTypes::Deriv > : public FixedArrayTypeInfo< F221dTypes::Deriv, F221dTypes::Deriv::total_size > {    static std::string name() { std::ostringstream o; o << "F221<" << DataTypeName<double>::name() << ">"; return o.str(); } };
+template<> struct DataTypeInfo< F221fTypes::Deriv > : public FixedArrayTypeInfo< F221fTypes::Deriv, F221fTypes::Deriv::total_size > {    static std::string name() { std::ostringstream o; o << "F221<" << DataTypeName<float>::name() << ">"; return o.str(); } };
 
 typedef DefGradientTypes<3, 3, 0, SReal> F331Types;
 typedef DefGradientTypes<3, 3, 1, SReal> F332Types;
@@ -233,6 +248,13 @@ typedef DefGradientTypes<3, 2, 0, SReal> F321Types; // for planar deformations
 typedef DefGradientTypes<3, 1, 0, SReal> F311Types; // for linear deformations
 typedef DefGradientTypes<2, 2, 0, SReal> F221Types; // 2d planar deformations
 
+// precision which is not SReal (single precision types in a double build)
+typedef DefGradientTypes<3, 3, 0, NonSReal> F331OtherTypes;
+typedef DefGradientTypes<3, 3, 1, NonSReal> F332OtherTypes;
+typedef DefGradientTypes<3, 2, 0, NonSReal> F321OtherTypes;
+typedef DefGradientTypes<3, 1, 0, NonSReal> F311OtherTypes;
+typedef DefGradientTypes<2, 2, 0, NonSReal> F221OtherTypes;
+
 
 
 
@@ -242,10 +264,15 @@ typedef DefGradientTypes<2, 2, 0, SReal> F221Types; // 2d planar deformations
 
 
 template<> struct DataTypeName< defaulttype::F331dTypes::Coord > { static const char* name() { return "F331dTypes::CoordOrDeriv"; } };
+template<> struct DataTypeName< defaulttype::F331fTypes::Coord > { static const char* name() { return "F331fTypes::CoordOrDeriv"; } };
 template<> struct DataTypeName< defaulttype::F332dTypes::Coord > { static const char* name() { return "F332dTypes::CoordOrDeriv"; } };
+template<> struct DataTypeName< defaulttype::F332fTypes::Coord > { static const char* name() { return "F332fTypes::CoordOrDeriv"; } };
 template<> struct DataTypeName< defaulttype::F321dTypes::Coord > { static const char* name() { return "F321dTypes::CoordOrDeriv"; } };
+template<> struct DataTypeName< defaulttype::F321fTypes::Coord > { static const char* name() { return "F321fTypes::CoordOrDeriv"; } };
 template<> struct DataTypeName< defaulttype::F311dTypes::Coord > { static const char* name() { return "F311dTypes::CoordOrDeriv"; } };
+template<> struct DataTypeName< defaulttype::F311fTypes::Coord > { static const char* name() { return "F311fTypes::CoordOrDeriv"; } };
 template<> struct DataTypeName< defaulttype::F221dTypes::Coord > { static const char* name() { return "F221dTypes::CoordOrDeriv"; } };
+template<> struct DataTypeName< defaulttype::F221fTypes::Coord > { static const char* name() { return "F221fTypes::CoordOrDeriv"; } };
 
 
 
@@ -279,6 +306,16 @@ extern template class SOFA_Flexible_API MechanicalObjectInternalData<defaulttype
 extern template class SOFA_Flexible_API MechanicalObject<defaulttype::F311Types>;
 extern template class SOFA_Flexible_API MechanicalObjectInternalData<defaulttype::F221Types>;
 extern template class SOFA_Flexible_API MechanicalObject<defaulttype::F221Types>;
+extern template class SOFA_Flexible_API MechanicalObjectInternalData<defaulttype::F331OtherTypes>;
+extern template class SOFA_Flexible_API MechanicalObject<defaulttype::F331OtherTypes>;
+extern template class SOFA_Flexible_API MechanicalObjectInternalData<defaulttype::F332OtherTypes>;
+extern template class SOFA_Flexible_API MechanicalObject<defaulttype::F332OtherTypes>;
+extern template class SOFA_Flexible_API MechanicalObjectInternalData<defaulttype::F321OtherTypes>;
+extern template class SOFA_Flexible_API MechanicalObject<defaulttype::F321OtherTypes>;
+extern template class SOFA_Flexible_API MechanicalObjectInternalData<defaulttype::F311OtherTypes>;
+extern template class SOFA_Flexible_API MechanicalObject<defaulttype::F311OtherTypes>;
+extern template class SOFA_Flexible_API MechanicalObjectInternalData<defaulttype::F221OtherTypes>;
+extern template class SOFA_Flexible_API MechanicalObject<defaulttype::F221OtherTypes>;
 #endif
 
 } // namespace container
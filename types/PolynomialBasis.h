@@ -32,6 +32,7 @@
 #include <set>
 #include <vector>
 #include <map>
+#include <type_traits>
 
 #include <Eigen/Core>
 #include <Eigen/Dense>
@@ -42,6 +43,11 @@ namespace sofa
 namespace defaulttype
 {
 
+/// the precision which is not SReal (float when SReal is double, double when SReal is float).
+/// State types and the components between them are also instantiated in this precision, so that the explicit
+/// instantiations are guarded on the SReal type itself and never duplicate the SReal ones.
+typedef std::conditional<std::is_same<SReal,float>::value,double,float>::type NonSReal;
+
 
 template< int _N, typename _Real, int _dim, int _order>
 class Basis
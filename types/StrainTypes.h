@@ -269,6 +269,13 @@ typedef StrainTypes<3, 1, 0, SReal> E311Types;
 typedef StrainTypes<3, 3, 1, SReal> E332Types;
 typedef StrainTypes<3, 3, 2, SReal> E333Types;
 typedef StrainTypes<2, 2, 0, SReal> E221Types;
+// precision which is not SReal (single precision types in a double build)
+typedef StrainTypes<3, 3, 0, NonSReal> E331OtherTypes;
+typedef StrainTypes<3, 2, 0, NonSReal> E321OtherTypes;
+typedef StrainTypes<3, 1, 0, NonSReal> E311OtherTypes;
+typedef StrainTypes<3, 3, 1, NonSReal> E332OtherTypes;
+typedef StrainTypes<3, 3, 2, NonSReal> E333OtherTypes;
+typedef StrainTypes<2, 2, 0, NonSReal> E221OtherTypes;
 
 template<> inline const char* E331dTypes::Name() { return "E331d"; }
 template<> inline const char* E331fTypes::Name() { return "E331f"; }
@@ -339,6 +346,7 @@ public:
 typedef InvariantStrainTypes<3, 3, 0, double> I331dTypes;
 typedef InvariantStrainTypes<3, 3, 0, float>  I331fTypes;
 typedef InvariantStrainTypes<3, 3, 0, SReal>  I331Types;
+typedef InvariantStrainTypes<3, 3, 0, NonSReal>  I331OtherTypes;
 
 template<> inline const char* I331dTypes::Name() { return "I331d"; }
 template<> inline const char* I331fTypes::Name() { return "I331f"; }
@@ -380,6 +388,8 @@ typedef PrincipalStretchesStrainTypes<3, 2, 0, double> U321dTypes;
 typedef PrincipalStretchesStrainTypes<3, 2, 0, float>  U321fTypes;
 typedef PrincipalStretchesStrainTypes<3, 3, 0, SReal>  U331Types;
 typedef PrincipalStretchesStrainTypes<3, 2, 0, SReal> U321Types;
+typedef PrincipalStretchesStrainTypes<3, 3, 0, NonSReal>  U331OtherTypes;
+typedef PrincipalStretchesStrainTypes<3, 2, 0, NonSReal>  U321OtherTypes;
 
 template<> inline const char* U331dTypes::Name() { return "U331d"; }
 template<> inline const char* U331fTypes::Name() { return "U331f"; }
@@ -604,6 +614,15 @@ extern template class SOFA_Flexible_API MechanicalObject<defaulttype::E221Types>
 extern template class SOFA_Flexible_API MechanicalObject<defaulttype::I331Types>;
 extern template class SOFA_Flexible_API MechanicalObject<defaulttype::U331Types>;
 extern template class SOFA_Flexible_API MechanicalObject<defaulttype::U321Types>;
+extern template class SOFA_Flexible_API MechanicalObject<defaulttype::E331OtherTypes>;
+extern template class SOFA_Flexible_API MechanicalObject<defaulttype::E332OtherTypes>;
+extern template class SOFA_Flexible_API MechanicalObject<defaulttype::E333OtherTypes>;
+extern template class SOFA_Flexible_API MechanicalObject<defaulttype::E321OtherTypes>;
+extern template class SOFA_Flexible_API MechanicalObject<defaulttype::E311OtherTypes>;
+extern template class SOFA_Flexible_API MechanicalObject<defaulttype::E221OtherTypes>;
+extern template class SOFA_Flexible_API MechanicalObject<defaulttype::I331OtherTypes>;
+extern template class SOFA_Flexible_API MechanicalObject<defaulttype::U331OtherTypes>;
+extern template class SOFA_Flexible_API MechanicalObject<defaulttype::U321OtherTypes>;
 #endif
 
 } // namespace container